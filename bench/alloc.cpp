@@ -0,0 +1,168 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#include <new>
+#include <cerrno>
+#include <cstdlib>
+#include "bench.hpp"
+
+// every allocation of the benchmarks goes through here and is counted on the thread that makes it,
+// malloc and its siblings are replaced too, on top of the allocator of glibc, and operator new is built on them
+
+extern "C"
+{
+    void* __libc_malloc(std::size_t);
+    void* __libc_calloc(std::size_t, std::size_t);
+
+    void* __libc_realloc(void*, std::size_t);
+    void* __libc_memalign(std::size_t, std::size_t);
+}
+
+namespace
+{
+    void count(std::size_t size) noexcept
+    {
+        auto& a = snp::bench::allocations;
+
+        ++a.count;
+        a.bytes += size;
+
+        if (auto f = snp::bench::on_allocation)
+            f(size);
+    }
+}
+
+extern "C"
+{
+    void* malloc(std::size_t size) noexcept
+    {
+        count(size);
+
+        return __libc_malloc(size);
+    }
+
+    void* calloc(std::size_t n, std::size_t size) noexcept
+    {
+        count(n * size);
+
+        return __libc_calloc(n, size);
+    }
+
+    void* realloc(void* p, std::size_t size) noexcept
+    {
+        count(size);
+
+        return __libc_realloc(p, size);
+    }
+
+    void* memalign(std::size_t alignment, std::size_t size) noexcept
+    {
+        count(size);
+
+        return __libc_memalign(alignment, size);
+    }
+
+    void* aligned_alloc(std::size_t alignment, std::size_t size) noexcept
+    {
+        return memalign(alignment, size);
+    }
+
+    int posix_memalign(void** p, std::size_t alignment, std::size_t size) noexcept
+    {
+        if (!(*p = memalign(alignment, size)))
+            return ENOMEM;
+
+        return 0;
+    }
+}
+
+void* operator new(std::size_t size)
+{
+    if (auto p = std::malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    try
+    {
+        return operator new(size);
+    }
+    catch (...)
+    {
+        return nullptr;
+    }
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return operator new(size, std::nothrow);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t) noexcept
+{
+    std::free(p);
+}
+
+void* operator new(std::size_t size, std::align_val_t align)
+{
+    auto alignment = static_cast<std::size_t>(align);
+
+    if (auto p = std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t align)
+{
+    return operator new(size, align);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept
+{
+    std::free(p);
+}
@@ -0,0 +1,472 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#include <array>
+#include <string>
+#include <cstdlib>
+#include <iostream>
+#include <execinfo.h>
+#include <cxxabi.h>
+#include <sys/socket.h>
+#include <snp.hpp>
+#include <unifex/just.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include "bench.hpp"
+#include "loop.hpp"
+
+// runs every sender in a loop through start_detached on a recycling allocator, first to warm up the pools, the free lists
+// and the lazily created state of asio, then once more while every allocation of the thread is recorded with its call stack,
+// a sender passes if that second run doesn't allocate at all. connecting, accepting and resolving are left out,
+// they create sockets and endpoint lists by design
+
+namespace net = boost::asio;
+namespace http = snp::http;
+
+using udp = net::ip::udp;
+using local = net::local::stream_protocol;
+
+using error_code_t = boost::system::error_code;
+
+// the allocations recorded on the thread while a sender is checked, the call stacks of the first few of them are kept
+namespace recorder
+{
+    constexpr std::size_t max_sites = 4;
+    constexpr std::size_t max_frames = 48;
+
+    struct site
+    {
+        std::size_t size;
+
+        std::array<void*, max_frames> frames;
+        int depth;
+    };
+
+    thread_local std::size_t count = 0;
+    thread_local std::size_t recorded = 0;
+
+    thread_local std::array<site, max_sites> sites;
+    thread_local bool inside = false;
+
+    void record(std::size_t size)
+    {
+        ++count;
+
+        // backtrace may allocate itself the first time, that allocation isn't recorded again
+        if (inside || recorded == max_sites)
+            return;
+
+        inside = true;
+        auto& s = sites[recorded++];
+
+        s.size = size;
+        s.depth = backtrace(s.frames.data(), max_frames);
+
+        inside = false;
+    }
+
+    // the demangled function of a line of backtrace_symbols, like ./snp-alloc-check(_ZN3snp...+0x1f) [0x5581...]
+    std::string function(std::string_view line)
+    {
+        auto begin = line.find('(');
+        auto end = line.find_first_of("+)", begin);
+
+        if (begin == line.npos || end == line.npos || end == begin + 1)
+            return std::string(line);
+
+        std::string mangled(line.substr(begin + 1, end - begin - 1));
+
+        int status;
+        auto name = abi::__cxa_demangle(mangled.c_str(), nullptr, nullptr, &status);
+
+        std::string s = status ? mangled : name;
+        std::free(name);
+
+        constexpr std::size_t max_length = 240;
+
+        if (s.size() > max_length)
+            s = s.substr(0, max_length) + "...";
+
+        return s;
+    }
+
+    bool allocator(std::string_view name)
+    {
+        for (std::string_view f : {"malloc", "calloc", "realloc", "memalign", "aligned_alloc", "posix_memalign", "operator new", "record", "(anonymous namespace)::count"})
+        {
+             if (name.starts_with(f))
+                 return true;
+        }
+
+        return false;
+    }
+
+    // skips the frames of the allocator and the recorder on top of the stack
+    void print(const site& s)
+    {
+        std::cout << "  " << s.size << " bytes allocated at" << std::endl;
+
+        auto symbols = backtrace_symbols(s.frames.data(), s.depth);
+        int first = 0;
+
+        for (int i = 0; i != s.depth; ++i)
+        {
+             if (allocator(function(symbols[i])))
+                 first = i + 1;
+        }
+
+        for (int i = first; i != s.depth; ++i)
+             std::cout << "    #" << i - first << " " << function(symbols[i]) << std::endl;
+
+        std::free(symbols);
+    }
+}
+
+struct checker
+{
+    using alloc_t = snp::bench::recycling_allocator<std::byte>;
+
+    checker(std::size_t iterations, std::string filter) : iterations(iterations), filter(std::move(filter))
+    {
+    }
+
+    template <typename Make>
+    void check(std::string name, Make make)
+    {
+        if (!filter.empty() && name.find(filter) == name.npos)
+            return;
+
+        recorder::count = 0;
+        recorder::recorded = 0;
+
+        // the recording starts within the same run of the io_context as the warmup,
+        // asio keeps the memory of the handlers of a thread only as long as it runs
+        auto warmup = std::max<std::size_t>(iterations / 10, 1);
+        std::size_t started = 0;
+
+        auto next = [&]
+        {
+            if (started++ == warmup)
+                snp::bench::on_allocation = recorder::record;
+
+            return make();
+        };
+
+        snp::bench::loop<alloc_t, decltype(next)> l{alloc_t(), next, warmup + iterations};
+        l();
+
+        ioc.run();
+        snp::bench::on_allocation = nullptr;
+
+        ioc.restart();
+
+        if (!recorder::count)
+        {
+            std::cout << name << ": ok" << std::endl;
+
+            return;
+        }
+
+        ++failed;
+
+        std::cout << name << ": " << recorder::count << " allocations in " << iterations << " iterations in steady state" << std::endl;
+
+        for (std::size_t i = 0; i != recorder::recorded; ++i)
+             recorder::print(recorder::sites[i]);
+    }
+
+    net::io_context ioc;
+
+    std::size_t iterations;
+    std::string filter;
+
+    std::size_t failed = 0;
+};
+
+constexpr std::size_t payload = 64;
+
+using snp::bench::drain;
+
+void check_schedule(checker& c)
+{
+    snp::asio_scheduler sch(c.ioc);
+
+    c.check("schedule", [sch]() mutable
+    {
+        return unifex::schedule(sch);
+    });
+
+    c.check("schedule_after", [sch]() mutable
+    {
+        return unifex::schedule_after(sch, std::chrono::nanoseconds(0));
+    });
+}
+
+void check_timer(checker& c)
+{
+    net::steady_timer timer(c.ioc);
+
+    c.check("async_wait", [&]
+    {
+        return snp::async_wait(timer, std::chrono::nanoseconds(0));
+    });
+
+    c.check("async_wait_until", [&]
+    {
+        return snp::async_wait_until(timer, std::chrono::steady_clock::now());
+    });
+}
+
+void check_stream(checker& c)
+{
+    local::socket a(c.ioc), b(c.ioc);
+    net::local::connect_pair(a, b);
+
+    char data[payload] = {};
+    char buffer[payload];
+
+    // the peer reads what the previous write left behind
+    std::size_t written = 0;
+
+    c.check("async_write_some", [&]
+    {
+        drain(b.native_handle(), std::exchange(written, payload));
+
+        return snp::async_write_some(a, net::buffer(data));
+    });
+
+    c.check("async_write", [&]
+    {
+        drain(b.native_handle(), std::exchange(written, payload));
+
+        return snp::async_write(a, net::buffer(data));
+    });
+
+    drain(b.native_handle(), written);
+
+    c.check("async_read_some", [&]
+    {
+        auto n = ::write(b.native_handle(), data, payload);
+        (void)n;
+
+        return snp::async_read_some(a, net::buffer(buffer));
+    });
+
+    c.check("async_read", [&]
+    {
+        auto n = ::write(b.native_handle(), data, payload);
+        (void)n;
+
+        return snp::async_read(a, net::buffer(buffer));
+    });
+}
+
+void check_framing(checker& c)
+{
+    local::socket a(c.ioc), b(c.ioc);
+    net::local::connect_pair(a, b);
+
+    snp::buffered_stream<local::socket&> stream(a);
+    snp::framed_reader<snp::fixed_codec<4>> frames;
+
+    http::request_reader requests;
+    http::response_writer responses;
+
+    std::string line(payload - 2, 'x');
+    std::string frame(payload, 'x');
+
+    std::string request = "GET /plaintext HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\n\r\n";
+
+    line += "\r\n";
+    snp::fixed_codec<4>::encode(frame.data(), payload - 4);
+
+    auto peer_write = [&](const std::string& data)
+    {
+        auto n = ::write(b.native_handle(), data.data(), data.size());
+
+        (void)n;
+    };
+
+    c.check("async_read_until", [&]
+    {
+        peer_write(line);
+
+        return snp::async_read_until(stream, "\r\n");
+    });
+
+    c.check("async_read_frames", [&]
+    {
+        peer_write(frame);
+
+        return snp::async_read_frames(a, frames);
+    });
+
+    c.check("async_read_request", [&]
+    {
+        peer_write(request);
+
+        return http::async_read_request(a, requests);
+    });
+
+    http::response res;
+    res.body = "Hello, World!";
+
+    std::size_t pending = 0;
+
+    c.check("async_write_response", [&]
+    {
+        drain(b.native_handle(), std::exchange(pending, 0));
+
+        responses.add(res, 11, true);
+        pending = responses.size();
+
+        return http::async_write_response(a, responses);
+    });
+}
+
+void check_datagram(checker& c)
+{
+    udp::socket a(c.ioc, udp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    udp::socket b(c.ioc, udp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+
+    udp::endpoint sender;
+
+    udp::endpoint from = a.local_endpoint();
+    udp::endpoint to = b.local_endpoint();
+
+    char data[payload] = {};
+    char buffer[payload];
+
+    constexpr std::size_t batch = 16;
+
+    snp::datagram_reader reader(batch, payload);
+    snp::datagram_writer writer(batch * payload);
+
+    auto peer_send = [&](std::size_t n)
+    {
+        for (std::size_t i = 0; i != n; ++i)
+             ::sendto(b.native_handle(), data, payload, 0, from.data(), from.size());
+    };
+
+    auto peer_receive = [&](std::size_t n)
+    {
+        for (std::size_t i = 0; i != n; ++i)
+             ::recv(b.native_handle(), buffer, payload, 0);
+    };
+
+    std::size_t pending = 0;
+
+    c.check("async_send_to", [&]
+    {
+        peer_receive(std::exchange(pending, 1));
+
+        return snp::async_send_to(a, net::buffer(data), to);
+    });
+
+    c.check("async_send_batch", [&]
+    {
+        peer_receive(std::exchange(pending, batch));
+
+        for (std::size_t i = 0; i != batch; ++i)
+             writer.add(to, net::buffer(data));
+
+        return snp::async_send_batch(a, writer);
+    });
+
+    peer_receive(std::exchange(pending, 0));
+
+    c.check("async_receive_from", [&]
+    {
+        peer_send(1);
+
+        return snp::async_receive_from(a, net::buffer(buffer), sender);
+    });
+
+    c.check("async_receive_batch", [&]
+    {
+        peer_send(batch);
+
+        return snp::async_receive_batch(a, reader);
+    });
+}
+
+void check_hedge(checker& c)
+{
+    snp::asio_scheduler sch(c.ioc);
+    snp::hedge_policy policy(std::chrono::milliseconds(10));
+
+    c.check("hedge", [&]
+    {
+        return snp::hedge(sch, []{ return unifex::just(1); }, policy);
+    });
+}
+
+void check_file(checker& c)
+{
+#ifdef BOOST_ASIO_HAS_FILE
+    net::random_access_file file(c.ioc, "/tmp/snp_alloc_check_file", net::random_access_file::read_write | net::random_access_file::create);
+    char data[4096] = {};
+
+    c.check("async_write_some_at", [&]
+    {
+        return snp::async_write_some_at(file, 0, net::buffer(data));
+    });
+
+    c.check("async_read_some_at", [&]
+    {
+        return snp::async_read_some_at(file, 0, net::buffer(data));
+    });
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t iterations = 10000;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i)
+    {
+         std::string_view arg = argv[i];
+
+         if (arg == "--filter" && i + 1 < argc)
+             filter = argv[++i];
+         else if (arg == "--iterations" && i + 1 < argc)
+             iterations = std::stoul(argv[++i]);
+         else
+         {
+             std::cerr << "Usage: " << argv[0] << " [--filter <name>] [--iterations <n>]" << std::endl;
+
+             return 1;
+         }
+    }
+
+    // loads the unwinder before anything is recorded
+    void* frame;
+    backtrace(&frame, 1);
+
+    checker c(iterations, filter);
+
+    check_schedule(c);
+    check_timer(c);
+
+    check_stream(c);
+    check_framing(c);
+
+    check_datagram(c);
+    check_hedge(c);
+
+    check_file(c);
+
+    if (c.failed)
+    {
+        std::cout << c.failed << " senders allocated in steady state" << std::endl;
+        std::cout << "the frames without a name resolve with addr2line -Cfi -e " << argv[0] << " <offset>" << std::endl;
+    }
+
+    return c.failed ? 1 : 0;
+}
@@ -0,0 +1,292 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <optional>
+#include <ostream>
+#include <algorithm>
+#include <exception>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+namespace snp::bench
+{
+    // counted by the replacements of malloc and operator new in alloc.cpp
+    struct allocation_counter
+    {
+        std::size_t count = 0;
+        std::size_t bytes = 0;
+    };
+
+    inline thread_local allocation_counter allocations;
+
+    // called with the size of every allocation the thread makes while it's set
+    inline thread_local void (*on_allocation)(std::size_t) = nullptr;
+
+    // a hardware counter of the calling thread in user space, it reads nothing if perf_event_open is denied or unsupported
+    struct perf_counter
+    {
+        explicit perf_counter(uint64_t config)
+        {
+            perf_event_attr attr{};
+
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.size = sizeof(attr);
+            attr.config = config;
+
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+        }
+
+        perf_counter(const perf_counter&) = delete;
+
+        ~perf_counter()
+        {
+            if (fd != -1)
+                close(fd);
+        }
+
+        void start() noexcept
+        {
+            if (fd != -1)
+            {
+                ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+            }
+        }
+
+        std::optional<uint64_t> stop() noexcept
+        {
+            if (fd == -1)
+                return {};
+
+            ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            uint64_t value;
+
+            if (read(fd, &value, sizeof(value)) != sizeof(value))
+                return {};
+
+            return value;
+        }
+
+        int fd;
+    };
+
+    // reads exactly n bytes the peer received, a failed read ends the benchmark as a failed sender does
+    inline void drain(int fd, std::size_t n)
+    {
+        char buffer[4096];
+
+        while (n)
+        {
+            auto r = ::read(fd, buffer, std::min(n, sizeof(buffer)));
+
+            if (r < 0 && errno == EINTR)
+                continue;
+
+            if (r <= 0)
+            {
+                std::cerr << "bench: drain: " << (r ? std::strerror(errno) : "end of file") << std::endl;
+                std::terminate();
+            }
+
+            n -= r;
+        }
+    }
+
+    // keeps the blocks released on a thread in free lists of 64 byte classes up to 4KB,
+    // the custom allocator start_detached is measured with against std::allocator
+    template <typename T>
+    struct recycling_allocator
+    {
+        using value_type = T;
+
+        static constexpr std::size_t granularity = 64;
+        static constexpr std::size_t classes = 64;
+
+        recycling_allocator() = default;
+
+        template <typename U>
+        recycling_allocator(const recycling_allocator<U>&) noexcept
+        {
+        }
+
+        // room for as many blocks per class as there are classes, so that releasing a block doesn't allocate
+        struct free_lists : std::array<std::vector<void*>, classes>
+        {
+            free_lists()
+            {
+                for (auto& list : *this)
+                     list.reserve(classes);
+            }
+
+            ~free_lists()
+            {
+                for (auto& list : *this)
+                {
+                     for (auto p : list)
+                          ::operator delete(p);
+                }
+            }
+        };
+
+        static auto& lists()
+        {
+            thread_local free_lists lists;
+
+            return lists;
+        }
+
+        T* allocate(std::size_t n)
+        {
+            auto size = n * sizeof(T);
+            auto c = (size + granularity - 1) / granularity;
+
+            if (c >= classes)
+                return static_cast<T*>(::operator new(size));
+
+            if (auto& list = lists()[c]; !list.empty())
+            {
+                auto p = list.back();
+                list.pop_back();
+
+                return static_cast<T*>(p);
+            }
+
+            return static_cast<T*>(::operator new(c * granularity));
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept
+        {
+            auto c = (n * sizeof(T) + granularity - 1) / granularity;
+
+            if (c >= classes)
+                return ::operator delete(p);
+
+            lists()[c].push_back(p);
+        }
+
+        friend bool operator==(const recycling_allocator&, const recycling_allocator&) noexcept
+        {
+            return true;
+        }
+    };
+
+    struct result
+    {
+        std::string name;
+        std::string allocator;
+
+        std::size_t iterations;
+        std::size_t op_size;
+
+        double ns;
+
+        double allocations;
+        double bytes;
+
+        std::optional<double> instructions;
+        std::optional<double> cycles;
+    };
+
+    // f(n) runs n operations to completion, a tenth of them first to warm up the pools and the caches
+    template <typename F>
+    result measure(std::string name, std::string allocator, std::size_t op_size, std::size_t iterations, F&& f)
+    {
+        using clock = std::chrono::steady_clock;
+
+        f(std::max<std::size_t>(iterations / 10, 1));
+
+        perf_counter instructions(PERF_COUNT_HW_INSTRUCTIONS);
+        perf_counter cycles(PERF_COUNT_HW_CPU_CYCLES);
+
+        auto before = allocations;
+
+        instructions.start();
+        cycles.start();
+
+        auto begin = clock::now();
+        f(iterations);
+
+        auto elapsed = std::chrono::duration<double, std::nano>(clock::now() - begin).count();
+
+        auto i = instructions.stop();
+        auto c = cycles.stop();
+
+        auto n = static_cast<double>(iterations);
+        auto per_op = [n](std::optional<uint64_t> v){ return v ? std::optional<double>(*v / n) : std::nullopt; };
+
+        return {std::move(name), std::move(allocator), iterations, op_size, elapsed / n,
+                (allocations.count - before.count) / n, (allocations.bytes - before.bytes) / n, per_op(i), per_op(c)};
+    }
+
+    inline void write_json(std::ostream& out, const std::vector<result>& results, std::string_view backend, std::string_view commit)
+    {
+        auto number = [&out](std::optional<double> v)
+        {
+            if (v)
+                out << *v;
+            else
+                out << "null";
+        };
+
+        out << "{\n  \"backend\": \"" << backend << "\",\n  \"commit\": \"" << commit << "\",\n  \"results\": [\n";
+
+        for (std::size_t i = 0; i != results.size(); ++i)
+        {
+             auto& r = results[i];
+
+             out << "    {\"name\": \"" << r.name << "\", \"allocator\": \"" << r.allocator << "\", \"iterations\": " << r.iterations
+                 << ", \"op_size\": " << r.op_size << ", \"ns_per_op\": " << r.ns << ", \"allocations_per_op\": " << r.allocations
+                 << ", \"bytes_per_op\": " << r.bytes << ", \"instructions_per_op\": ";
+
+             number(r.instructions);
+             out << ", \"cycles_per_op\": ";
+
+             number(r.cycles);
+             out << (i + 1 == results.size() ? "}\n" : "},\n");
+        }
+
+        out << "  ]\n}\n";
+    }
+
+    inline void write_table(std::ostream& out, const std::vector<result>& results)
+    {
+        for (auto& r : results)
+        {
+             out << r.name << " [" << r.allocator << "]: " << r.ns << " ns/op, " << r.allocations << " allocs/op, "
+                 << r.bytes << " bytes/op, op_size " << r.op_size;
+
+             if (r.instructions)
+                 out << ", " << *r.instructions << " instructions/op";
+
+             if (r.cycles)
+                 out << ", " << *r.cycles << " cycles/op";
+
+             out << "\n";
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,512 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <array>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <unistd.h>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring bench/loadgen.cpp -o /tmp/snp-loadgen
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using local = net::local::stream_protocol;
+
+using error_code_t = boost::system::error_code;
+using steady_clock = std::chrono::steady_clock;
+
+struct options
+{
+    std::size_t connections = 16;
+    std::size_t size = 64;
+
+    // requests per second over all connections, 0 runs closed-loop
+    double rate = 0;
+
+    std::size_t seconds = 10;
+    std::size_t warmup = 1;
+
+    std::size_t threads = 1;
+    bool unix_socket = false;
+};
+
+// the timeline shared by the connections: nothing is recorded before begin, no request is sent after deadline,
+// and the responses still missing at drain are counted as errors
+struct plan
+{
+    steady_clock::time_point begin;
+    steady_clock::time_point deadline;
+    steady_clock::time_point drain;
+
+    // between two requests of a connection in open-loop
+    steady_clock::duration interval;
+};
+
+// what the connections of one thread measured
+struct stats
+{
+    snp::hdr_histogram latency;
+
+    std::size_t requests = 0;
+    std::size_t errors = 0;
+};
+
+// sends requests of a fixed size and expects them echoed back in order. closed-loop, the next request is sent once the
+// response to the previous one arrived. open-loop, requests are sent on a fixed schedule whether the responses keep up or not,
+// and the latency counts from when a request was due rather than when it could be written, so a stalled server isn't hidden
+template <typename Protocol>
+class connection
+{
+public:
+    using socket_t = typename Protocol::socket;
+    using endpoint_t = typename Protocol::endpoint;
+
+    static constexpr std::size_t max_batch = 64;
+
+    connection(net::io_context& ioc, const options& opts, const plan& p, stats& s) :
+    socket(ioc), pacer(ioc), watchdog(ioc), opts(opts), p(p), s(s), requests(opts.size * max_batch, 'x'), response(opts.size)
+    {
+    }
+
+    void start(const endpoint_t& endpoint, steady_clock::time_point first)
+    {
+        snp::async_connect(socket, std::vector<endpoint_t>{endpoint})
+        | unifex::then([this, first](const endpoint_t&)
+          {
+              if constexpr(std::is_same_v<Protocol, tcp>)
+                  socket.set_option(tcp::no_delay(true));
+
+              do_watch();
+              do_read();
+
+              if (opts.rate)
+                  do_pace(first);
+              else
+                  issue(steady_clock::now());
+          })
+        | unifex::upon_error([this]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_connect: " << error.message() << std::endl;
+
+              ++s.errors;
+          })
+        | snp::start_detached();
+    }
+
+    void issue(steady_clock::time_point due)
+    {
+        pending.push_back(due);
+        ++unwritten;
+
+        if (!writing)
+            do_write();
+    }
+
+    void do_pace(steady_clock::time_point next)
+    {
+        snp::async_wait_until(pacer, next)
+        | unifex::then([this, next]() mutable
+          {
+              auto now = steady_clock::now();
+
+              // a late wakeup sends every request that fell due in the meantime
+              for (; next <= now && next < p.deadline; next += p.interval)
+                   issue(next);
+
+              if (next < p.deadline)
+                  do_pace(next);
+              else
+                  paced = true;
+
+              if (paced && pending.empty())
+                  finish();
+          })
+        | unifex::upon_error([](auto)
+          {
+              // the connection is finished
+          })
+        | snp::start_detached();
+    }
+
+    void do_write()
+    {
+        auto n = std::min(unwritten, max_batch);
+
+        unwritten -= n;
+        writing = true;
+
+        snp::async_write(socket, net::buffer(requests.data(), n * opts.size))
+        | unifex::then([this](std::size_t)
+          {
+              writing = false;
+
+              if (unwritten)
+                  do_write();
+          })
+        | unifex::upon_error([this](auto)
+          {
+              fail();
+          })
+        | snp::start_detached();
+    }
+
+    void do_read()
+    {
+        snp::async_read(socket, net::buffer(response))
+        | unifex::then([this](std::size_t)
+          {
+              auto now = steady_clock::now();
+
+              auto due = pending.front();
+              pending.pop_front();
+
+              if (due >= p.begin)
+              {
+                  s.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(now - due).count());
+                  ++s.requests;
+              }
+
+              if (!opts.rate)
+              {
+                  if (now < p.deadline)
+                      issue(now);
+                  else
+                      paced = true;
+              }
+
+              if (paced && pending.empty())
+                  return finish();
+
+              do_read();
+          })
+        | unifex::upon_error([this](auto)
+          {
+              fail();
+          })
+        | snp::start_detached();
+    }
+
+    void do_watch()
+    {
+        snp::async_wait_until(watchdog, p.drain)
+        | unifex::then([this]
+          {
+              fail();
+          })
+        | unifex::upon_error([](auto)
+          {
+          })
+        | snp::start_detached();
+    }
+
+    // the outstanding requests are lost once the server failed or didn't answer in time
+    void fail()
+    {
+        if (done)
+            return;
+
+        s.errors += std::max<std::size_t>(pending.size(), 1);
+        finish();
+    }
+
+    void finish()
+    {
+        done = true;
+
+        pacer.cancel();
+        watchdog.cancel();
+
+        error_code_t ec;
+        socket.close(ec);
+    }
+
+private:
+    socket_t socket;
+
+    net::steady_timer pacer;
+    net::steady_timer watchdog;
+
+    const options& opts;
+    const plan& p;
+
+    stats& s;
+
+    std::string requests;
+    std::vector<char> response;
+
+    std::deque<steady_clock::time_point> pending;
+    std::size_t unwritten = 0;
+
+    bool writing = false;
+    bool paced = false;
+
+    bool done = false;
+};
+
+// echoes whatever it reads, for a run without a target
+template <typename Protocol>
+class echo_server
+{
+public:
+    using socket_t = typename Protocol::socket;
+    using endpoint_t = typename Protocol::endpoint;
+
+    struct session : std::enable_shared_from_this<session>
+    {
+        session(socket_t socket) : socket(std::move(socket))
+        {
+        }
+
+        void do_read()
+        {
+            snp::async_read_some(socket, net::buffer(buff))
+            | unifex::then([this, self = this->shared_from_this()](std::size_t n)
+              {
+                  do_write(n);
+              })
+            | unifex::upon_error([](auto)
+              {
+              })
+            | snp::start_detached();
+        }
+
+        void do_write(std::size_t n)
+        {
+            snp::async_write(socket, net::buffer(buff, n))
+            | unifex::then([this, self = this->shared_from_this()](std::size_t)
+              {
+                  do_read();
+              })
+            | unifex::upon_error([](auto)
+              {
+              })
+            | snp::start_detached();
+        }
+
+        socket_t socket;
+        std::array<char, 64 * 1024> buff;
+    };
+
+    echo_server(net::io_context& ioc, const endpoint_t& endpoint) : acceptor(ioc, endpoint)
+    {
+        do_accept();
+    }
+
+    void do_accept()
+    {
+        snp::async_accept(acceptor)
+        | unifex::then([this](socket_t socket)
+          {
+              if constexpr(std::is_same_v<Protocol, tcp>)
+                  socket.set_option(tcp::no_delay(true));
+
+              std::make_shared<session>(std::move(socket))->do_read();
+              do_accept();
+          })
+        | unifex::upon_error([](auto)
+          {
+              // the acceptor is closed
+          })
+        | snp::start_detached();
+    }
+
+    endpoint_t local_endpoint() const
+    {
+        return acceptor.local_endpoint();
+    }
+
+    typename Protocol::acceptor acceptor;
+};
+
+template <typename Protocol>
+int run(const options& opts, typename Protocol::endpoint endpoint, bool serve)
+{
+    net::io_context server_ioc;
+    std::unique_ptr<echo_server<Protocol>> server;
+
+    std::jthread server_thread;
+
+    if (serve)
+    {
+        server = std::make_unique<echo_server<Protocol>>(server_ioc, endpoint);
+        endpoint = server->local_endpoint();
+
+        server_thread = std::jthread([&server_ioc]{ server_ioc.run(); });
+    }
+
+    auto start = steady_clock::now();
+
+    plan p;
+
+    p.begin = start + std::chrono::seconds(opts.warmup);
+    p.deadline = p.begin + std::chrono::seconds(opts.seconds);
+
+    p.drain = p.deadline + std::chrono::seconds(2);
+    p.interval = std::chrono::duration_cast<steady_clock::duration>(std::chrono::duration<double>(opts.rate ? opts.connections / opts.rate : 0));
+
+    std::vector<std::unique_ptr<net::io_context>> contexts;
+    std::vector<stats> thread_stats(opts.threads);
+
+    for (std::size_t i = 0; i != opts.threads; ++i)
+         contexts.push_back(std::make_unique<net::io_context>(1));
+
+    std::vector<std::unique_ptr<connection<Protocol>>> connections;
+
+    for (std::size_t i = 0; i != opts.connections; ++i)
+    {
+         auto t = i % opts.threads;
+
+         connections.push_back(std::make_unique<connection<Protocol>>(*contexts[t], opts, p, thread_stats[t]));
+
+         // spreads the first requests over an interval, so that the connections don't send in lockstep
+         connections.back()->start(endpoint, start + p.interval * i / opts.connections);
+    }
+
+    {
+        std::vector<std::jthread> threads;
+
+        for (auto& ioc : contexts)
+             threads.emplace_back([&ioc]{ ioc->run(); });
+    }
+
+    stats total;
+
+    for (auto& s : thread_stats)
+    {
+         total.latency.merge(s.latency);
+
+         total.requests += s.requests;
+         total.errors += s.errors;
+    }
+
+    auto elapsed = std::chrono::duration<double>(p.deadline - p.begin).count();
+    auto us = [&](uint64_t ns){ return ns / 1000.0; };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "snp-loadgen: " << opts.connections << " connections to " << endpoint << " over " << (opts.unix_socket ? "unix" : "tcp") << ", "
+              << opts.size << " byte requests, ";
+
+    if (opts.rate)
+        std::cout << "open-loop at " << opts.rate << " req/s";
+    else
+        std::cout << "closed-loop";
+
+    std::cout << ", " << opts.threads << " threads, " << opts.warmup << "s warmup + " << opts.seconds << "s" << std::endl;
+    std::cout << "  " << total.requests << " requests, " << total.errors << " errors" << std::endl;
+
+    std::cout << "  Throughput: " << total.requests / elapsed << " req/s, " << total.requests * opts.size / elapsed / (1024.0 * 1024.0) << " MB/s" << std::endl;
+    std::cout << "  Latency (us): p50 " << us(total.latency.value_at_percentile(50)) << ", p99 " << us(total.latency.value_at_percentile(99))
+              << ", p99.9 " << us(total.latency.value_at_percentile(99.9)) << ", max " << us(total.latency.max())
+              << ", mean " << total.latency.mean() / 1000.0 << std::endl;
+
+    server_ioc.stop();
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    options opts;
+    std::vector<std::string> targets;
+
+    auto usage = [&]
+    {
+        std::cerr << "Usage: " << argv[0] << " [--connections <n>] [--size <bytes>] [--rate <requests/s>] [--seconds <n>] [--warmup <n>] [--threads <n>] [--unix] "
+                  << "[<address> <port> | <path>]" << std::endl;
+        std::cerr << "Without a target, an in-process echo server is started on loopback, or on a unix socket with --unix" << std::endl;
+
+        return 1;
+    };
+
+    try
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+             std::string_view arg = argv[i];
+
+             auto value = [&]
+             {
+                 if (i + 1 == argc)
+                     throw std::invalid_argument(std::string(arg));
+
+                 return std::string(argv[++i]);
+             };
+
+             if (arg == "--connections")
+                 opts.connections = std::stoul(value());
+             else if (arg == "--size")
+                 opts.size = std::stoul(value());
+             else if (arg == "--rate")
+                 opts.rate = std::stod(value());
+             else if (arg == "--seconds")
+                 opts.seconds = std::stoul(value());
+             else if (arg == "--warmup")
+                 opts.warmup = std::stoul(value());
+             else if (arg == "--threads")
+                 opts.threads = std::stoul(value());
+             else if (arg == "--unix")
+                 opts.unix_socket = true;
+             else if (arg.starts_with("--"))
+                 return usage();
+             else
+                 targets.emplace_back(arg);
+        }
+    }
+    catch (std::exception&)
+    {
+        return usage();
+    }
+
+    if (targets.size() > 2 || !opts.connections || !opts.size || !opts.threads || opts.rate < 0)
+        return usage();
+
+    opts.threads = std::min(opts.threads, opts.connections);
+
+    try
+    {
+        if (targets.size() == 2)
+            return run<tcp>(opts, tcp::endpoint(net::ip::make_address(targets[0]), std::stoi(targets[1])), false);
+
+        if (targets.size() == 1)
+        {
+            opts.unix_socket = true;
+
+            return run<local>(opts, local::endpoint(targets[0]), false);
+        }
+
+        if (!opts.unix_socket)
+            return run<tcp>(opts, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0), true);
+
+        auto path = "/tmp/snp-loadgen-" + std::to_string(getpid()) + ".sock";
+        std::remove(path.c_str());
+
+        auto r = run<local>(opts, local::endpoint(path), true);
+        std::remove(path.c_str());
+
+        return r;
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 1;
+}
@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef LOOP_HPP
+#define LOOP_HPP
+
+#include <iostream>
+#include <exception>
+#include <type_traits>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+namespace snp::bench
+{
+    // starts the sender make returns once the previous one completed, until n of them did, none if n is 0,
+    // a sender completing inline is restarted by the outer call instead of recursing into it
+    template <typename Alloc, typename Make>
+    struct loop
+    {
+        void operator()()
+        {
+            if (!remaining)
+                return;
+
+            if (running)
+            {
+                pending = true;
+
+                return;
+            }
+
+            running = true;
+
+            do
+            {
+                pending = false;
+                start();
+            } while (pending);
+
+            running = false;
+        }
+
+        void start()
+        {
+            make()
+            | unifex::then([this](auto&&...)
+              {
+                  if (--remaining)
+                      (*this)();
+              })
+            | unifex::upon_error([]<typename Error>(Error error)
+              {
+                  if constexpr(std::is_same_v<Error, boost::system::error_code>)
+                      std::cerr << "bench: " << error.message() << std::endl;
+
+                  std::terminate();
+              })
+            | snp::start_detached(alloc);
+        }
+
+        Alloc alloc;
+        Make& make;
+
+        std::size_t remaining;
+
+        bool running = false;
+        bool pending = false;
+    };
+}
+
+#endif
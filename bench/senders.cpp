@@ -0,0 +1,629 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#include <list>
+#include <fstream>
+#include <iostream>
+#include <functional>
+#include <sys/socket.h>
+#include <openssl/x509.h>
+#include <boost/asio/ssl.hpp>
+#include <snp.hpp>
+#include <async_handshake_offload.hpp>
+#include <unifex/just.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include "bench.hpp"
+#include "loop.hpp"
+
+// the backend is chosen by the build, bench_io_uring defines BOOST_ASIO_HAS_IO_URING and BOOST_ASIO_DISABLE_EPOLL,
+// bench_epoll defines neither, the peer side of every operation is done with plain syscalls outside of snp
+
+#ifndef SNP_BENCH_COMMIT
+#define SNP_BENCH_COMMIT "unknown"
+#endif
+
+namespace net = boost::asio;
+namespace ssl = net::ssl;
+namespace http = snp::http;
+
+using tcp = net::ip::tcp;
+using udp = net::ip::udp;
+
+using local = net::local::stream_protocol;
+using error_code_t = boost::system::error_code;
+
+#if defined(BOOST_ASIO_HAS_IO_URING) && defined(BOOST_ASIO_DISABLE_EPOLL)
+constexpr const char* backend = "io_uring";
+#else
+constexpr const char* backend = "epoll";
+#endif
+
+// takes the place of the receiver of start_detached, which is two pointers wide, to tell the size of the operation state of a sender
+struct sink
+{
+    template <typename... Values>
+    void set_value(Values&&...) noexcept
+    {
+    }
+
+    template <typename Error>
+    void set_error(Error&&) noexcept
+    {
+    }
+
+    void set_done() noexcept
+    {
+    }
+
+    void* op;
+    void (*deleter)(void*) noexcept;
+};
+
+template <typename Sender>
+using op_t = unifex::connect_result_t<Sender, sink>;
+
+struct suite
+{
+    suite(std::size_t iterations, std::string filter) : iterations(iterations), filter(std::move(filter))
+    {
+    }
+
+    // a benchmark scaled down runs at least once
+    std::size_t scaled(std::size_t scale) const noexcept
+    {
+        return std::max<std::size_t>(iterations / scale, 1);
+    }
+
+    bool selected(std::string_view name) const
+    {
+        return filter.empty() || name.find(filter) != name.npos;
+    }
+
+    // measures a sender factory with start_detached on std::allocator and on a recycling allocator
+    template <typename Make>
+    void add(std::string name, std::size_t scale, Make make)
+    {
+        if (!selected(name))
+            return;
+
+        auto size = sizeof(op_t<decltype(make())>);
+
+        auto run = [&]<typename Alloc>(Alloc alloc)
+        {
+            return [&, alloc](std::size_t n)
+            {
+                snp::bench::loop<Alloc, Make> l{alloc, make, n};
+                l();
+
+                ioc.run();
+                ioc.restart();
+            };
+        };
+
+        results.push_back(snp::bench::measure(name, "std", size, scaled(scale), run(std::allocator<std::byte>())));
+        results.push_back(snp::bench::measure(name, "recycling", size, scaled(scale), run(snp::bench::recycling_allocator<std::byte>())));
+    }
+
+    // measures the same operation as a plain asio callback, the baseline the overhead of snp is read against,
+    // f(n) runs the io_context itself
+    void baseline(std::string name, std::size_t scale, std::function<void(std::size_t)> f)
+    {
+        if (!selected(name))
+            return;
+
+        results.push_back(snp::bench::measure(name, "asio", 0, scaled(scale), [&](std::size_t n)
+        {
+            f(n);
+            ioc.restart();
+        }));
+    }
+
+    net::io_context ioc;
+
+    std::size_t iterations;
+    std::string filter;
+
+    std::vector<snp::bench::result> results;
+};
+
+constexpr std::size_t payload = 64;
+
+using snp::bench::drain;
+
+void bench_schedule(suite& s)
+{
+    snp::asio_scheduler sch(s.ioc);
+
+    s.add("schedule", 1, [sch]() mutable
+    {
+        return unifex::schedule(sch);
+    });
+
+    s.add("schedule_after", 1, [sch]() mutable
+    {
+        return unifex::schedule_after(sch, std::chrono::nanoseconds(0));
+    });
+
+    s.baseline("asio::post", 1, [&](std::size_t n)
+    {
+        std::function<void()> f = [&]
+        {
+            if (--n)
+                net::post(s.ioc, [&]{ f(); });
+        };
+
+        net::post(s.ioc, [&]{ f(); });
+        s.ioc.run();
+    });
+}
+
+void bench_timer(suite& s)
+{
+    static net::steady_timer timer(s.ioc);
+
+    s.add("async_wait", 1, []
+    {
+        return snp::async_wait(timer, std::chrono::nanoseconds(0));
+    });
+
+    s.add("async_wait_until", 1, []
+    {
+        return snp::async_wait_until(timer, std::chrono::steady_clock::now());
+    });
+
+    s.baseline("asio::steady_timer::async_wait", 1, [&](std::size_t n)
+    {
+        std::function<void(error_code_t)> f = [&](error_code_t)
+        {
+            if (--n)
+            {
+                timer.expires_after(std::chrono::nanoseconds(0));
+                timer.async_wait([&](error_code_t ec){ f(ec); });
+            }
+        };
+
+        timer.expires_after(std::chrono::nanoseconds(0));
+        timer.async_wait([&](error_code_t ec){ f(ec); });
+
+        s.ioc.run();
+    });
+}
+
+void bench_stream(suite& s)
+{
+    static local::socket a(s.ioc), b(s.ioc);
+    net::local::connect_pair(a, b);
+
+    static char data[payload] = {};
+    static char buffer[4096];
+
+    static bool written = false;
+
+    // the bytes written by the previous operation are read by the peer first
+    auto peer_read = []
+    {
+        if (std::exchange(written, true))
+            drain(b.native_handle(), payload);
+    };
+
+    auto peer_write = []
+    {
+        written = false;
+        auto n = ::write(b.native_handle(), data, payload);
+
+        (void)n;
+    };
+
+    s.add("async_write_some", 1, [peer_read]
+    {
+        peer_read();
+
+        return snp::async_write_some(a, net::buffer(data));
+    });
+
+    drain(b.native_handle(), payload * written);
+    written = false;
+
+    s.add("async_write", 1, [peer_read]
+    {
+        peer_read();
+
+        return snp::async_write(a, net::buffer(data));
+    });
+
+    drain(b.native_handle(), payload * written);
+    written = false;
+
+    s.add("async_read_some", 1, [peer_write]
+    {
+        peer_write();
+
+        return snp::async_read_some(a, net::buffer(buffer, payload));
+    });
+
+    s.add("async_read", 1, [peer_write]
+    {
+        peer_write();
+
+        return snp::async_read(a, net::buffer(buffer, payload));
+    });
+
+    s.baseline("asio::async_read_some", 1, [&](std::size_t n)
+    {
+        std::function<void(error_code_t, std::size_t)> f = [&](error_code_t, std::size_t)
+        {
+            if (--n)
+            {
+                peer_write();
+                a.async_read_some(net::buffer(buffer, payload), [&](error_code_t ec, std::size_t m){ f(ec, m); });
+            }
+        };
+
+        peer_write();
+        a.async_read_some(net::buffer(buffer, payload), [&](error_code_t ec, std::size_t m){ f(ec, m); });
+
+        s.ioc.run();
+    });
+}
+
+void bench_framing(suite& s)
+{
+    static local::socket a(s.ioc), b(s.ioc);
+    net::local::connect_pair(a, b);
+
+    static snp::buffered_stream<local::socket&> stream(a);
+    static snp::framed_reader<snp::fixed_codec<4>> frames;
+
+    static http::request_reader requests;
+    static http::response_writer responses;
+
+    static std::string line(payload - 2, 'x');
+    static std::string frame(payload, 'x');
+
+    static std::string request = "GET /plaintext HTTP/1.1\r\nHost: localhost\r\nAccept: */*\r\n\r\n";
+
+    line += "\r\n";
+    snp::fixed_codec<4>::encode(frame.data(), payload - 4);
+
+    auto peer_write = [](const std::string& data)
+    {
+        auto n = ::write(b.native_handle(), data.data(), data.size());
+
+        (void)n;
+    };
+
+    s.add("async_read_until", 1, [peer_write]
+    {
+        peer_write(line);
+
+        return snp::async_read_until(stream, "\r\n");
+    });
+
+    s.add("async_read_frames", 1, [peer_write]
+    {
+        peer_write(frame);
+
+        return snp::async_read_frames(a, frames);
+    });
+
+    s.add("async_read_request", 1, [peer_write]
+    {
+        peer_write(request);
+
+        return http::async_read_request(a, requests);
+    });
+
+    static http::response res;
+    res.body = "Hello, World!";
+
+    static std::size_t pending = 0;
+
+    s.add("async_write_response", 1, []
+    {
+        drain(b.native_handle(), std::exchange(pending, 0));
+
+        responses.add(res, 11, true);
+        pending = responses.size();
+
+        return http::async_write_response(a, responses);
+    });
+}
+
+void bench_datagram(suite& s)
+{
+    static udp::socket a(s.ioc, udp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    static udp::socket b(s.ioc, udp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+
+    static udp::endpoint sender;
+    static udp::endpoint to = a.local_endpoint();
+
+    static char data[payload] = {};
+
+    static char buffer[payload];
+    static constexpr std::size_t batch = 16;
+
+    static snp::datagram_reader reader(batch, payload);
+    static snp::datagram_writer writer(batch * payload);
+
+    auto peer_send = [](std::size_t n)
+    {
+        for (std::size_t i = 0; i != n; ++i)
+             ::sendto(b.native_handle(), data, payload, 0, to.data(), to.size());
+    };
+
+    auto peer_receive = [](std::size_t n)
+    {
+        for (std::size_t i = 0; i != n; ++i)
+             ::recv(b.native_handle(), buffer, payload, 0);
+    };
+
+    static std::size_t pending = 0;
+
+    s.add("async_send_to", 1, [peer_receive]
+    {
+        peer_receive(std::exchange(pending, 1));
+
+        return snp::async_send_to(a, net::buffer(data), b.local_endpoint());
+    });
+
+    peer_receive(std::exchange(pending, 0));
+
+    s.add("async_receive_from", 1, [peer_send]
+    {
+        peer_send(1);
+
+        return snp::async_receive_from(a, net::buffer(buffer), sender);
+    });
+
+    s.add("async_send_batch(16)", 1, [peer_receive]
+    {
+        peer_receive(std::exchange(pending, batch));
+
+        for (std::size_t i = 0; i != batch; ++i)
+             writer.add(b.local_endpoint(), net::buffer(data));
+
+        return snp::async_send_batch(a, writer);
+    });
+
+    peer_receive(std::exchange(pending, 0));
+
+    s.add("async_receive_batch(16)", 1, [peer_send]
+    {
+        peer_send(batch);
+
+        return snp::async_receive_batch(a, reader);
+    });
+}
+
+void bench_connection(suite& s)
+{
+    static tcp::acceptor acceptor(s.ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    static tcp::socket socket(s.ioc);
+
+    static std::vector<tcp::endpoint> endpoints{acceptor.local_endpoint()};
+
+    static tcp::socket peer(s.ioc);
+
+    // a hundredth of the iterations, every connection leaves a TIME_WAIT behind on loopback
+
+    s.add("async_accept", 100, []
+    {
+        peer.close();
+        peer.connect(acceptor.local_endpoint());
+
+        return snp::async_accept(acceptor);
+    });
+
+    auto peer_accept = []
+    {
+        if (socket.is_open())
+            acceptor.accept().close();
+
+        socket.close();
+    };
+
+    s.add("async_connect", 100, [peer_accept]
+    {
+        peer_accept();
+
+        return snp::async_connect(socket, endpoints);
+    });
+
+    s.add("async_connect_race", 100, [peer_accept]
+    {
+        peer_accept();
+
+        return snp::async_connect_race(socket, endpoints);
+    });
+
+    peer_accept();
+    peer.close();
+}
+
+void bench_close(suite& s)
+{
+    static local::socket socket(s.ioc);
+    static auto ex = s.ioc.get_executor();
+
+    s.add("async_close", 1, []
+    {
+        socket.open();
+
+        return snp::async_close(socket, ex);
+    });
+}
+
+// a self-signed certificate made at startup, so the handshakes need no files
+void use_self_signed(ssl::context& ctx)
+{
+    auto key = EVP_EC_gen("P-256");
+    auto cert = X509_new();
+
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+
+    auto name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+
+    X509_set_issuer_name(cert, name);
+    X509_set_pubkey(cert, key);
+
+    X509_sign(cert, key, EVP_sha256());
+
+    SSL_CTX_use_certificate(ctx.native_handle(), cert);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), key);
+
+    X509_free(cert);
+    EVP_PKEY_free(key);
+}
+
+void bench_tls(suite& s)
+{
+    static ssl::context server_ctx(ssl::context::tls_server);
+    static ssl::context client_ctx(ssl::context::tls_client);
+
+    static net::thread_pool pool(1);
+    static net::io_context& ioc = s.ioc;
+
+    use_self_signed(server_ctx);
+
+    // a connection per handshake, it is kept until the handshake of the peer is done as well
+    struct connection
+    {
+        connection() : server(ioc, server_ctx), client(ioc, client_ctx)
+        {
+            net::local::connect_pair(server.next_layer(), client.next_layer());
+        }
+
+        ssl::stream<local::socket> server;
+        ssl::stream<local::socket> client;
+
+        bool done = false;
+    };
+
+    static std::list<connection> connections;
+
+    // a hundredth of the iterations, a full handshake costs as much as thousands of reads
+    s.add("async_handshake_offload", 100, []
+    {
+        std::erase_if(connections, [](auto& c){ return c.done; });
+        auto& c = connections.emplace_back();
+
+        c.client.async_handshake(ssl::stream_base::client, [&c](error_code_t)
+        {
+            c.done = true;
+        });
+
+        return snp::async_handshake_offload(c.server, ssl::stream_base::server, pool.get_executor());
+    });
+
+    connections.clear();
+}
+
+void bench_resolve(suite& s)
+{
+    static snp::resolver_cache cache(s.ioc);
+
+    static std::string host = "127.0.0.1";
+    static std::string service = "80";
+
+    s.add("async_resolve", 1, []
+    {
+        return snp::async_resolve(cache, host, service);
+    });
+}
+
+void bench_hedge(suite& s)
+{
+    snp::asio_scheduler sch(s.ioc);
+    static snp::hedge_policy policy(std::chrono::milliseconds(10));
+
+    s.add("hedge", 1, [sch]
+    {
+        return snp::hedge(sch, []{ return unifex::just(1); }, policy);
+    });
+}
+
+void bench_file(suite& s)
+{
+#ifdef BOOST_ASIO_HAS_FILE
+    static net::random_access_file file(s.ioc, "/tmp/snp_bench_file", net::random_access_file::read_write | net::random_access_file::create);
+    static char data[4096] = {};
+
+    s.add("async_write_some_at", 1, []
+    {
+        return snp::async_write_some_at(file, 0, net::buffer(data));
+    });
+
+    s.add("async_read_some_at", 1, []
+    {
+        return snp::async_read_some_at(file, 0, net::buffer(data));
+    });
+#endif
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t iterations = 100000;
+
+    std::string json;
+    std::string filter;
+
+    for (int i = 1; i < argc; ++i)
+    {
+         std::string_view arg(argv[i]);
+
+         if (arg == "--json" && i + 1 < argc)
+             json = argv[++i];
+         else if (arg == "--filter" && i + 1 < argc)
+             filter = argv[++i];
+         else if (arg == "--iterations" && i + 1 < argc)
+             iterations = std::stoul(argv[++i]);
+         else
+         {
+             std::cerr << "Usage: " << argv[0] << " [--json <file>] [--filter <name>] [--iterations <n>]" << std::endl;
+
+             return 1;
+         }
+    }
+
+    // constructed before the sockets and timers the benchmarks keep in statics, so its io_context outlives them
+    static suite s(iterations, filter);
+
+    bench_schedule(s);
+    bench_timer(s);
+
+    bench_stream(s);
+    bench_framing(s);
+
+    bench_datagram(s);
+    bench_connection(s);
+
+    bench_close(s);
+    bench_tls(s);
+
+    bench_resolve(s);
+    bench_hedge(s);
+
+    bench_file(s);
+
+    snp::bench::write_table(std::cout, s.results);
+
+    if (!json.empty())
+    {
+        std::ofstream out(json);
+        snp::bench::write_json(out, s.results, backend, SNP_BENCH_COMMIT);
+    }
+
+    return 0;
+}
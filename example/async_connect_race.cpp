@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/async_connect_race.cpp -o /tmp/async_connect_race
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using socket_t = tcp::socket;
+
+using error_code_t = boost::system::error_code;
+using steady_clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <delay ms>" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    auto& ioc = ctx.get_io_context();
+
+    auto loopback = net::ip::make_address("127.0.0.1");
+
+    // a listener with a full backlog never answers the syn, it behaves like a blackholed address
+    tcp::acceptor blackhole(ioc, tcp::endpoint(loopback, 0));
+    blackhole.listen(0);
+
+    std::vector<socket_t> backlog;
+
+    for (int i = 0; i != 4; ++i)
+    {
+         auto& s = backlog.emplace_back(ioc);
+         auto ep = blackhole.local_endpoint();
+
+         s.open(tcp::v4());
+         s.non_blocking(true);
+
+         ::connect(s.native_handle(), ep.data(), ep.size());
+    }
+
+    tcp::acceptor live(ioc, tcp::endpoint(loopback, 0));
+
+    std::vector<tcp::endpoint> endpoints{blackhole.local_endpoint(), tcp::endpoint(net::ip::make_address("::1"), 1), live.local_endpoint()};
+    auto results = tcp::resolver::results_type::create(endpoints.begin(), endpoints.end(), "localhost", "");
+
+    socket_t socket(ioc);
+
+    auto begin = steady_clock::now();
+    auto delay = std::chrono::milliseconds(std::stoi(argv[1]));
+
+    snp::async_connect_race(socket, results, delay)
+    | unifex::then([&](const tcp::endpoint& endpoint)
+      {
+          auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(steady_clock::now() - begin);
+          std::cout << "connected to " << endpoint << " in " << elapsed.count() << " ms" << std::endl;
+      })
+    | unifex::upon_error([](auto&& error)
+      {
+          if constexpr(std::is_same_v<std::decay_t<decltype(error)>, error_code_t>)
+              std::cout << "async_connect_race: " << error.message() << std::endl;
+      })
+    | snp::start_detached();
+
+    ctx.run();
+
+    return 0;
+}
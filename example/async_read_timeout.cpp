@@ -0,0 +1,85 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/just.hpp>
+#include <unifex/then.hpp>
+#include <unifex/let_done.hpp>
+#include <unifex/stop_when.hpp>
+#include <unifex/upon_error.hpp>
+#include <unifex/scheduler_concepts.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/async_read_timeout.cpp -o /tmp/async_read_timeout
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using socket_t = tcp::socket;
+
+using error_code_t = boost::system::error_code;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <seconds>" << std::endl;
+
+        return 1;
+    }
+
+    bool timed_out = false;
+    snp::asio_context ctx;
+
+    auto sch = ctx.get_scheduler();
+    auto& ioc = ctx.get_io_context();
+
+    tcp::acceptor acceptor(ioc, tcp::endpoint(tcp::v4(), 0));
+    socket_t client(ioc);
+
+    client.connect(acceptor.local_endpoint());
+    socket_t server = acceptor.accept();
+
+    char data[64];
+    auto duration = std::chrono::seconds(std::stoi(argv[1]));
+
+    unifex::stop_when(snp::async_read(client, net::buffer(data)), unifex::schedule_after(sch, duration))
+    | unifex::let_done([&]
+      {
+          timed_out = true;
+
+          return unifex::just(std::size_t(0));
+      })
+    | unifex::then([&](std::size_t bytes_transferred)
+      {
+          std::cout << "async_read " << (timed_out ? "timed out" : "completed") << std::endl;
+      })
+    | unifex::upon_error([]<typename Error>(Error error)
+      {
+          if constexpr(std::is_same_v<Error, error_code_t>)
+              std::cout << "async_read: " << error.message() << std::endl;
+      })
+    | snp::start_detached();
+
+    auto begin = std::chrono::steady_clock::now();
+
+    ctx.run();
+
+    auto end = std::chrono::steady_clock::now();
+    auto dur = std::chrono::duration_cast<std::chrono::seconds>(end - begin).count();
+
+    std::cout << "context elapsed " << dur << " seconds" << std::endl;
+
+    assert(timed_out);
+
+    return 0;
+}
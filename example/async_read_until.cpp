@@ -0,0 +1,129 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <memory>
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/async_read_until.cpp -o /tmp/async_read_until
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using socket_t = tcp::socket;
+
+using endpoint_t = tcp::endpoint;
+using error_code_t = boost::system::error_code;
+
+using steady_clock = std::chrono::steady_clock;
+using stream_t = snp::buffered_stream<socket_t>;
+
+class line_counter
+{
+public:
+    line_counter(socket_t socket) : stream(std::move(socket))
+    {
+    }
+
+    void start()
+    {
+        begin = steady_clock::now();
+        do_read();
+    }
+
+    void do_read()
+    {
+        snp::async_read_until(stream, "\r\n")
+        | unifex::then([this](std::string_view line)
+          {
+              ++lines;
+              bytes += line.size();
+
+              do_read();
+          })
+        | unifex::upon_error([this]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  if (error != net::error::eof)
+                      std::cerr << "read: " << error.message() << std::endl;
+
+              report();
+          })
+        | snp::start_detached();
+    }
+
+    void report()
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin).count();
+
+        std::cout << "lines " << lines << " bytes " << bytes << " in " << elapsed << " us, " << lines * 1000000 / std::max<long>(elapsed, 1) << " lines/s" << std::endl;
+    }
+
+private:
+    stream_t stream;
+    steady_clock::time_point begin;
+
+    std::size_t lines = 0;
+    std::size_t bytes = 0;
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <lines> <length>" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    auto& ioc = ctx.get_io_context();
+
+    tcp::acceptor acceptor(ioc, endpoint_t(net::ip::make_address("127.0.0.1"), 0));
+    socket_t client(ioc);
+
+    std::unique_ptr<line_counter> counter;
+
+    snp::async_accept(acceptor)
+    | unifex::then([&counter](socket_t socket)
+      {
+          counter = std::make_unique<line_counter>(std::move(socket));
+          counter->start();
+      })
+    | snp::start_detached();
+
+    std::string line(std::stoul(argv[2]), 'x');
+    line += "\r\n";
+
+    std::string lines;
+
+    for (std::size_t i = 0, n = std::stoul(argv[1]); i != n; ++i)
+         lines += line;
+
+    snp::async_connect(client, std::vector{acceptor.local_endpoint()})
+    | unifex::then([&](endpoint_t)
+      {
+          snp::async_write(client, net::buffer(lines))
+          | unifex::then([&](std::size_t)
+            {
+                client.shutdown(socket_t::shutdown_send);
+            })
+          | snp::start_detached();
+      })
+    | snp::start_detached();
+
+    ctx.run();
+
+    return 0;
+}
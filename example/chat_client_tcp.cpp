@@ -32,6 +32,7 @@ using error_code_t = boost::system::error_code;
 
 using results_type = tcp::resolver::results_type;
 using chat_message_queue = std::deque<chat_message>;
+using chat_reader = snp::framed_reader<snp::ascii_codec<chat_message::header_length>>;
 
 class chat_client
 {
@@ -131,57 +132,32 @@ private:
 
     void on_connect()
     {
-        do_read_header();
+        do_read();
     }
 
-    void do_read_header()
+    void do_read()
     {
-        snp::async_read(socket, net::buffer(read_msg_.data(), chat_message::header_length))
-        | unifex::then([this](std::size_t bytes_transferred)
+        snp::async_read_frames(socket, reader)
+        | unifex::then([this](std::span<const std::string_view> frames)
           {
-              on_read_header();
+              on_read(frames);
           })
         | unifex::upon_error([this]<typename Error>(Error error)
           {
               if constexpr(std::is_same_v<Error, error_code_t>)
-                  std::cerr << "async_read: " << error.message() << std::endl;
+                  std::cerr << "async_read_frames: " << error.message() << std::endl;
 
               socket.close();
           })
         | snp::start_detached();
     }
 
-    void on_read_header()
+    void on_read(std::span<const std::string_view> frames)
     {
-        if (read_msg_.decode_header())
-            do_read_body();
-        else
-            socket.close();
-    }
-
-    void do_read_body()
-    {
-        snp::async_read(socket, net::buffer(read_msg_.body(), read_msg_.body_length()))
-        | unifex::then([this](std::size_t bytes_transferred)
-          {
-              on_read_body();
-          })
-        | unifex::upon_error([this]<typename Error>(Error error)
-          {
-              if constexpr(std::is_same_v<Error, error_code_t>)
-                  std::cerr << "async_read: " << error.message() << std::endl;
-
-              socket.close();
-          })
-        | snp::start_detached();
-    }
-
-    void on_read_body()
-    {
-        std::cout.write(read_msg_.body(), read_msg_.body_length());
-        std::cout << std::endl;
+        for (auto frame : frames)
+             std::cout << frame << std::endl;
 
-        do_read_header();
+        do_read();
     }
 
     void do_write()
@@ -221,7 +197,7 @@ private:
     std::string host;
     std::string port;
 
-    chat_message read_msg_;
+    chat_reader reader{4096, {chat_message::max_body_length}};
     chat_message_queue write_msgs_;
 };
 
@@ -48,7 +48,7 @@ class chat_client
 {
 public:
     chat_client(snp::asio_context& ctx, const std::string& host, const std::string& port) :
-    ctx(ctx), ioc(ctx.get_io_context()), sch(ctx.get_scheduler()), socket(net::make_strand(ioc)), host(host), port(port)
+    ctx(ctx), ioc(ctx.get_io_context()), sch(ctx.get_strand_scheduler()), socket(sch.get_executor()), host(host), port(port)
     {
         do_resolve();
     }
@@ -236,7 +236,7 @@ private:
     snp::asio_context& ctx;
     net::io_context& ioc;
 
-    snp::asio_scheduler sch;
+    snp::strand_scheduler sch;
     socket_t socket;
 
     std::string host;
@@ -10,9 +10,7 @@
 #define BOOST_ASIO_HAS_IO_URING
 #define BOOST_ASIO_DISABLE_EPOLL
 
-#include <set>
 #include <list>
-#include <deque>
 #include <iostream>
 #include <snp.hpp>
 #include <unifex/then.hpp>
@@ -28,50 +26,17 @@ using tcp = net::ip::tcp;
 using socket_t = tcp::socket;
 
 using error_code_t = boost::system::error_code;
-using chat_message_queue = std::deque<chat_message>;
+using chat_reader = snp::framed_reader<snp::ascii_codec<chat_message::header_length>>;
 
 class chat_participant
 {
 public:
     virtual ~chat_participant(){}
-    virtual void deliver(const chat_message& msg) = 0;
+    virtual void deliver(const snp::shared_buffer& msg) = 0;
 };
 
 using chat_participant_ptr = std::shared_ptr<chat_participant>;
-
-class chat_room
-{
-public:
-    void join(chat_participant_ptr participant)
-    {
-        participants_.insert(participant);
-
-        for (auto& msg: recent_msgs_)
-             participant->deliver(msg);
-    }
-
-    void leave(chat_participant_ptr participant)
-    {
-        participants_.erase(participant);
-    }
-
-    void deliver(const chat_message& msg)
-    {
-        recent_msgs_.push_back(msg);
-
-        while (recent_msgs_.size() > max_recent_msgs)
-               recent_msgs_.pop_front();
-
-        for (auto& participant: participants_)
-             participant->deliver(msg);
-    }
-
-private:
-    chat_message_queue recent_msgs_;
-    static constexpr int max_recent_msgs = 100;
-
-    std::set<chat_participant_ptr> participants_;
-};
+using chat_room = snp::broadcast_channel<chat_participant_ptr>;
 
 class chat_session : public chat_participant, public std::enable_shared_from_this<chat_session>
 {
@@ -82,73 +47,52 @@ public:
 
     void start()
     {
-        room.join(shared_from_this());
-        do_read_header();
+        room.subscribe(shared_from_this());
+        do_read();
     }
 
-    void deliver(const chat_message& msg)
+    void deliver(const snp::shared_buffer& msg)
     {
-        bool write_in_progress = !write_msgs_.empty();
-        write_msgs_.push_back(msg);
-
-        if (!write_in_progress)
+        if (write_msgs_.push(msg))
             do_write();
     }
 
 private:
-    void do_read_header()
+    void do_read()
     {
-        snp::async_read(socket_, net::buffer(read_msg_.data(), chat_message::header_length)) 
-        | unifex::then([this, self = shared_from_this()](std::size_t bytes_transferred)
+        snp::async_read_frames(socket_, reader)
+        | unifex::then([this, self = shared_from_this()](std::span<const std::string_view> frames)
           {
-              on_read_header();
+              on_read(frames);
           })
         | unifex::upon_error([this, self = shared_from_this()]<typename Error>(Error error)
           {
               if constexpr(std::is_same_v<Error, error_code_t>)
-                  std::cerr << "async_read: " << error.message() << std::endl;
+                  std::cerr << "async_read_frames: " << error.message() << std::endl;
 
-              room.leave(shared_from_this());
+              room.unsubscribe(shared_from_this());
           })
         | snp::start_detached();
     }
 
-    void on_read_header()
+    void on_read(std::span<const std::string_view> frames)
     {
-        if (read_msg_.decode_header())
-            do_read_body();
-        else
-            room.leave(shared_from_this());
-    }
+        for (auto frame : frames)
+        {
+             snp::shared_buffer msg(chat_message::header_length + frame.size());
 
-    void do_read_body()
-    {
-        snp::async_read(socket_, net::buffer(read_msg_.body(), read_msg_.body_length()))
-        | unifex::then([this, self = shared_from_this()](std::size_t bytes_transferred)
-          {
-              on_read_body();
-          })
-        | unifex::upon_error([this, self = shared_from_this()]<typename Error>(Error error)
-          {
-              if constexpr(std::is_same_v<Error, error_code_t>)
-                  std::cerr << "async_read: " << error.message() << std::endl;
+             auto n = reader.codec.encode(msg.data(), frame.size());
+             std::memcpy(msg.data() + n, frame.data(), frame.size());
 
-              room.leave(shared_from_this());
-          })
-        | snp::start_detached();
-    }
+             room.publish(msg);
+        }
 
-    void on_read_body()
-    {
-        room.deliver(read_msg_);
-        do_read_header();
+        do_read();
     }
 
     void do_write()
     {
-        auto& msg = write_msgs_.front();
-
-        snp::async_write(socket_, net::buffer(msg.data(), msg.length()))
+        snp::async_write(socket_, write_msgs_.gather())
         | unifex::then([this, self = shared_from_this()](std::size_t bytes_transferred)
           {
               on_write();
@@ -158,24 +102,22 @@ private:
               if constexpr(std::is_same_v<Error, error_code_t>)
                   std::cerr << "async_write: " << error.message() << std::endl;
 
-              room.leave(shared_from_this());
+              room.unsubscribe(shared_from_this());
           })
         | snp::start_detached();
     }
 
     void on_write()
     {
-        write_msgs_.pop_front();
-
-        if (!write_msgs_.empty())
+        if (write_msgs_.written())
             do_write();
     }
 
     socket_t socket_;
     chat_room& room;
 
-    chat_message read_msg_;
-    chat_message_queue write_msgs_;
+    chat_reader reader{4096, {chat_message::max_body_length}};
+    snp::broadcast_queue write_msgs_;
 };
 
 class chat_server
@@ -210,7 +152,7 @@ private:
         do_accept();
     }
 
-    chat_room room;
+    chat_room room{100};
     tcp::acceptor acceptor;
 };
 
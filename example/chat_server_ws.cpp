@@ -10,14 +10,12 @@
 #define BOOST_ASIO_HAS_IO_URING
 #define BOOST_ASIO_DISABLE_EPOLL
 
-#include <set>
 #include <list>
-#include <deque>
 #include <iostream>
 #include <boost/asio/strand.hpp>
 #include <boost/beast/core.hpp>
-#include <boost/beast/websocket.hpp>
 #include <snp.hpp>
+#include <websocket_stream.hpp>
 #include <unifex/then.hpp>
 #include <unifex/upon_error.hpp>
 
@@ -28,65 +26,24 @@ using namespace unifex;
 namespace net = boost::asio;
 namespace beast = boost::beast;
 
-namespace http = beast::http;
-namespace websocket = beast::websocket;
-
-template <typename T>
-using websocket_t = websocket::stream<T>;
-
 using tcp = net::ip::tcp;
 using buffer_t = beast::flat_buffer;
 
 using error_code_t = boost::system::error_code;
-using socket_t = websocket_t<beast::tcp_stream>;
+using socket_t = snp::websocket_stream<tcp::socket>;
 
 using results_type = tcp::resolver::results_type;
 using endpoint_t = results_type::endpoint_type;
 
-using chat_message_queue = std::deque<std::string>;
-
 class chat_participant
 {
 public:
     virtual ~chat_participant(){}
-    virtual void deliver(const std::string& msg) = 0;
+    virtual void deliver(const snp::shared_buffer& msg) = 0;
 };
 
 using chat_participant_ptr = std::shared_ptr<chat_participant>;
-
-class chat_room
-{
-public:
-    void join(chat_participant_ptr participant)
-    {
-        participants_.insert(participant);
-
-        for (auto& msg: recent_msgs_)
-             participant->deliver(msg);
-    }
-
-    void leave(chat_participant_ptr participant)
-    {
-        participants_.erase(participant);
-    }
-
-    void deliver(const std::string& msg)
-    {
-        recent_msgs_.push_back(msg);
-
-        while (recent_msgs_.size() > max_recent_msgs)
-               recent_msgs_.pop_front();
-
-        for (auto& participant: participants_)
-             participant->deliver(msg);
-    }
-
-private:
-    chat_message_queue recent_msgs_;
-    static constexpr int max_recent_msgs = 100;
-
-    std::set<chat_participant_ptr> participants_;
-};
+using chat_room = snp::broadcast_channel<chat_participant_ptr>;
 
 class chat_session : public chat_participant, public std::enable_shared_from_this<chat_session>
 {
@@ -105,13 +62,6 @@ public:
 
     void on_start()
     {
-        socket.set_option(websocket::stream_base::timeout::suggested(beast::role_type::server));
-
-        socket.set_option(websocket::stream_base::decorator([](websocket::response_type& res)
-        {
-            res.set(http::field::server, std::string(BOOST_BEAST_VERSION_STRING) + " websocket-server-async");
-        }));
-
         snp::async_accept(socket)
         | unifex::then([this, self = shared_from_this()]
           {
@@ -127,16 +77,13 @@ public:
 
     void on_accept()
     {
-        room.join(shared_from_this());
+        room.subscribe(shared_from_this());
         do_read();
     }
 
-    void deliver(const std::string& msg)
+    void deliver(const snp::shared_buffer& msg)
     {
-        bool write_in_progress = !write_msgs_.empty();
-        write_msgs_.push_back(msg);
-
-        if (!write_in_progress)
+        if (write_msgs_.push(msg))
             do_write();
     }
 
@@ -153,14 +100,16 @@ private:
               if constexpr(std::is_same_v<Error, error_code_t>)
                   std::cerr << "async_read: " << error.message() << std::endl;
 
-              room.leave(shared_from_this());
+              room.unsubscribe(shared_from_this());
           })
         | snp::start_detached();
     }
 
     void on_read()
     {
-        room.deliver(beast::buffers_to_string(buffer.data()));
+        std::string_view msg(static_cast<const char*>(buffer.data().data()), buffer.size());
+
+        room.publish(snp::ws::encode_frame(msg, socket.got_text() ? snp::ws::text : snp::ws::binary));
         buffer.consume(buffer.size());
 
         do_read();
@@ -168,9 +117,8 @@ private:
 
     void do_write()
     {
-        auto& msg = write_msgs_.front();
-
-        snp::async_write(socket, net::buffer(msg.data(), msg.length()))
+        // the frames are encoded once by the room and written as they are, after any pong or close the stream has to answer
+        snp::async_write(frames, write_msgs_.gather())
         | unifex::then([this, self = shared_from_this()](std::size_t bytes_transferred)
           {
               on_write();
@@ -180,24 +128,24 @@ private:
               if constexpr(std::is_same_v<Error, error_code_t>)
                   std::cerr << "async_write: " << error.message() << std::endl;
 
-              room.leave(shared_from_this());
+              room.unsubscribe(shared_from_this());
           })
         | snp::start_detached();
     }
 
     void on_write()
     {
-        write_msgs_.pop_front();
-
-        if (!write_msgs_.empty())
+        if (write_msgs_.written())
             do_write();
     }
 
     socket_t socket;
+    socket_t::frame_writer frames{socket};
+
     chat_room& room;
 
     buffer_t buffer;
-    chat_message_queue write_msgs_;
+    snp::broadcast_queue write_msgs_;
 };
 
 class chat_server
@@ -232,7 +180,7 @@ private:
         do_accept();
     }
 
-    chat_room room;
+    chat_room room{100};
     tcp::acceptor acceptor;
 };
 
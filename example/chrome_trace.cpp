@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <csignal>
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+#include <unifex/scheduler_concepts.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/chrome_trace.cpp -o /tmp/chrome_trace
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+
+// a client resolving, connecting and then exchanging messages with a server of the process, with a timer between the rounds,
+// the whole chain is traced, open the file written with chrome://tracing or https://ui.perfetto.dev
+struct client
+{
+    template <typename Sender, typename F>
+    void step(Sender&& sender, F&& f)
+    {
+        std::forward<Sender>(sender)
+        | unifex::then(std::forward<F>(f))
+        | snp::with_tracer(snp::chrome_trace::instance())
+        | unifex::upon_error([](auto){})
+        | snp::start_detached();
+    }
+
+    void run()
+    {
+        step(snp::async_resolve(ioc, "localhost", port), [this](tcp::resolver::results_type results)
+        {
+            step(snp::async_connect(socket, results), [this](tcp::endpoint)
+            {
+                write();
+            });
+        });
+    }
+
+    void write()
+    {
+        step(snp::async_write(socket, net::buffer(ping)), [this](std::size_t)
+        {
+            step(snp::async_read(socket, net::buffer(pong)), [this](std::size_t)
+            {
+                step(unifex::schedule_after(sch, std::chrono::milliseconds(1)), [this]
+                {
+                    if (++rounds != count)
+                        write();
+                    else
+                        socket.close();
+                });
+            });
+        });
+    }
+
+    net::io_context& ioc;
+    snp::asio_scheduler sch;
+
+    std::string port;
+    std::size_t count;
+
+    tcp::socket socket{ioc};
+    std::size_t rounds = 0;
+
+    char ping[64] = {};
+    char pong[64];
+};
+
+// echoes whatever a connection sends
+struct server
+{
+    void accept()
+    {
+        snp::async_accept(acceptor)
+        | unifex::then([this](tcp::socket s)
+          {
+              socket = std::move(s);
+              read();
+          })
+        | unifex::upon_error([](auto){})
+        | snp::start_detached();
+    }
+
+    void read()
+    {
+        snp::async_read_some(socket, net::buffer(data))
+        | unifex::then([this](std::size_t n)
+          {
+              snp::async_write(socket, net::buffer(data, n))
+              | unifex::then([this](std::size_t)
+                {
+                    read();
+                })
+              | unifex::upon_error([](auto){})
+              | snp::start_detached();
+          })
+        | unifex::upon_error([](auto){})
+        | snp::start_detached();
+    }
+
+    tcp::acceptor acceptor;
+    tcp::socket socket{acceptor.get_executor()};
+
+    char data[64];
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3 || argc > 4 || (argc == 4 && std::string_view(argv[3]) != "--signal"))
+    {
+        std::cerr << "Usage: " << argv[0] << " <rounds> <file> [--signal]" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    auto& ioc = ctx.get_io_context();
+
+    auto& trace = snp::chrome_trace::instance();
+
+    server s{tcp::acceptor(ioc, tcp::endpoint(tcp::v4(), 0))};
+    s.accept();
+
+    client c{ioc, ctx.get_scheduler(), std::to_string(s.acceptor.local_endpoint().port()), std::stoul(argv[1])};
+    c.run();
+
+    // kill -USR2 <pid> starts a capture, the next one writes it
+    if (argc == 4)
+    {
+        std::cout << "kill -USR2 " << ::getpid() << std::endl;
+        trace.capture_on_signal(ioc, SIGUSR2, argv[2]);
+    }
+    else
+        trace.start();
+
+    ctx.run();
+
+    if (argc == 3)
+    {
+        trace.stop();
+        trace.write_file(argv[2]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,177 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <memory>
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/connection_pool.cpp -o /tmp/connection_pool
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using socket_t = tcp::socket;
+
+using endpoint_t = tcp::endpoint;
+using error_code_t = boost::system::error_code;
+
+using steady_clock = std::chrono::steady_clock;
+using pool_t = snp::connection_pool<socket_t>;
+
+class session : public std::enable_shared_from_this<session>
+{
+public:
+    session(socket_t socket) : socket(std::move(socket))
+    {
+    }
+
+    void start()
+    {
+        snp::async_read_some(socket, net::buffer(buff))
+        | unifex::then([this, self = shared_from_this()](std::size_t bytes_transferred)
+          {
+              snp::async_write(socket, net::buffer(buff, bytes_transferred))
+              | unifex::then([this, self](std::size_t)
+                {
+                    start();
+                })
+              | snp::start_detached();
+          })
+        | snp::start_detached();
+    }
+
+private:
+    socket_t socket;
+    char buff[64];
+};
+
+class worker
+{
+public:
+    worker(net::io_context& ioc, pool_t& pool, const endpoint_t& endpoint, std::size_t& requests) : ioc(ioc), pool(pool), endpoint(endpoint), requests(requests)
+    {
+    }
+
+    void run()
+    {
+        if (!requests)
+            return;
+
+        --requests;
+
+        pool.checkout(endpoint, [this](const endpoint_t& endpoint)
+        {
+            auto socket = std::make_unique<socket_t>(ioc);
+            auto& s = *socket;
+
+            return unifex::then(snp::async_connect(s, std::vector{endpoint}), [socket = std::move(socket)](endpoint_t) mutable
+            {
+                return std::move(*socket);
+            });
+        })
+        | unifex::then([this](pool_t::lease l)
+          {
+              lease.emplace(std::move(l));
+              on_checkout();
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "checkout: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    void on_checkout()
+    {
+        snp::async_write(**lease, net::buffer("ping", 4))
+        | unifex::then([this](std::size_t)
+          {
+              snp::async_read(**lease, net::buffer(reply))
+              | unifex::then([this](std::size_t)
+                {
+                    lease->release();
+                    lease.reset();
+
+                    run();
+                })
+              | snp::start_detached();
+          })
+        | snp::start_detached();
+    }
+
+private:
+    net::io_context& ioc;
+    pool_t& pool;
+
+    endpoint_t endpoint;
+    std::size_t& requests;
+
+    char reply[4];
+    std::optional<pool_t::lease> lease;
+};
+
+void do_accept(tcp::acceptor& acceptor)
+{
+    snp::async_accept(acceptor)
+    | unifex::then([&acceptor](socket_t socket)
+      {
+          std::make_shared<session>(std::move(socket))->start();
+          do_accept(acceptor);
+      })
+    | snp::start_detached();
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <requests> <concurrency>" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    auto& ioc = ctx.get_io_context();
+
+    tcp::acceptor acceptor(ioc, endpoint_t(net::ip::make_address("127.0.0.1"), 0));
+    do_accept(acceptor);
+
+    snp::pool_options options;
+    options.max_per_endpoint = 4;
+
+    pool_t pool(ioc, options);
+
+    std::size_t requests = std::stoul(argv[1]);
+    std::vector<std::unique_ptr<worker>> workers;
+
+    for (std::size_t i = 0, n = std::stoul(argv[2]); i != n; ++i)
+         workers.push_back(std::make_unique<worker>(ioc, pool, acceptor.local_endpoint(), requests));
+
+    auto begin = steady_clock::now();
+
+    for (auto& w : workers)
+         w->run();
+
+    while (requests || pool.idle(acceptor.local_endpoint()) != std::min<std::size_t>(workers.size(), options.max_per_endpoint))
+        ioc.run_one();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin);
+    auto stats = pool.stats();
+
+    std::cout << "checkouts " << stats.checkouts << " in " << elapsed.count() << " us, hit rate " << stats.hit_rate() * 100 << "%" << std::endl;
+    std::cout << "new connections " << stats.misses << " waits " << stats.waits << " avg wait " << (stats.waits ? stats.wait_ns / stats.waits : 0) << " ns" << std::endl;
+
+    return 0;
+}
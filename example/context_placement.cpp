@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <thread>
+#include <iostream>
+#include <algorithm>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/scheduler_concepts.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/context_placement.cpp -o /tmp/context_placement
+
+namespace net = boost::asio;
+
+using steady_clock = std::chrono::steady_clock;
+using work_guard_t = net::executor_work_guard<net::io_context::executor_type>;
+
+// the operation frames are allocated on the numa node of the thread that starts them
+struct pingpong
+{
+    static auto frames()
+    {
+        return snp::node_allocator<std::byte>(snp::current_node());
+    }
+
+    void ping()
+    {
+        begin = steady_clock::now();
+
+        unifex::schedule(b.get_scheduler())
+        | unifex::then([this]
+          {
+              pong();
+          })
+        | snp::start_detached(frames());
+    }
+
+    void pong()
+    {
+        unifex::schedule(a.get_scheduler())
+        | unifex::then([this]
+          {
+              samples.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - begin).count());
+
+              if (samples.size() < rounds)
+                  ping();
+              else
+              {
+                  ga.reset();
+                  gb.reset();
+              }
+          })
+        | snp::start_detached(frames());
+    }
+
+    snp::asio_context& a;
+    snp::asio_context& b;
+
+    work_guard_t& ga;
+    work_guard_t& gb;
+
+    std::size_t rounds;
+    std::vector<long> samples;
+
+    steady_clock::time_point begin;
+};
+
+void measure(const std::string& name, const snp::placement& p, std::size_t rounds)
+{
+    snp::asio_context a;
+    snp::asio_context b;
+
+    auto ga = net::make_work_guard(a.get_io_context());
+    auto gb = net::make_work_guard(b.get_io_context());
+
+    pingpong pp{a, b, ga, gb, rounds};
+    pp.samples.reserve(rounds);
+
+    net::post(a.get_io_context(), [&]{ pp.ping(); });
+
+    auto pin = [&](std::size_t i)
+    {
+        if (auto ec = p.pin(i))
+            std::cerr << name << ": pin " << i << ": " << ec.message() << std::endl;
+    };
+
+    std::thread ta([&]{ pin(0); a.run(); });
+    std::thread tb([&]{ pin(1); b.run(); });
+
+    ta.join();
+    tb.join();
+
+    auto& s = pp.samples;
+    std::sort(s.begin(), s.end());
+
+    auto at = [&](double q){ return s[std::min(s.size() - 1, static_cast<std::size_t>(q * s.size()))]; };
+
+    std::cout << name << "\n" << p << std::endl;
+    std::cout << "  round trip ns: p50 " << at(0.5) << " p99 " << at(0.99) << " p99.9 " << at(0.999) << " max " << s.back() << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    std::size_t rounds = argc > 1 ? std::stoul(argv[1]) : 100000;
+
+    snp::topology t;
+    std::cout << t << std::endl;
+
+    measure("unpinned", snp::placement(2), rounds);
+    measure("compact", snp::placement::compact(t, 2), rounds);
+
+    if (t.nodes.size() > 1)
+        measure("spread", snp::placement::spread(t, 2), rounds);
+
+    if (auto p = snp::placement::isolated(t, 2); !p.fallback)
+        measure("isolated", p, rounds);
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/on.hpp>
+#include <unifex/just.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+#include <unifex/scheduler_concepts.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/dispatch.cpp -o /tmp/dispatch
+
+namespace net = boost::asio;
+
+using error_code_t = boost::system::error_code;
+
+int main(int argc, char* argv[])
+{
+    bool outer = false;
+    bool inner = false;
+
+    snp::asio_context ctx;
+    auto sch = ctx.get_dispatch_scheduler();
+
+    unifex::on(sch, unifex::just(4))
+    | unifex::then([&](int n)
+      {
+          outer = true;
+          std::cout << "dispatch " << n << std::endl;
+
+          unifex::on(sch, unifex::just(8))
+          | unifex::then([&](int n)
+            {
+                inner = true;
+                std::cout << "dispatch inline " << n << std::endl;
+            })
+          | snp::start_detached();
+
+          assert(inner);
+      })
+    | unifex::upon_error([]<typename Error>(Error error)
+      {
+          if constexpr(std::is_same_v<Error, std::exception_ptr>)
+          {
+              try
+              {
+                  if (error)
+                      std::rethrow_exception(error);
+              }
+              catch (const std::exception& e)
+              {
+                  std::cout << "caught exception: '" << e.what() << "'" << std::endl;
+              }
+          }
+      })
+    | snp::start_detached();
+
+    assert(!outer);
+    ctx.run();
+
+    assert(outer && inner);
+
+    return 0;
+}
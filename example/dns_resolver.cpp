@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/dns_resolver.cpp -o /tmp/dns_resolver
+
+// /tmp/dns_server 5353 192.0.2.1 2001:db8::1 &
+// /tmp/dns_resolver 127.0.0.1 5353 1000 example.com tcp.example.com nx.example.com localhost
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using udp = net::ip::udp;
+
+using error_code_t = boost::system::error_code;
+using steady_clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[])
+{
+    if (argc < 5)
+    {
+        std::cerr << "Usage: " << argv[0] << " <nameserver> <port> <lookups> <host>..." << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    auto config = snp::dns_config::load();
+
+    config.nameservers = {udp::endpoint(net::ip::make_address(argv[1]), std::stoi(argv[2]))};
+    config.timeout = std::chrono::seconds(1);
+
+    snp::dns_resolver resolver(ctx.get_io_context(), config);
+
+    std::size_t lookups = std::stoul(argv[3]);
+    std::size_t resolved = 0;
+
+    auto begin = steady_clock::now();
+
+    for (int i = 4; i != argc; ++i)
+    {
+         std::string host(argv[i]);
+
+         for (std::size_t j = 0; j != lookups; ++j)
+         {
+              snp::async_resolve(resolver, host, "http")
+              | unifex::then([&, host, j](auto&& results)
+                {
+                    ++resolved;
+
+                    if (j)
+                        return;
+
+                    std::cout << host << ":";
+
+                    for (auto& entry : results)
+                         std::cout << " " << entry.endpoint();
+
+                    std::cout << std::endl;
+                })
+              | unifex::upon_error([host, j](auto&& error)
+                {
+                    if constexpr(std::is_same_v<std::decay_t<decltype(error)>, error_code_t>)
+                        if (!j)
+                            std::cout << host << ": " << error.message() << std::endl;
+                })
+              | snp::start_detached();
+         }
+    }
+
+    ctx.run();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin);
+    std::cout << "resolved " << resolved << " of " << lookups * (argc - 4) << " in " << elapsed.count() << " us" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#include <thread>
+#include <iostream>
+#include <dns_resolver.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include example/dns_server.cpp -o /tmp/dns_server
+
+// a stand-in dns server for the dns_resolver example, it answers every A and AAAA query with the given addresses,
+// names starting with nx. don't exist, and the answers of names starting with tcp. are truncated over udp
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using udp = net::ip::udp;
+
+std::vector<uint8_t> respond(const uint8_t* data, std::size_t n, bool stream, const net::ip::address_v4& v4, const net::ip::address_v6& v6)
+{
+    std::size_t pos = 12;
+    std::string name;
+
+    while (pos < n && data[pos])
+    {
+        name.append(name.empty() ? "" : ".").append(reinterpret_cast<const char*>(data + pos + 1), data[pos]);
+        pos += data[pos] + 1;
+    }
+
+    if (pos + 5 > n)
+        return {};
+
+    uint16_t type = data[pos + 1] << 8 | data[pos + 2];
+    std::vector<uint8_t> reply(data, data + pos + 5);
+
+    bool nx = name.starts_with("nx.");
+    bool truncated = name.starts_with("tcp.") && !stream;
+
+    reply[2] = 0x81 | (truncated ? 0x02 : 0x00);
+    reply[3] = 0x80 | (nx ? snp::dns::nxdomain : snp::dns::noerror);
+
+    if (nx || truncated || (type != snp::dns::type_a && type != snp::dns::type_aaaa))
+        return reply;
+
+    reply[7] = 1;
+    reply.insert(reply.end(), {0xc0, 0x0c, uint8_t(type >> 8), uint8_t(type), 0x00, 0x01, 0x00, 0x00, 0x00, 0x3c});
+
+    if (type == snp::dns::type_a)
+    {
+        auto bytes = v4.to_bytes();
+
+        reply.insert(reply.end(), {0x00, 0x04});
+        reply.insert(reply.end(), bytes.begin(), bytes.end());
+    }
+    else
+    {
+        auto bytes = v6.to_bytes();
+
+        reply.insert(reply.end(), {0x00, 0x10});
+        reply.insert(reply.end(), bytes.begin(), bytes.end());
+    }
+
+    return reply;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <port> <ipv4> <ipv6>" << std::endl;
+
+        return 1;
+    }
+
+    net::io_context ioc;
+    unsigned short port = std::stoi(argv[1]);
+
+    auto v4 = net::ip::make_address_v4(argv[2]);
+    auto v6 = net::ip::make_address_v6(argv[3]);
+
+    udp::socket socket(ioc, udp::endpoint(net::ip::address_v4::loopback(), port));
+    tcp::acceptor acceptor(ioc, tcp::endpoint(net::ip::address_v4::loopback(), port));
+
+    std::thread streams([&]
+    {
+        for (;;)
+        {
+             auto stream = acceptor.accept();
+             uint8_t length[2];
+
+             boost::system::error_code ec;
+             net::read(stream, net::buffer(length), ec);
+
+             std::vector<uint8_t> query(length[0] << 8 | length[1]);
+             net::read(stream, net::buffer(query), ec);
+
+             if (ec)
+                 continue;
+
+             auto reply = respond(query.data(), query.size(), true, v4, v6);
+             uint8_t size[2] = {uint8_t(reply.size() >> 8), uint8_t(reply.size())};
+
+             net::write(stream, std::array{net::buffer(size), net::buffer(reply)}, ec);
+        }
+    });
+
+    for (uint8_t data[512];;)
+    {
+         udp::endpoint sender;
+         auto n = socket.receive_from(net::buffer(data), sender);
+
+         if (auto reply = respond(data, n, false, v4, v6); !reply.empty())
+             socket.send_to(net::buffer(reply), sender);
+    }
+
+    streams.join();
+
+    return 0;
+}
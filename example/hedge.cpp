@@ -0,0 +1,94 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <random>
+#include <iostream>
+#include <algorithm>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+#include <unifex/scheduler_concepts.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/hedge.cpp -o /tmp/hedge
+
+namespace net = boost::asio;
+
+using steady_clock = std::chrono::steady_clock;
+
+struct client
+{
+    auto request()
+    {
+        std::uniform_int_distribution<int> d(0, 99);
+        auto latency = std::chrono::milliseconds(d(gen) < 95 ? 1 : 50);
+
+        return unifex::then(unifex::schedule_after(sch, latency), [latency]
+        {
+            return latency.count();
+        });
+    }
+
+    void run()
+    {
+        auto begin = steady_clock::now();
+
+        snp::hedge(sch, [this]{ return request(); }, policy)
+        | unifex::then([this, begin](long)
+          {
+              samples.push_back(std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin).count());
+
+              if (samples.size() < count)
+                  run();
+          })
+        | snp::start_detached();
+    }
+
+    snp::asio_scheduler sch;
+    snp::hedge_policy& policy;
+
+    std::size_t count;
+    std::vector<long> samples;
+
+    std::mt19937 gen{std::random_device{}()};
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <requests>" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    snp::hedge_policy policy(0.9, std::chrono::milliseconds(5));
+
+    client c{ctx.get_scheduler(), policy, std::stoul(argv[1])};
+    c.run();
+
+    ctx.run();
+
+    auto& s = c.samples;
+    std::sort(s.begin(), s.end());
+
+    auto stats = policy.stats();
+    auto at = [&](double q){ return s[std::min(s.size() - 1, static_cast<std::size_t>(q * s.size()))]; };
+
+    std::cout << "requests " << stats.requests << " hedged " << stats.hedged << " (" << 100.0 * stats.hedged / stats.requests << "%)" << std::endl;
+    std::cout << "primary wins " << stats.primary_wins << " hedge wins " << stats.hedge_wins << " failures " << stats.failures << std::endl;
+
+    std::cout << "hedge delay " << std::chrono::duration_cast<std::chrono::microseconds>(policy.delay()).count() << " us" << std::endl;
+    std::cout << "latency us: p50 " << at(0.5) << " p99 " << at(0.99) << " max " << s.back() << std::endl;
+
+    return 0;
+}
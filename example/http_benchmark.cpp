@@ -0,0 +1,243 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <thread>
+#include <vector>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <snp.hpp>
+#include <http_server.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/http_benchmark.cpp -o /tmp/http_benchmark
+
+namespace net = boost::asio;
+namespace http = snp::http;
+
+using tcp = net::ip::tcp;
+
+using endpoint_t = tcp::endpoint;
+using error_code_t = boost::system::error_code;
+
+using steady_clock = std::chrono::steady_clock;
+
+// keeps a connection busy like wrk does: sends pipeline requests with one write,
+// waits for all of their responses, and starts over until the deadline passes
+class client
+{
+public:
+    client(net::io_context& ioc, std::size_t pipeline, steady_clock::time_point deadline) : socket(ioc), deadline(deadline), pipeline(pipeline)
+    {
+        for (std::size_t i = 0; i != pipeline; ++i)
+             requests += "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    }
+
+    void start(const endpoint_t& endpoint)
+    {
+        snp::async_connect(socket, std::vector<endpoint_t>{endpoint})
+        | unifex::then([this](const endpoint_t&)
+          {
+              socket.set_option(tcp::no_delay(true));
+              do_write();
+          })
+        | unifex::upon_error([this]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_connect: " << error.message() << std::endl;
+
+              ++errors;
+          })
+        | snp::start_detached();
+    }
+
+    void do_write()
+    {
+        begin = steady_clock::now();
+        pending = pipeline;
+
+        snp::async_write(socket, net::buffer(requests))
+        | unifex::then([this](std::size_t)
+          {
+              do_read();
+          })
+        | unifex::upon_error([this](auto)
+          {
+              ++errors;
+          })
+        | snp::start_detached();
+    }
+
+    void do_read()
+    {
+        snp::async_read_some(socket, net::buffer(chunk))
+        | unifex::then([this](std::size_t n)
+          {
+              bytes += n;
+              buffer.append(chunk, n);
+
+              pending -= parse();
+
+              if (pending)
+                  return do_read();
+
+              auto now = steady_clock::now();
+
+              latencies.push_back(now - begin);
+              completed += pipeline;
+
+              if (now < deadline)
+                  do_write();
+          })
+        | unifex::upon_error([this](auto)
+          {
+              ++errors;
+          })
+        | snp::start_detached();
+    }
+
+    // counts and drops the complete responses at the front of the buffer
+    std::size_t parse()
+    {
+        std::size_t count = 0;
+        std::size_t head = 0;
+
+        while (true)
+        {
+            auto end = snp::simd::find(buffer.data() + head, buffer.size() - head, "\r\n\r\n");
+
+            if (end == snp::simd::npos)
+                break;
+
+            std::size_t length = 0;
+            std::string_view block(buffer.data() + head, end);
+
+            if (auto pos = block.find("Content-Length: "); pos != block.npos)
+                std::from_chars(block.data() + pos + 16, block.data() + block.size(), length);
+
+            if (head + end + 4 + length > buffer.size())
+                break;
+
+            head += end + 4 + length;
+            ++count;
+        }
+
+        buffer.erase(0, head);
+
+        return count;
+    }
+
+    tcp::socket socket;
+    steady_clock::time_point deadline;
+
+    std::size_t pipeline;
+    std::size_t pending = 0;
+
+    std::string requests;
+    std::string buffer;
+
+    char chunk[64 * 1024];
+
+    steady_clock::time_point begin;
+    std::vector<steady_clock::duration> latencies;
+
+    std::size_t completed = 0;
+    std::size_t bytes = 0;
+
+    std::size_t errors = 0;
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4 && argc != 6)
+    {
+        std::cerr << "Usage: " << argv[0] << " <connections> <pipeline> <seconds> [<address> <port>]" << std::endl;
+
+        return 1;
+    }
+
+    std::size_t connections = std::stoul(argv[1]);
+    std::size_t pipeline = std::stoul(argv[2]);
+
+    auto duration = std::chrono::seconds(std::stoul(argv[3]));
+
+    // without a target, an in-process server answers on its own thread
+    net::io_context server_ioc;
+
+    http::server server(server_ioc, endpoint_t(net::ip::make_address("127.0.0.1"), 0), [](const http::request& req, http::response& res)
+    {
+        res.body = "Hello, World!";
+    });
+
+    std::jthread server_thread;
+    endpoint_t endpoint = server.local_endpoint();
+
+    if (argc == 6)
+        endpoint = endpoint_t(net::ip::make_address(argv[4]), std::stoi(argv[5]));
+    else
+        server_thread = std::jthread([&server_ioc]{ server_ioc.run(); });
+
+    net::io_context ioc;
+    auto deadline = steady_clock::now() + duration;
+
+    std::vector<std::unique_ptr<client>> clients;
+
+    for (std::size_t i = 0; i != connections; ++i)
+    {
+         clients.push_back(std::make_unique<client>(ioc, pipeline, deadline));
+         clients.back()->start(endpoint);
+    }
+
+    auto begin = steady_clock::now();
+    ioc.run();
+
+    auto elapsed = std::chrono::duration<double>(steady_clock::now() - begin).count();
+
+    std::size_t requests = 0;
+    std::size_t bytes = 0;
+    std::size_t errors = 0;
+
+    std::vector<steady_clock::duration> latencies;
+
+    for (auto& c : clients)
+    {
+         requests += c->completed;
+         bytes += c->bytes;
+         errors += c->errors;
+
+         latencies.insert(latencies.end(), c->latencies.begin(), c->latencies.end());
+    }
+
+    std::ranges::sort(latencies);
+
+    auto percentile = [&](double p)
+    {
+        if (latencies.empty())
+            return 0.0;
+
+        return std::chrono::duration<double, std::micro>(latencies[std::min(latencies.size() - 1, std::size_t(p * latencies.size()))]).count();
+    };
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Running " << argv[3] << "s test @ " << endpoint << std::endl;
+    std::cout << "  " << connections << " connections, pipeline " << pipeline << std::endl;
+    std::cout << "  Latency per batch (us): p50 " << percentile(0.5) << ", p90 " << percentile(0.9) << ", p99 " << percentile(0.99) << ", max " << percentile(1.0) << std::endl;
+    std::cout << "  " << requests << " requests in " << elapsed << "s, " << bytes / (1024.0 * 1024.0) << "MB read, " << errors << " errors" << std::endl;
+    std::cout << "Requests/sec: " << requests / elapsed << std::endl;
+    std::cout << "Transfer/sec: " << bytes / elapsed / (1024.0 * 1024.0) << "MB" << std::endl;
+
+    server.close();
+    server_ioc.stop();
+
+    return 0;
+}
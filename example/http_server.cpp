@@ -0,0 +1,67 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <http_server.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/http_server.cpp -o /tmp/http_server
+
+namespace net = boost::asio;
+namespace http = snp::http;
+
+using tcp = net::ip::tcp;
+
+void handle(const http::request& req, http::response& res)
+{
+    if (req.target == "/")
+        res.body = "Hello, World!";
+    else if (req.target == "/echo" && req.method == "POST")
+    {
+        res.content_type = "application/octet-stream";
+        res.body = req.body;
+    }
+    else if (req.target == "/headers")
+    {
+        for (auto& h : req.headers)
+             res.body.append(h.name).append(": ").append(h.value).append("\n");
+    }
+    else
+    {
+        res.status = 404;
+        res.body = "Not Found";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " <address> <port>" << std::endl;
+
+            return 1;
+        }
+
+        net::io_context ioc;
+        http::server server(ioc, tcp::endpoint(net::ip::make_address(argv[1]), std::atoi(argv[2])), handle);
+
+        ioc.run();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
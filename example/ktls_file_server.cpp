@@ -0,0 +1,211 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <array>
+#include <memory>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <snp.hpp>
+#include <ktls_stream.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring -l ssl -l crypto example/ktls_file_server.cpp -o /tmp/ktls_file_server
+
+namespace net = boost::asio;
+namespace ssl = net::ssl;
+
+using tcp = net::ip::tcp;
+
+using stream_t = snp::ktls_stream<tcp::socket>;
+using error_code_t = boost::system::error_code;
+
+// sends a file to every client over tls, with sendfile once the kernel encrypts the records, and through OpenSSL otherwise
+class session : public std::enable_shared_from_this<session>
+{
+public:
+    session(tcp::socket socket, ssl::context& ctx, int fd) : stream(std::move(socket), ctx), fd(fd)
+    {
+        struct stat st;
+        fstat(fd, &st);
+
+        remaining = st.st_size;
+    }
+
+    void start()
+    {
+        snp::async_handshake(stream, ssl::stream_base::server)
+        | unifex::then([this, self = shared_from_this()]
+          {
+              on_handshake();
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_handshake: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    void on_handshake()
+    {
+        if (stream.tx_offloaded())
+        {
+            std::cerr << "kernel tls, sendfile" << std::endl;
+
+            stream.next_layer().native_non_blocking(true);
+            do_sendfile();
+        }
+        else
+        {
+            std::cerr << "kernel tls unavailable (" << stream.offload_error().message() << "), OpenSSL" << std::endl;
+            do_write();
+        }
+    }
+
+    void do_sendfile()
+    {
+        while (remaining)
+        {
+            auto n = ::sendfile(stream.next_layer().native_handle(), fd, &offset, remaining);
+
+            if (n > 0)
+                remaining -= n;
+            else if (n < 0 && errno == EAGAIN)
+                return stream.next_layer().async_wait(tcp::socket::wait_write, [this, self = shared_from_this()](error_code_t ec)
+                {
+                    if (!ec)
+                        do_sendfile();
+                });
+            else
+                return;
+        }
+
+        do_shutdown();
+    }
+
+    void do_write()
+    {
+        if (!remaining)
+            return do_shutdown();
+
+        auto n = ::pread(fd, buff.data(), std::min<std::size_t>(buff.size(), remaining), offset);
+
+        if (n <= 0)
+            return;
+
+        offset += n;
+        remaining -= n;
+
+        snp::async_write(stream, net::buffer(buff, n))
+        | unifex::then([this, self = shared_from_this()](std::size_t bytes_transferred)
+          {
+              do_write();
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_write: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    void do_shutdown()
+    {
+        stream.async_shutdown([self = shared_from_this()](error_code_t ec)
+        {
+        });
+    }
+
+private:
+    stream_t stream;
+    int fd;
+
+    off_t offset = 0;
+    std::size_t remaining = 0;
+
+    std::array<char, 64 * 1024> buff;
+};
+
+class server
+{
+public:
+    server(net::io_context& ioc, const tcp::endpoint& endpoint, ssl::context& ctx, int fd) : acceptor(ioc, endpoint), ctx(ctx), fd(fd)
+    {
+        do_accept();
+    }
+
+    void do_accept()
+    {
+        snp::async_accept(acceptor)
+        | unifex::then([this](tcp::socket socket)
+          {
+              std::make_shared<session>(std::move(socket), ctx, fd)->start();
+              do_accept();
+          })
+        | unifex::upon_error([this]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_accept: " << error.message() << std::endl;
+
+              do_accept();
+          })
+        | snp::start_detached();
+    }
+
+private:
+    tcp::acceptor acceptor;
+    ssl::context& ctx;
+
+    int fd;
+};
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 5)
+        {
+            std::cerr << "Usage: " << argv[0] << " <port> <cert> <key> <file>" << std::endl;
+
+            return 1;
+        }
+
+        int fd = ::open(argv[4], O_RDONLY);
+
+        if (fd < 0)
+        {
+            std::cerr << "open: " << argv[4] << std::endl;
+
+            return 1;
+        }
+
+        ssl::context ctx(ssl::context::tls_server);
+
+        ctx.use_certificate_chain_file(argv[2]);
+        ctx.use_private_key_file(argv[3], ssl::context::pem);
+
+        net::io_context ioc;
+        server s(ioc, tcp::endpoint(tcp::v4(), std::atoi(argv[1])), ctx, fd);
+
+        ioc.run();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
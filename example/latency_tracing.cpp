@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+#include <unifex/scheduler_concepts.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/latency_tracing.cpp -o /tmp/latency_tracing
+
+namespace net = boost::asio;
+
+using local = net::local::stream_protocol;
+
+// a ping pong over a pair of connected sockets and a timer between the rounds,
+// every sender of it reports to the tracer, prints the latencies per sender as a table or as json
+struct ping_pong
+{
+    void run()
+    {
+        snp::async_write(a, net::buffer(ping))
+        | unifex::then([this](std::size_t)
+          {
+              read();
+          })
+        | snp::with_tracer(tracer)
+        | unifex::upon_error([](auto){})
+        | snp::start_detached();
+    }
+
+    void read()
+    {
+        snp::async_read(b, net::buffer(pong))
+        | unifex::then([this](std::size_t)
+          {
+              wait();
+          })
+        | snp::with_tracer(tracer)
+        | unifex::upon_error([](auto){})
+        | snp::start_detached();
+    }
+
+    void wait()
+    {
+        unifex::schedule_after(sch, std::chrono::microseconds(100))
+        | unifex::then([this]
+          {
+              if (++rounds < count)
+                  run();
+          })
+        | snp::with_tracer(tracer)
+        | unifex::upon_error([](auto){})
+        | snp::start_detached();
+    }
+
+    local::socket& a;
+    local::socket& b;
+
+    snp::asio_scheduler sch;
+    snp::latency_tracer& tracer;
+
+    std::size_t count;
+    std::size_t rounds = 0;
+
+    char ping[64] = {};
+    char pong[64];
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2 || argc > 3 || (argc == 3 && std::string_view(argv[2]) != "--json"))
+    {
+        std::cerr << "Usage: " << argv[0] << " <rounds> [--json]" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    snp::latency_tracer tracer;
+
+    auto& ioc = ctx.get_io_context();
+    local::socket a(ioc), b(ioc);
+
+    net::local::connect_pair(a, b);
+
+    ping_pong p{a, b, ctx.get_scheduler(), tracer, std::stoul(argv[1])};
+    p.run();
+
+    ctx.run();
+
+    if (argc == 3)
+        tracer.write_json(std::cout);
+    else
+        tracer.write_table(std::cout);
+
+    return 0;
+}
@@ -0,0 +1,80 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#define SNP_ENABLE_METRICS
+
+#include <sstream>
+#include <iostream>
+#include <functional>
+#include <snp.hpp>
+#include <http_server.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/metrics_server.cpp -o /tmp/metrics_server
+
+namespace net = boost::asio;
+namespace http = snp::http;
+
+using tcp = net::ip::tcp;
+
+using sessions_t = std::function<std::vector<snp::metrics::stream_snapshot>()>;
+
+// serves its own metrics at /metrics for prometheus to scrape, with the bytes of every open session
+void handle(const http::request& req, http::response& res, const sessions_t& sessions)
+{
+    if (req.target == "/")
+        res.body = "Hello, World!";
+    else if (req.target == "/metrics")
+    {
+        std::ostringstream os;
+        snp::metrics::write_prometheus(os);
+        snp::metrics::write_prometheus(os, sessions());
+
+        res.content_type = "text/plain; version=0.0.4";
+        res.body = os.str();
+    }
+    else
+    {
+        res.status = 404;
+        res.body = "Not Found";
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc != 3)
+        {
+            std::cerr << "Usage: " << argv[0] << " <address> <port>" << std::endl;
+
+            return 1;
+        }
+
+        snp::asio_context ctx;
+        sessions_t sessions;
+
+        http::server server(ctx.get_io_context(), tcp::endpoint(net::ip::make_address(argv[1]), std::atoi(argv[2])), [&](auto& req, auto& res)
+        {
+            handle(req, res, sessions);
+        });
+
+        sessions = [&]{ return server.sessions(); };
+
+        ctx.run();
+    }
+    catch (std::exception& e)
+    {
+        std::cerr << "Exception: " << e.what() << std::endl;
+    }
+
+    return 0;
+}
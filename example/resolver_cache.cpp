@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/resolver_cache.cpp -o /tmp/resolver_cache
+
+namespace net = boost::asio;
+
+using tcp = net::ip::tcp;
+using error_code_t = boost::system::error_code;
+
+using steady_clock = std::chrono::steady_clock;
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <host> <service> <lookups>" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+    snp::resolver_cache cache(ctx.get_io_context());
+
+    std::string host(argv[1]);
+    std::string service(argv[2]);
+
+    std::size_t lookups = std::stoul(argv[3]);
+    std::size_t resolved = 0;
+
+    auto begin = steady_clock::now();
+
+    // all the lookups of the first round share a single query, the second round is answered from the cache
+    for (int round = 0; round != 2; ++round)
+    {
+         for (std::size_t i = 0; i != lookups; ++i)
+         {
+              snp::async_resolve(cache, host, service)
+              | unifex::then([&](auto&& results)
+                {
+                    resolved += !results.empty();
+                })
+              | unifex::upon_error([](auto&& error)
+                {
+                    if constexpr(std::is_same_v<std::decay_t<decltype(error)>, error_code_t>)
+                        std::cout << "async_resolve: " << error.message() << std::endl;
+                })
+              | snp::start_detached();
+         }
+
+         ctx.run();
+         ctx.get_io_context().restart();
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin);
+    auto stats = cache.stats();
+
+    std::cout << "resolved " << resolved << " of " << 2 * lookups << " in " << elapsed.count() << " us" << std::endl;
+    std::cout << "hits " << stats.hits << " negative hits " << stats.negative_hits << " misses " << stats.misses;
+    std::cout << " coalesced " << stats.coalesced << " numeric " << stats.numeric << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/scheduler_concepts.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/run_busy.cpp -o /tmp/run_busy
+
+namespace net = boost::asio;
+
+using steady_clock = std::chrono::steady_clock;
+
+struct ticker
+{
+    void tick()
+    {
+        auto expected = steady_clock::now() + interval;
+
+        unifex::schedule_at(sch, expected)
+        | unifex::then([this, expected]
+          {
+              lateness += steady_clock::now() - expected;
+
+              if (--count)
+                  tick();
+          })
+        | snp::start_detached();
+    }
+
+    snp::asio_scheduler sch;
+    std::chrono::microseconds interval;
+
+    std::size_t count;
+    steady_clock::duration lateness{};
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "Usage: " << argv[0] << " <spin budget us> <ticks>" << std::endl;
+
+        return 1;
+    }
+
+    snp::asio_context ctx;
+
+    auto budget = std::chrono::microseconds(std::stoul(argv[1]));
+    auto count = std::stoul(argv[2]);
+
+    ticker t{ctx.get_scheduler(), std::chrono::microseconds(100), count};
+    t.tick();
+
+    ctx.run_busy(budget);
+
+    auto& stats = ctx.get_busy_stats();
+    auto lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(t.lateness).count() / count;
+
+    std::cout << "average lateness " << lateness << " ns" << std::endl;
+    std::cout << "spin " << stats.spin_ns / 1000 << " us, " << stats.polls << " handlers" << std::endl;
+    std::cout << "sleep " << stats.sleep_ns / 1000 << " us, " << stats.sleeps << " waits" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,296 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <memory>
+#include <thread>
+#include <optional>
+#include <iostream>
+#include <snp.hpp>
+#include <tls_session_cache.hpp>
+#include <async_handshake_offload.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring -l ssl -l crypto example/tls_resumption_benchmark.cpp -o /tmp/tls_resumption_benchmark
+
+namespace net = boost::asio;
+namespace ssl = net::ssl;
+
+using tcp = net::ip::tcp;
+using stream_t = ssl::stream<tcp::socket>;
+
+using endpoint_t = tcp::endpoint;
+using error_code_t = boost::system::error_code;
+
+using steady_clock = std::chrono::steady_clock;
+
+struct mode
+{
+    const char* name;
+
+    bool tls;
+    bool resume;
+    bool offload;
+};
+
+// answers every connection with a single byte, after the handshake if it's tls, and closes it
+class server_session : public std::enable_shared_from_this<server_session>
+{
+public:
+    server_session(tcp::socket socket, ssl::context& ctx) : stream(std::move(socket), ctx)
+    {
+        stream.next_layer().set_option(tcp::no_delay(true));
+    }
+
+    void start(const mode& m, net::thread_pool& pool)
+    {
+        if (!m.tls)
+            do_write(stream.next_layer());
+        else if (m.offload)
+            do_handshake(snp::async_handshake_offload(stream, ssl::stream_base::server, pool.get_executor()));
+        else
+            do_handshake(snp::async_handshake(stream, ssl::stream_base::server));
+    }
+
+    template <typename Sender>
+    void do_handshake(Sender&& sender)
+    {
+        std::forward<Sender>(sender)
+        | unifex::then([this, self = shared_from_this()]
+          {
+              do_write(stream);
+          })
+        | unifex::upon_error([self = shared_from_this()](auto)
+          {
+          })
+        | snp::start_detached();
+    }
+
+    template <typename Stream>
+    void do_write(Stream& s)
+    {
+        snp::async_write(s, net::buffer(byte, 1))
+        | unifex::then([this, self = shared_from_this()](std::size_t)
+          {
+              // a tls session is only kept for resumption if the connection is shut down
+              if constexpr(std::is_same_v<Stream, stream_t>)
+                  stream.async_shutdown([self](error_code_t){});
+          })
+        | unifex::upon_error([self = shared_from_this()](auto)
+          {
+          })
+        | snp::start_detached();
+    }
+
+private:
+    stream_t stream;
+    char byte[1] = {'x'};
+};
+
+// connects, handshakes, reads the byte and shuts down, one connection after another
+class client
+{
+public:
+    client(net::io_context& ioc, ssl::context& ctx, snp::tls_session_cache& cache, const mode& m, std::size_t handshakes) :
+    ioc(ioc), ctx(ctx), cache(cache), m(m), handshakes(handshakes)
+    {
+    }
+
+    void start(const endpoint_t& endpoint)
+    {
+        this->endpoint = endpoint;
+        do_connect();
+    }
+
+    void do_connect()
+    {
+        stream.emplace(ioc, ctx);
+
+        if (m.resume)
+            cache.resume(*stream, "server");
+
+        snp::async_connect(stream->next_layer(), std::vector{endpoint})
+        | unifex::then([this](endpoint_t)
+          {
+              stream->next_layer().set_option(tcp::no_delay(true));
+
+              if (m.tls)
+                  do_handshake();
+              else
+                  do_read(stream->next_layer());
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_connect: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    void do_handshake()
+    {
+        snp::async_handshake(*stream, ssl::stream_base::client)
+        | unifex::then([this]
+          {
+              reused += SSL_session_reused(stream->native_handle());
+              do_read(*stream);
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_handshake: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    template <typename Stream>
+    void do_read(Stream& s)
+    {
+        snp::async_read(s, net::buffer(byte, 1))
+        | unifex::then([this](std::size_t)
+          {
+              if constexpr(std::is_same_v<Stream, stream_t>)
+                  stream->async_shutdown([this](error_code_t){ do_next(); });
+              else
+                  do_next();
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_read: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    void do_next()
+    {
+        if (--handshakes)
+            do_connect();
+    }
+
+    std::size_t reused = 0;
+
+private:
+    net::io_context& ioc;
+    ssl::context& ctx;
+
+    snp::tls_session_cache& cache;
+    const mode& m;
+
+    std::size_t handshakes;
+    endpoint_t endpoint;
+
+    std::optional<stream_t> stream;
+    char byte[1];
+};
+
+void do_accept(tcp::acceptor& acceptor, ssl::context& ctx, const mode& m, net::thread_pool& pool)
+{
+    snp::async_accept(acceptor)
+    | unifex::then([&acceptor, &ctx, &m, &pool](tcp::socket socket)
+      {
+          std::make_shared<server_session>(std::move(socket), ctx)->start(m, pool);
+          do_accept(acceptor, ctx, m, pool);
+      })
+    | unifex::upon_error([](auto)
+      {
+          // the acceptor is closed
+      })
+    | snp::start_detached();
+}
+
+void run(const mode& m, ssl::context& server_ctx, ssl::context& client_ctx, std::size_t connections, std::size_t handshakes, std::size_t threads)
+{
+    net::io_context server_ioc;
+    net::thread_pool pool(threads);
+
+    tcp::acceptor acceptor(server_ioc, endpoint_t(net::ip::make_address("127.0.0.1"), 0));
+    do_accept(acceptor, server_ctx, m, pool);
+
+    std::thread server([&server_ioc]{ server_ioc.run(); });
+
+    // every run starts without sessions, so the first handshake of each client is a full one,
+    // and there is room for a session per concurrent connection to the same peer
+    snp::tls_session_cache cache(20480, std::chrono::hours(1), 2 * connections);
+    cache.attach_client(client_ctx);
+
+    net::io_context ioc;
+    std::vector<std::unique_ptr<client>> clients;
+
+    for (std::size_t i = 0; i != connections; ++i)
+    {
+         clients.push_back(std::make_unique<client>(ioc, client_ctx, cache, m, handshakes));
+         clients.back()->start(acceptor.local_endpoint());
+    }
+
+    auto begin = steady_clock::now();
+    ioc.run();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin).count();
+
+    net::post(server_ioc, [&acceptor]{ acceptor.close(); });
+    server.join();
+
+    pool.join();
+
+    auto total = connections * handshakes;
+    std::size_t reused = 0;
+
+    for (auto& c : clients)
+         reused += c->reused;
+
+    std::cout << m.name << ": " << total << " connections in " << elapsed << " us, " << total * 1000000 / std::max<long>(elapsed, 1) << " conn/s";
+
+    if (m.tls)
+        std::cout << ", " << reused * 100 / total << "% resumed";
+
+    std::cout << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 5 && argc != 6)
+    {
+        std::cerr << "Usage: " << argv[0] << " <cert> <key> <connections> <handshakes> [<threads>]" << std::endl;
+
+        return 1;
+    }
+
+    std::size_t connections = std::stoul(argv[3]);
+    std::size_t handshakes = std::stoul(argv[4]);
+
+    std::size_t threads = argc == 6 ? std::stoul(argv[5]) : std::max(1u, std::thread::hardware_concurrency());
+
+    ssl::context server_ctx(ssl::context::tls_server);
+
+    server_ctx.use_certificate_chain_file(argv[1]);
+    server_ctx.use_private_key_file(argv[2], ssl::context::pem);
+
+    snp::tls_session_cache sessions;
+    sessions.attach_server(server_ctx);
+
+    ssl::context client_ctx(ssl::context::tls_client);
+
+    mode modes[] =
+    {
+        {"tcp", false, false, false},
+        {"full", true, false, false},
+        {"full offloaded", true, false, true},
+        {"resumed", true, true, false},
+        {"resumed offloaded", true, true, true}
+    };
+
+    for (auto& m : modes)
+         run(m, server_ctx, client_ctx, connections, handshakes, threads);
+
+    return 0;
+}
@@ -0,0 +1,227 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <atomic>
+#include <thread>
+#include <iostream>
+#include <snp.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/udp_benchmark.cpp -o /tmp/udp_benchmark
+
+namespace net = boost::asio;
+
+using udp = net::ip::udp;
+
+using endpoint_t = udp::endpoint;
+using error_code_t = boost::system::error_code;
+
+using steady_clock = std::chrono::steady_clock;
+
+struct mode
+{
+    const char* name;
+
+    bool batch;
+    bool offload;
+};
+
+// counts the datagrams that arrive, one per receive or a batch per recvmmsg
+class receiver
+{
+public:
+    receiver(net::io_context& ioc, const mode& m, std::size_t size, std::size_t batch) :
+    socket(ioc, endpoint_t(net::ip::make_address("127.0.0.1"), 0)), reader(batch, size, m.offload), buffer(size), m(m)
+    {
+        socket.set_option(net::socket_base::receive_buffer_size(8 << 20));
+    }
+
+    void start()
+    {
+        if (m.batch)
+            do_receive_batch();
+        else
+            do_receive_from();
+    }
+
+    void do_receive_from()
+    {
+        snp::async_receive_from(socket, net::buffer(buffer), sender)
+        | unifex::then([this](std::size_t)
+          {
+              ++received;
+              do_receive_from();
+          })
+        | unifex::upon_error([](auto)
+          {
+              // the socket is closed
+          })
+        | snp::start_detached();
+    }
+
+    void do_receive_batch()
+    {
+        snp::async_receive_batch(socket, reader)
+        | unifex::then([this](std::span<const snp::datagram> datagrams)
+          {
+              received += datagrams.size();
+              do_receive_batch();
+          })
+        | unifex::upon_error([](auto)
+          {
+          })
+        | snp::start_detached();
+    }
+
+    udp::socket socket;
+    std::atomic<std::size_t> received = 0;
+
+private:
+    snp::datagram_reader reader;
+    std::vector<char> buffer;
+
+    endpoint_t sender;
+    const mode& m;
+};
+
+// floods the receiver until the deadline, with one datagram per send or a batch per sendmmsg
+class sender
+{
+public:
+    sender(net::io_context& ioc, const mode& m, const endpoint_t& endpoint, std::size_t size, std::size_t batch) :
+    socket(ioc, udp::v4()), writer(batch * size, m.offload), payload(size, 'x'), endpoint(endpoint), m(m), batch(batch)
+    {
+        socket.set_option(net::socket_base::send_buffer_size(8 << 20));
+    }
+
+    void start(steady_clock::time_point deadline)
+    {
+        this->deadline = deadline;
+
+        if (m.batch)
+            do_send_batch();
+        else
+            do_send_to();
+    }
+
+    void do_send_to()
+    {
+        snp::async_send_to(socket, net::buffer(payload), endpoint)
+        | unifex::then([this](std::size_t)
+          {
+              ++sent;
+
+              if (steady_clock::now() < deadline)
+                  do_send_to();
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_send_to: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    void do_send_batch()
+    {
+        for (std::size_t i = 0; i != batch; ++i)
+             writer.add(endpoint, net::buffer(payload));
+
+        snp::async_send_batch(socket, writer)
+        | unifex::then([this](std::size_t n)
+          {
+              sent += n;
+
+              if (steady_clock::now() < deadline)
+                  do_send_batch();
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_send_batch: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    std::size_t sent = 0;
+
+private:
+    udp::socket socket;
+    snp::datagram_writer writer;
+
+    std::string payload;
+    endpoint_t endpoint;
+
+    const mode& m;
+    std::size_t batch;
+
+    steady_clock::time_point deadline;
+};
+
+void run(const mode& m, std::size_t size, std::size_t seconds, std::size_t batch)
+{
+    net::io_context rioc;
+    receiver r(rioc, m, size, batch);
+
+    r.start();
+    std::thread t([&rioc]{ rioc.run(); });
+
+    net::io_context ioc;
+    sender s(ioc, m, r.socket.local_endpoint(), size, batch);
+
+    auto begin = steady_clock::now();
+
+    s.start(begin + std::chrono::seconds(seconds));
+    ioc.run();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin).count();
+
+    // lets the receiver drain its socket buffer
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    net::post(rioc, [&r]{ r.socket.close(); });
+    t.join();
+
+    std::size_t received = r.received;
+    elapsed = std::max<long>(elapsed, 1);
+
+    std::cout << m.name << ": sent " << s.sent * 1000000 / elapsed << " pps, received " << received * 1000000 / elapsed << " pps, "
+              << received * size / elapsed << " MB/s, lost " << (s.sent - std::min(s.sent, received)) * 100 / std::max<std::size_t>(s.sent, 1) << "%" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3 && argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <size> <seconds> [<batch>]" << std::endl;
+
+        return 1;
+    }
+
+    std::size_t size = std::stoul(argv[1]);
+    std::size_t seconds = std::stoul(argv[2]);
+
+    std::size_t batch = argc == 4 ? std::stoul(argv[3]) : 64;
+
+    mode modes[] =
+    {
+        {"send_to/receive_from", false, false},
+        {"sendmmsg/recvmmsg", true, false},
+        {"sendmmsg/recvmmsg gso/gro", true, true}
+    };
+
+    for (auto& m : modes)
+         run(m, size, seconds, batch);
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#define BOOST_ASIO_HAS_IO_URING
+#define BOOST_ASIO_DISABLE_EPOLL
+
+#include <memory>
+#include <iostream>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <snp.hpp>
+#include <websocket_stream.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+
+// g++ -std=c++23 -Wall -O3 -Os -s -I include -l uring example/websocket_benchmark.cpp -o /tmp/websocket_benchmark
+
+namespace net = boost::asio;
+namespace beast = boost::beast;
+
+namespace websocket = beast::websocket;
+
+using tcp = net::ip::tcp;
+using buffer_t = beast::flat_buffer;
+
+using endpoint_t = tcp::endpoint;
+using error_code_t = boost::system::error_code;
+
+using steady_clock = std::chrono::steady_clock;
+
+template <typename Stream>
+class echo_session : public std::enable_shared_from_this<echo_session<Stream>>
+{
+public:
+    echo_session(tcp::socket socket) : ws(std::move(socket))
+    {
+        ws.next_layer().set_option(tcp::no_delay(true));
+    }
+
+    void start()
+    {
+        snp::async_accept(ws)
+        | unifex::then([this, self = this->shared_from_this()]
+          {
+              do_read();
+          })
+        | snp::start_detached();
+    }
+
+    void do_read()
+    {
+        snp::async_read(ws, buffer)
+        | unifex::then([this, self = this->shared_from_this()](std::size_t bytes_transferred)
+          {
+              ws.text(ws.got_text());
+
+              snp::async_write(ws, buffer.data())
+              | unifex::then([this, self](std::size_t)
+                {
+                    buffer.consume(buffer.size());
+                    do_read();
+                })
+              | snp::start_detached();
+          })
+        | unifex::upon_error([self = this->shared_from_this()](auto)
+          {
+              // the client has closed the connection
+          })
+        | snp::start_detached();
+    }
+
+private:
+    Stream ws;
+    buffer_t buffer;
+};
+
+template <typename Stream>
+class client
+{
+public:
+    client(net::io_context& ioc, std::size_t messages, std::size_t size) : ws(tcp::socket(ioc)), messages(messages), payload(size, 'x')
+    {
+    }
+
+    void start(const endpoint_t& endpoint)
+    {
+        ws.next_layer().connect(endpoint);
+        ws.next_layer().set_option(tcp::no_delay(true));
+
+        snp::async_handshake(ws, "localhost", "/")
+        | unifex::then([this]
+          {
+              do_write();
+          })
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_handshake: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+    void do_write()
+    {
+        snp::async_write(ws, net::buffer(payload))
+        | unifex::then([this](std::size_t)
+          {
+              snp::async_read(ws, buffer)
+              | unifex::then([this](std::size_t)
+                {
+                    buffer.consume(buffer.size());
+
+                    if (--messages)
+                        do_write();
+                    else
+                        do_close();
+                })
+              | snp::start_detached();
+          })
+        | snp::start_detached();
+    }
+
+    void do_close()
+    {
+        snp::async_close(ws, websocket::close_code::normal)
+        | unifex::upon_error([]<typename Error>(Error error)
+          {
+              if constexpr(std::is_same_v<Error, error_code_t>)
+                  std::cerr << "async_close: " << error.message() << std::endl;
+          })
+        | snp::start_detached();
+    }
+
+private:
+    Stream ws;
+    buffer_t buffer;
+
+    std::size_t messages;
+    std::string payload;
+};
+
+void do_accept(tcp::acceptor& acceptor, std::size_t connections, auto make_session)
+{
+    snp::async_accept(acceptor)
+    | unifex::then([&acceptor, connections, make_session](tcp::socket socket)
+      {
+          make_session(std::move(socket))->start();
+
+          if (connections > 1)
+              do_accept(acceptor, connections - 1, make_session);
+      })
+    | snp::start_detached();
+}
+
+template <typename Stream>
+void run(const char* name, std::size_t connections, std::size_t messages, std::size_t size)
+{
+    net::io_context ioc;
+    tcp::acceptor acceptor(ioc, endpoint_t(net::ip::make_address("127.0.0.1"), 0));
+
+    do_accept(acceptor, connections, [](tcp::socket socket)
+    {
+        return std::make_shared<echo_session<Stream>>(std::move(socket));
+    });
+
+    std::vector<std::unique_ptr<client<Stream>>> clients;
+
+    for (std::size_t i = 0; i != connections; ++i)
+    {
+         clients.push_back(std::make_unique<client<Stream>>(ioc, messages, size));
+         clients.back()->start(acceptor.local_endpoint());
+    }
+
+    auto begin = steady_clock::now();
+    ioc.run();
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(steady_clock::now() - begin).count();
+    auto total = connections * messages;
+
+    std::cout << name << ": " << total << " round trips of " << size << " bytes in " << elapsed << " us, "
+              << total * 1000000 / std::max<long>(elapsed, 1) << " msg/s, " << 2 * total * size / std::max<long>(elapsed, 1) << " MB/s" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] << " <connections> <messages> <size>" << std::endl;
+
+        return 1;
+    }
+
+    std::size_t connections = std::stoul(argv[1]);
+    std::size_t messages = std::stoul(argv[2]);
+    std::size_t size = std::stoul(argv[3]);
+
+    run<websocket::stream<tcp::socket>>("beast", connections, messages, size);
+    run<snp::websocket_stream<tcp::socket>>("snp", connections, messages, size);
+
+    return 0;
+}
@@ -10,15 +10,30 @@
 #ifndef ASIO_CONTEXT_HPP
 #define ASIO_CONTEXT_HPP
 
+#include <latch>
+#include <atomic>
 #include <chrono>
+#include <thread>
+#include <vector>
+#include <algorithm>
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <metrics.hpp>
+#include <chrome_trace.hpp>
+#include <placement.hpp>
+#include <stop_operation.hpp>
+
+#ifndef SNP_MAX_INLINE_DEPTH
+#define SNP_MAX_INLINE_DEPTH 16
+#endif
 
 namespace snp::asio
 {
     namespace net = boost::asio;
     using clock = std::chrono::steady_clock;
 
+    inline thread_local std::size_t inline_depth = 0;
+
     template <typename T, typename = std::void_t<>>
     struct choose : std::type_identity<net::steady_timer>
     {
@@ -42,7 +57,7 @@ namespace snp::asio
     template <typename T>
     using timer_t = typename select<T>::type;
 
-    template <typename T, typename U, bool B>
+    template <typename Executor, typename T, typename U, bool B>
     struct schedule_sender
     {
         using error_code_t = boost::system::error_code;
@@ -55,33 +70,82 @@ namespace snp::asio
 
         static constexpr bool sends_done = true;
 
-        explicit schedule_sender(net::io_context& ioc, const T& t = {}, U&& u = {}) : ioc(ioc), t(t), u(std::forward<U>(u))
+        explicit schedule_sender(const Executor& ex, const T& t = {}, U&& u = {}) : ex(ex), t(t), u(std::forward<U>(u))
         {
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, Executor>
         {
+            static constexpr std::string_view kind = std::is_same_v<T, bool> ? "schedule" : B ? "schedule_at" : "schedule_after";
+
             constexpr decltype(auto) start() noexcept
             {
                 if constexpr(std::is_same_v<T, bool>)
-                    net::post(ioc, [this]{ set_value(); });
+                {
+                    this->trace.submit();
+                    metrics::on_start<metrics::sender_index(kind)>();
+
+                    if constexpr(B && requires { ex.running_in_this_thread(); })
+                    {
+                        if (ex.running_in_this_thread() && inline_depth < SNP_MAX_INLINE_DEPTH)
+                            return dispatch();
+                    }
+
+                    net::post(ex, [this]
+                    {
+                        bool stop = this->stop_requested();
+
+                        this->trace.complete();
+                        this->trace.invoke(this->receiver, kind, stop);
+                        metrics::on_complete<metrics::sender_index(kind)>(!stop, stop);
+
+                        if (stop)
+                            unifex::set_done(std::move(this->receiver));
+                        else
+                            set_value();
+                    });
+                }
                 else
                     set_timer();
             }
 
+            void dispatch()
+            {
+                bool stop = this->stop_requested();
+
+                this->trace.complete();
+                this->trace.invoke(this->receiver, kind, stop);
+                metrics::on_complete<metrics::sender_index(kind)>(!stop, stop);
+
+                if (stop)
+                    return unifex::set_done(std::move(this->receiver));
+
+                ++inline_depth;
+                set_value();
+                --inline_depth;
+            }
+
             void set_value()
             {
                 try
                 {
-                    unifex::set_value(std::move(receiver));
+                    unifex::set_value(std::move(this->receiver));
                 }
                 catch (...)
                 {
-                    unifex::set_error(std::move(receiver), std::current_exception());
+                    unifex::set_error(std::move(this->receiver), std::current_exception());
                 }
             }
 
+            void deliver(error_code_t ec)
+            {
+                if (ec == net::error::operation_aborted)
+                    unifex::set_done(std::move(this->receiver));
+                else
+                    set_value();
+            }
+
             void set_timer()
             {
                 if constexpr(B)
@@ -89,17 +153,13 @@ namespace snp::asio
                 else
                     u.expires_from_now(t);
 
-                u.async_wait([this](error_code_t ec) mutable
+                this->initiate(ex, [this](auto cb)
                 {
-                    if (ec == net::error::operation_aborted)
-                        unifex::set_done(std::move(receiver));
-                    else
-                        set_value();
+                    u.async_wait(cb);
                 });
             }
 
-            Receiver receiver;
-            net::io_context& ioc;
+            Executor ex;
 
             T t;
             U u;
@@ -108,21 +168,31 @@ namespace snp::asio
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>(std::forward<Receiver>(receiver), ioc, std::move(t), std::move(u));
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, ex, std::move(t), std::move(u)};
         }
 
-        net::io_context& ioc;
+        Executor ex;
 
         T t;
         U u;
     };
 
-    struct scheduler
+    template <typename Executor, bool D>
+    struct basic_scheduler
     {
-        explicit scheduler(net::io_context& ioc) : ioc(&ioc)
+        explicit basic_scheduler(const Executor& ex) : ex(ex)
+        {
+        }
+
+        explicit basic_scheduler(net::io_context& ioc) : ex(ioc.get_executor())
         {
         }
 
+        constexpr decltype(auto) get_executor() const noexcept
+        {
+            return ex;
+        }
+
         constexpr decltype(auto) now() const noexcept
         {
             return clock::now();
@@ -130,57 +200,172 @@ namespace snp::asio
 
         constexpr decltype(auto) schedule() const noexcept
         {
-            return schedule_sender<bool, bool, 1>(*ioc);
+            return schedule_sender<Executor, bool, bool, D>(ex);
         }
 
         template <typename T>
         constexpr decltype(auto) schedule_at(const T& time_point) const noexcept
         {
-            return schedule_sender<T, timer_t<T>, 1>(*ioc, time_point, timer_t<T>(*ioc));
+            return schedule_sender<Executor, T, timer_t<T>, 1>(ex, time_point, timer_t<T>(ex));
         }
 
         template <typename T>
         constexpr decltype(auto) schedule_after(const T& duration) const noexcept
         {
-            return schedule_sender<T, timer_t<T>, 0>(*ioc, duration, timer_t<T>(*ioc));
+            return schedule_sender<Executor, T, timer_t<T>, 0>(ex, duration, timer_t<T>(ex));
         }
 
-        friend constexpr bool operator==(scheduler l, scheduler r) noexcept
+        friend constexpr bool operator==(basic_scheduler l, basic_scheduler r) noexcept
         {
-            return l.ioc == r.ioc;
+            return l.ex == r.ex;
         }
 
-        friend constexpr bool operator!=(scheduler l, scheduler r) noexcept
+        friend constexpr bool operator!=(basic_scheduler l, basic_scheduler r) noexcept
         {
-            return l.ioc != r.ioc;
+            return l.ex != r.ex;
         }
 
-        net::io_context* ioc;
+        Executor ex;
+    };
+
+    using executor_t = net::io_context::executor_type;
+
+    using scheduler = basic_scheduler<executor_t, 0>;
+    using dispatch_scheduler = basic_scheduler<executor_t, 1>;
+
+    using strand_scheduler = basic_scheduler<net::strand<executor_t>, 0>;
+
+    struct busy_stats
+    {
+        std::atomic<uint64_t> spin_ns = 0;
+        std::atomic<uint64_t> sleep_ns = 0;
+
+        std::atomic<uint64_t> polls = 0;
+        std::atomic<uint64_t> sleeps = 0;
     };
 
     struct context
     {
-        constexpr decltype(auto) get_scheduler() noexcept
+        decltype(auto) get_scheduler() noexcept
         {
             return scheduler(ioc);
         }
 
+        decltype(auto) get_dispatch_scheduler() noexcept
+        {
+            return dispatch_scheduler(ioc);
+        }
+
+        decltype(auto) get_strand_scheduler() noexcept
+        {
+            return strand_scheduler(ioc);
+        }
+
         net::io_context& get_io_context() noexcept
         {
             return ioc;
         }
 
-        constexpr decltype(auto) run()
+        decltype(auto) run()
         {
+            metrics::scoped_gauge running(metrics::context_threads);
+            chrome_trace::scoped_run traced;
+
             ioc.run();
         }
 
-        constexpr decltype(auto) stop()
+        // all the threads run the same io_context, the I/O objects whose senders are stopped have to be created with
+        // net::make_strand(ioc), the strand serializes the cancellation of an operation with its completion.
+        // the threads are pinned before any of them runs the context, if one of them can't be pinned none of them runs it
+        // and the error is thrown, a seccomp profile that denies set_mempolicy does so, pin the threads yourself to go on regardless
+        decltype(auto) run(const placement& p)
+        {
+            std::vector<std::thread> threads;
+            std::vector<error_code_t> errors(p.size());
+
+            std::latch pinned(p.size());
+
+            for (std::size_t i = 0; i != p.size(); ++i)
+                 threads.emplace_back([this, &p, &errors, &pinned, i]
+                 {
+                     errors[i] = p.pin(i);
+                     pinned.arrive_and_wait();
+
+                     if (std::ranges::any_of(errors, [](auto& ec){ return ec.failed(); }))
+                         return;
+
+                     metrics::scoped_gauge running(metrics::context_threads);
+                     chrome_trace::scoped_run traced;
+
+                     ioc.run();
+                 });
+
+            for (auto& t : threads)
+                 t.join();
+
+            for (auto& ec : errors)
+                 if (ec)
+                     throw boost::system::system_error(ec, "pin");
+        }
+
+        template <typename Rep, typename Period>
+        decltype(auto) run_busy(const std::chrono::duration<Rep, Period>& spin_budget)
+        {
+            auto ns = [](auto d){ return std::chrono::duration_cast<std::chrono::nanoseconds>(d).count(); };
+            auto last = clock::now();
+
+            metrics::scoped_gauge running(metrics::context_threads);
+            chrome_trace::scoped_run traced;
+
+            while (!ioc.stopped())
+            {
+                if (auto n = ioc.poll())
+                {
+                    auto now = clock::now();
+
+                    stats.spin_ns.fetch_add(ns(now - last), std::memory_order_relaxed);
+                    stats.polls.fetch_add(n, std::memory_order_relaxed);
+
+                    metrics::add(metrics::context_spin_ns, ns(now - last));
+                    metrics::add(metrics::context_polls, n);
+
+                    last = now;
+                }
+                else if (auto now = clock::now(); now - last >= spin_budget && !ioc.stopped())
+                {
+                    stats.spin_ns.fetch_add(ns(now - last), std::memory_order_relaxed);
+                    metrics::add(metrics::context_spin_ns, ns(now - last));
+
+                    // the polls since last found nothing to run, run_one blocks and then runs the handler that woke it up,
+                    // which ends before run_one returns, so its span holds both
+                    chrome_trace::instance().add_span("idle", last, now);
+
+                    ioc.run_one();
+                    last = clock::now();
+
+                    stats.sleep_ns.fetch_add(ns(last - now), std::memory_order_relaxed);
+                    stats.sleeps.fetch_add(1, std::memory_order_relaxed);
+
+                    metrics::add(metrics::context_sleep_ns, ns(last - now));
+                    metrics::add(metrics::context_sleeps);
+
+                    chrome_trace::instance().add_span("run_one", now, last);
+                }
+            }
+        }
+
+        const busy_stats& get_busy_stats() const noexcept
+        {
+            return stats;
+        }
+
+        decltype(auto) stop()
         {
             ioc.stop();
         }
 
         net::io_context ioc;
+        busy_stats stats;
     };
 }
 
@@ -188,6 +373,17 @@ namespace snp
 {
     using asio_context = snp::asio::context;
     using asio_scheduler = snp::asio::scheduler;
+    using asio_dispatch_scheduler = snp::asio::dispatch_scheduler;
+
+    using strand_scheduler = snp::asio::strand_scheduler;
+
+    template <typename Stream>
+    constexpr decltype(auto) stream_scheduler(Stream& stream)
+    {
+        using executor_t = std::remove_cvref_t<decltype(stream.get_executor())>;
+
+        return snp::asio::basic_scheduler<executor_t, 0>(stream.get_executor());
+    }
 }
 
 #endif
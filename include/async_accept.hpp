@@ -12,6 +12,7 @@
 
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
@@ -46,27 +47,35 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation;
+
+        template <typename Receiver>
+        struct bind
         {
+            template <typename... Sockets>
+            using type = stop_operation<operation<Receiver>, Receiver, executor_of_t<Acceptor>, Sockets...>;
+        };
+
+        template <typename Receiver>
+        struct operation : impl<bind<Receiver>::template type, Acceptor>::type
+        {
+            static constexpr std::string_view kind = "async_accept";
+
             constexpr decltype(auto) start() noexcept
             {
-                acceptor.async_accept([receiver = std::move(receiver)](error_code_t ec, auto... socket) mutable
+                this->initiate(acceptor.get_executor(), [this](auto cb)
                 {
-                    if (!ec)
-                        unifex::set_value(std::move(receiver), std::move(socket)...);
-                    else
-                        unifex::set_error(std::move(receiver), ec);
+                    acceptor.async_accept(cb);
                 });
             }
 
-            Receiver receiver;
             Acceptor& acceptor;
         };
 
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), acceptor};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, acceptor};
         }
 
         Acceptor& acceptor;
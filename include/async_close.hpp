@@ -12,6 +12,7 @@
 
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
@@ -35,33 +36,31 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>>
         {
+            static constexpr std::string_view kind = "async_close";
+
             constexpr decltype(auto) start() noexcept
             {
-                if constexpr(requires { typename Stream::is_deflate_supported; })
-                    stream.async_close(context, [receiver = std::move(receiver)](error_code_t ec) mutable
-                    {
-                        if (!ec)
-                            unifex::set_value(std::move(receiver));
-                        else
-                            unifex::set_error(std::move(receiver), ec);
-                    });
-                else
-                    net::post(context, [&]
-                    {
-                        error_code_t ec;
-                        stream.close(ec);
-
-                        if (!ec)
-                            unifex::set_value(std::move(receiver));
-                        else
-                            unifex::set_error(std::move(receiver), ec);
-                    });
+                this->initiate(stream.get_executor(), [this](auto cb)
+                {
+                    if constexpr(requires { typename Stream::is_deflate_supported; })
+                        stream.async_close(context, cb);
+                    else
+                        net::post(context, [this, cb]() mutable
+                        {
+                            error_code_t ec;
+
+                            if (this->stop_requested())
+                                ec = net::error::operation_aborted;
+                            else
+                                stream.close(ec);
+
+                            cb(ec);
+                        });
+                });
             }
 
-            Receiver receiver;
-
             Stream& stream;
             Context context;
         };
@@ -69,7 +68,7 @@ namespace snp
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), stream, context};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, context};
         }
 
         Stream& stream;
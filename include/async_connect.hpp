@@ -12,6 +12,7 @@
 
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
@@ -36,21 +37,18 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>, endpoint_t>
         {
+            static constexpr std::string_view kind = "async_connect";
+
             constexpr decltype(auto) start() noexcept
             {
-                net::async_connect(stream, endpoints, [receiver = std::move(receiver)](error_code_t ec, endpoint_t ep) mutable
+                this->initiate(stream.get_executor(), [this](auto cb)
                 {
-                    if (!ec)
-                        unifex::set_value(std::move(receiver), ep);
-                    else
-                        unifex::set_error(std::move(receiver), ec);
+                    net::async_connect(stream, endpoints, cb);
                 });
             }
 
-            Receiver receiver;
-
             Stream& stream;
             Endpoints endpoints;
         };
@@ -58,7 +56,7 @@ namespace snp
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), stream, endpoints};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, endpoints};
         }
 
         Stream& stream;
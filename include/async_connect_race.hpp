@@ -0,0 +1,269 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_CONNECT_RACE_HPP
+#define ASYNC_CONNECT_RACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <optional>
+#include <boost/asio.hpp>
+#include <unifex/get_stop_token.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <tracer.hpp>
+#include <metrics.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    template <typename Stream, typename Endpoints>
+    struct async_connect_race
+    {
+        using error_code_t = boost::system::error_code;
+        using endpoint_t = typename Stream::protocol_type::endpoint;
+
+        using duration = std::chrono::steady_clock::duration;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<endpoint_t>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_connect_race(Stream& stream, Endpoints&& endpoints, duration delay = std::chrono::milliseconds(250)) :
+        stream(stream), endpoints(std::forward<Endpoints>(endpoints)), delay(delay)
+        {
+        }
+
+        template <typename Receiver>
+        struct operation
+        {
+            static constexpr std::string_view kind = "async_connect_race";
+            static constexpr std::size_t index = metrics::sender_index(kind);
+
+            struct attempt
+            {
+                Stream socket;
+                endpoint_t endpoint;
+            };
+
+            struct on_stop
+            {
+                void operator()() noexcept
+                {
+                    ++op->outstanding;
+
+                    net::post(op->stream.get_executor(), [op = op]
+                    {
+                        op->stopped = true;
+                        op->cancel();
+
+                        op->arrive();
+                    });
+                }
+
+                operation* op;
+            };
+
+            using stop_token_t = unifex::stop_token_type_t<Receiver>;
+            using callback_t = typename stop_token_t::template callback_type<on_stop>;
+
+            operation(Receiver receiver, Stream& stream, const Endpoints& endpoints, duration delay) :
+            receiver(std::move(receiver)), stream(stream), timer(stream.get_executor()), delay(delay)
+            {
+                std::vector<endpoint_t> primary;
+                std::vector<endpoint_t> secondary;
+
+                for (auto it = std::begin(endpoints); it != std::end(endpoints); ++it)
+                {
+                     endpoint_t ep = *it;
+
+                     if (primary.empty() || ep.address().is_v6() == primary.front().address().is_v6())
+                         primary.push_back(ep);
+                     else
+                         secondary.push_back(ep);
+                }
+
+                attempts.reserve(primary.size() + secondary.size());
+
+                for (std::size_t i = 0; i != std::max(primary.size(), secondary.size()); ++i)
+                {
+                     if (i < primary.size())
+                         attempts.emplace_back(Stream(stream.get_executor()), primary[i]);
+
+                     if (i < secondary.size())
+                         attempts.emplace_back(Stream(stream.get_executor()), secondary[i]);
+                }
+            }
+
+            operation(operation&&) = delete;
+
+            constexpr decltype(auto) start() noexcept
+            {
+                if (unifex::get_stop_token(receiver).stop_requested())
+                    return unifex::set_done(std::move(receiver));
+
+                trace.submit();
+                metrics::on_start<index>();
+
+                if (attempts.empty())
+                {
+                    finish(false);
+
+                    return unifex::set_error(std::move(receiver), error_code_t(net::error::host_not_found));
+                }
+
+                callback.emplace(unifex::get_stop_token(receiver), on_stop{this});
+
+                launch();
+                arrive();
+            }
+
+            void launch()
+            {
+                auto index = next++;
+                ++outstanding;
+
+                attempts[index].socket.async_connect(attempts[index].endpoint, [this, index](error_code_t ec)
+                {
+                    on_connect(index, ec);
+                });
+
+                if (next != attempts.size())
+                    wait();
+            }
+
+            // a wait is stale once the timer was rearmed or disarmed, its completion may already be queued with success,
+            // which cancel() doesn't change
+            void wait()
+            {
+                ++outstanding;
+                timer.expires_after(delay);
+
+                timer.async_wait([this, armed = ++generation](error_code_t ec)
+                {
+                    if (!ec && armed == generation && winner < 0 && !stopped && next != attempts.size())
+                        launch();
+
+                    arrive();
+                });
+            }
+
+            void on_connect(std::size_t index, error_code_t ec)
+            {
+                if (!ec && winner < 0 && !stopped)
+                {
+                    winner = index;
+                    cancel();
+                }
+                else if (winner < 0)
+                {
+                    if (ec != net::error::operation_aborted)
+                        last = ec;
+
+                    if (!stopped && next != attempts.size())
+                    {
+                        ++generation;
+                        timer.cancel();
+
+                        launch();
+                    }
+                }
+
+                arrive();
+            }
+
+            void cancel()
+            {
+                error_code_t ec;
+                timer.cancel();
+
+                for (std::size_t i = 0; i != next; ++i)
+                     if (i != static_cast<std::size_t>(winner))
+                         attempts[i].socket.close(ec);
+            }
+
+            void arrive()
+            {
+                if (--outstanding)
+                    return;
+
+                callback.reset();
+
+                if (outstanding)
+                    return;
+
+                finish(stopped);
+
+                if (winner >= 0)
+                {
+                    stream = std::move(attempts[winner].socket);
+                    unifex::set_value(std::move(receiver), attempts[winner].endpoint);
+                }
+                else if (stopped)
+                    unifex::set_done(std::move(receiver));
+                else
+                    unifex::set_error(std::move(receiver), last);
+            }
+
+            // the tracer and the metrics see the race as a single operation, from its start to the receiver being called
+            void finish(bool stop) noexcept
+            {
+                bool ok = winner >= 0;
+
+                trace.complete();
+                trace.invoke(receiver, kind, !ok);
+                metrics::on_complete<index>(ok, stop && !ok);
+            }
+
+            Receiver receiver;
+            Stream& stream;
+
+            net::steady_timer timer;
+            duration delay;
+
+            std::vector<attempt> attempts;
+            std::size_t next = 0;
+
+            std::size_t generation = 0;
+
+            int winner = -1;
+            bool stopped = false;
+
+            error_code_t last = net::error::host_unreachable;
+            std::atomic<std::size_t> outstanding = 1;
+
+            std::optional<callback_t> callback;
+            UNIFEX_NO_UNIQUE_ADDRESS trace_point<Receiver> trace;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>(std::forward<Receiver>(receiver), stream, endpoints, delay);
+        }
+
+        Stream& stream;
+        Endpoints endpoints;
+
+        duration delay;
+    };
+
+    template <typename Stream, typename Endpoints>
+    async_connect_race(Stream& stream, Endpoints&& endpoints) -> async_connect_race<Stream, Endpoints>;
+
+    template <typename Stream, typename Endpoints, typename Duration>
+    async_connect_race(Stream& stream, Endpoints&& endpoints, Duration delay) -> async_connect_race<Stream, Endpoints>;
+}
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
@@ -35,24 +36,21 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>>
         {
+            static constexpr std::string_view kind = "async_handshake";
+
             constexpr decltype(auto) start() noexcept
             {
-                std::apply([this]<typename... Brgs>(Brgs&&... brgs)
+                this->initiate(stream.get_executor(), [this](auto cb)
                 {
-                    stream.async_handshake(std::forward<Brgs>(brgs)..., [receiver = std::move(receiver)](error_code_t ec) mutable
+                    std::apply([&]<typename... Brgs>(Brgs&&... brgs)
                     {
-                        if (!ec)
-                            unifex::set_value(std::move(receiver));
-                        else
-                            unifex::set_error(std::move(receiver), ec);
-                    });
-                }, std::move(args));
+                        stream.async_handshake(std::forward<Brgs>(brgs)..., cb);
+                    }, std::move(args));
+                });
             }
 
-            Receiver receiver;
-
             Stream& stream;
             std::tuple<Args...> args;
         };
@@ -60,7 +58,7 @@ namespace snp
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), stream, std::move(args_)};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, std::move(args_)};
         }
 
         Stream& stream;
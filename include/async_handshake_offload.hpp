@@ -0,0 +1,77 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_HANDSHAKE_OFFLOAD_HPP
+#define ASYNC_HANDSHAKE_OFFLOAD_HPP
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <tls_handshake.hpp>
+#include <stop_operation.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+    namespace ssl = net::ssl;
+
+    // an ssl handshake whose cryptography runs on the executor ex, e.g. of a net::thread_pool, the reads and writes stay on the stream
+    template <typename Stream, typename Executor>
+    struct async_handshake_offload
+    {
+        using error_code_t = boost::system::error_code;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_handshake_offload(Stream& stream, ssl::stream_base::handshake_type type, const Executor& ex) : stream(stream), type(type), ex(ex)
+        {
+        }
+
+        template <typename Receiver>
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>>
+        {
+            static constexpr std::string_view kind = "async_handshake_offload";
+
+            constexpr decltype(auto) start() noexcept
+            {
+                this->initiate(stream.get_executor(), [this](auto cb)
+                {
+                    if constexpr(requires { stream.async_handshake(type, ex, cb); })
+                        stream.async_handshake(type, ex, cb);
+                    else
+                        tls::async_handshake(stream, type, ex, cb);
+                });
+            }
+
+            Stream& stream;
+
+            ssl::stream_base::handshake_type type;
+            Executor ex;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, type, ex};
+        }
+
+        Stream& stream;
+
+        ssl::stream_base::handshake_type type;
+        Executor ex;
+    };
+}
+
+#endif
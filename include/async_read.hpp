@@ -12,6 +12,7 @@
 
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
@@ -38,26 +39,21 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>, std::size_t>
         {
+            static constexpr std::string_view kind = "async_read";
+
             constexpr decltype(auto) start() noexcept
             {
-                auto cb = [receiver = std::move(receiver)](error_code_t ec, std::size_t bytes_transferred) mutable
+                this->initiate(stream.get_executor(), [this](auto cb)
                 {
-                    if (!ec)
-                        unifex::set_value(std::move(receiver), bytes_transferred);
+                    if constexpr(requires { typename Stream::is_deflate_supported; })
+                        stream.async_read(buffer, cb);
                     else
-                        unifex::set_error(std::move(receiver), ec);
-                };
-
-                if constexpr(requires { typename Stream::is_deflate_supported; })
-                    stream.async_read(buffer, cb);
-                else
-                    net::async_read(stream, buffer, cb);
+                        net::async_read(stream, buffer, cb);
+                });
             }
 
-            Receiver receiver;
-
             Stream& stream;
             buffer_t<Stream, Buffer> buffer;
         };
@@ -65,7 +61,7 @@ namespace snp
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), stream, buffer};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, buffer};
         }
 
         Stream& stream;
@@ -0,0 +1,107 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_READ_REQUEST_HPP
+#define ASYNC_READ_REQUEST_HPP
+
+#include <span>
+#include <boost/asio.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <http_parser.hpp>
+#include <stop_operation.hpp>
+
+namespace snp::http
+{
+    namespace net = boost::asio;
+
+    template <typename Stream>
+    struct async_read_request
+    {
+        using error_code_t = boost::system::error_code;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<std::span<const request>>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_read_request(Stream& stream, request_reader& reader) : stream(stream), reader(reader)
+        {
+        }
+
+        struct step
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                if (started)
+                {
+                    if (ec)
+                        return self.complete(ec, 0);
+
+                    reader.commit(n);
+
+                    if (auto count = reader.parse(ec); count || ec)
+                        return self.complete(ec, count);
+                }
+
+                started = true;
+                stream.async_read_some(reader.prepare(), std::move(self));
+            }
+
+            Stream& stream;
+            request_reader& reader;
+
+            bool started = false;
+        };
+
+        template <typename Receiver>
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>, std::size_t>
+        {
+            static constexpr std::string_view kind = "async_read_request";
+
+            constexpr decltype(auto) start() noexcept
+            {
+                error_code_t ec;
+
+                if (reader.parse(ec) || ec)
+                    return this->complete_inline(ec, 0);
+
+                this->initiate(stream.get_executor(), [this](auto cb)
+                {
+                    net::async_compose<decltype(cb), void(error_code_t, std::size_t)>(step{stream, reader}, cb, stream);
+                });
+            }
+
+            void deliver(error_code_t ec, std::size_t)
+            {
+                if (ec)
+                    unifex::set_error(std::move(this->receiver), ec);
+                else
+                    unifex::set_value(std::move(this->receiver), reader.batch());
+            }
+
+            Stream& stream;
+            request_reader& reader;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, reader};
+        }
+
+        Stream& stream;
+        request_reader& reader;
+    };
+}
+
+#endif
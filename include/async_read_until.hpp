@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_READ_UNTIL_HPP
+#define ASYNC_READ_UNTIL_HPP
+
+#include <string>
+#include <string_view>
+#include <boost/asio.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <simd.hpp>
+#include <buffered_stream.hpp>
+#include <stop_operation.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    template <typename Stream>
+    struct async_read_until
+    {
+        using error_code_t = boost::system::error_code;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<std::string_view>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_read_until(buffered_stream<Stream>& stream, std::string_view delim, std::size_t max_size = 1 << 20) :
+        stream(stream), delim(delim), max_size(max_size)
+        {
+        }
+
+        // returns the length of the match including the delimiter, or 0, scanned remembers how far the
+        // buffered bytes have been searched, so that every byte is only scanned once however many reads it takes
+        static std::size_t scan(buffered_stream<Stream>& stream, std::string_view delim, std::size_t& scanned) noexcept
+        {
+            auto data = stream.buffered();
+            auto pos = simd::find(data.data() + scanned, data.size() - scanned, delim);
+
+            if (pos != simd::npos)
+                return scanned + pos + delim.size();
+
+            if (data.size() >= delim.size())
+                scanned = data.size() - delim.size() + 1;
+
+            return 0;
+        }
+
+        struct step
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                if (started)
+                {
+                    if (ec)
+                        return self.complete(ec, 0);
+
+                    stream.commit(n);
+
+                    if (auto length = scan(stream, delim, scanned))
+                        return self.complete({}, length);
+                }
+
+                started = true;
+                auto buffer = stream.prepare(max_size);
+
+                if (!buffer.size())
+                    return self.complete(net::error::not_found, 0);
+
+                stream.next_layer().async_read_some(buffer, std::move(self));
+            }
+
+            buffered_stream<Stream>& stream;
+            std::string_view delim;
+
+            std::size_t max_size;
+            std::size_t& scanned;
+
+            bool started = false;
+        };
+
+        template <typename Receiver>
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<buffered_stream<Stream>>, std::size_t>
+        {
+            static constexpr std::string_view kind = "async_read_until";
+
+            constexpr decltype(auto) start() noexcept
+            {
+                if (auto length = scan(stream, delim, scanned))
+                    return this->complete_inline({}, length);
+
+                this->initiate(stream.get_executor(), [this](auto cb)
+                {
+                    net::async_compose<decltype(cb), void(error_code_t, std::size_t)>(step{stream, delim, max_size, scanned}, cb, stream.next_layer());
+                });
+            }
+
+            // the match stays in the buffer of the stream, the view is valid until the next read
+            void deliver(error_code_t ec, std::size_t length)
+            {
+                if (ec)
+                    return unifex::set_error(std::move(this->receiver), ec);
+
+                std::string_view match(stream.buffered().data(), length);
+                stream.consume(length);
+
+                unifex::set_value(std::move(this->receiver), match);
+            }
+
+            buffered_stream<Stream>& stream;
+            std::string delim;
+
+            std::size_t max_size;
+            std::size_t scanned = 0;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, delim, max_size};
+        }
+
+        buffered_stream<Stream>& stream;
+        std::string delim;
+
+        std::size_t max_size;
+    };
+}
+
+#endif
@@ -0,0 +1,111 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_RECEIVE_BATCH_HPP
+#define ASYNC_RECEIVE_BATCH_HPP
+
+#include <span>
+#include <boost/asio.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <datagram_batch.hpp>
+#include <stop_operation.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // receives the datagrams queued on the socket with a single recvmmsg, once at least one is there,
+    // and sends a span of them, which stays valid until the next receive of the reader
+    template <typename Socket>
+    struct async_receive_batch
+    {
+        using error_code_t = boost::system::error_code;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<std::span<const datagram>>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_receive_batch(Socket& socket, datagram_reader& reader) : socket(socket), reader(reader)
+        {
+        }
+
+        struct step
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {})
+            {
+                std::size_t n = 0;
+
+                if (!ec)
+                    n = reader.receive(socket.native_handle(), ec);
+
+                if (ec == net::error::would_block)
+                {
+                    waited = true;
+
+                    return socket.async_wait(Socket::wait_read, std::move(self));
+                }
+
+                // the datagrams were already queued, the completion goes through the executor like any other
+                if (!waited)
+                    return net::post(socket.get_executor(), [self = std::move(self), ec, n]() mutable
+                    {
+                        self.complete(ec, n);
+                    });
+
+                self.complete(ec, n);
+            }
+
+            Socket& socket;
+            datagram_reader& reader;
+
+            bool waited = false;
+        };
+
+        template <typename Receiver>
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Socket>, std::size_t>
+        {
+            static constexpr std::string_view kind = "async_receive_batch";
+
+            constexpr decltype(auto) start() noexcept
+            {
+                this->initiate(socket.get_executor(), [this](auto cb)
+                {
+                    net::async_compose<decltype(cb), void(error_code_t, std::size_t)>(step{socket, reader}, cb, socket);
+                });
+            }
+
+            void deliver(error_code_t ec, std::size_t)
+            {
+                if (ec)
+                    unifex::set_error(std::move(this->receiver), ec);
+                else
+                    unifex::set_value(std::move(this->receiver), reader.batch());
+            }
+
+            Socket& socket;
+            datagram_reader& reader;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, socket, reader};
+        }
+
+        Socket& socket;
+        datagram_reader& reader;
+    };
+}
+
+#endif
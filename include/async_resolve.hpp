@@ -10,13 +10,36 @@
 #ifndef ASYNC_RESOLVE_HPP
 #define ASYNC_RESOLVE_HPP
 
+#include <string>
+#include <concepts>
+#include <optional>
 #include <boost/asio.hpp>
+#include <unifex/get_stop_token.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
     namespace net = boost::asio;
 
+    struct resolve_waiter
+    {
+        virtual ~resolve_waiter() = default;
+
+        virtual void complete(const boost::system::error_code& ec, const net::ip::tcp::resolver::results_type& results) = 0;
+    };
+
+    // a resolver that answers lookups itself, such as resolver_cache or dns_resolver, lookup returns true when
+    // the answer is available immediately, otherwise the waiter is completed later unless cancel removes it first
+    template <typename Resolver>
+    concept resolve_service = requires (Resolver& r, const std::string& s, resolve_waiter* w, boost::system::error_code& ec, net::ip::tcp::resolver::results_type& results)
+    {
+        { r.lookup(s, s, w, ec, results) } -> std::same_as<bool>;
+        { r.cancel(s, s, w) } -> std::same_as<bool>;
+
+        r.get_executor();
+    };
+
     template <typename Context>
     struct async_resolve
     {
@@ -38,20 +61,19 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, tcp::resolver::executor_type, results_type>
         {
+            static constexpr std::string_view kind = "async_resolve";
+
             constexpr decltype(auto) start() noexcept
             {
-                resolver.async_resolve(host, service, [receiver = std::move(receiver)](error_code_t ec, results_type endpoints) mutable
+                this->initiate(resolver.get_executor(), [this](auto cb)
                 {
-                    if (!ec)
-                        unifex::set_value(std::move(receiver), endpoints);
-                    else
-                        unifex::set_error(std::move(receiver), ec);
+                    this->on_cancel([this]{ resolver.cancel(); });
+                    resolver.async_resolve(host, service, cb);
                 });
             }
 
-            Receiver receiver;
             tcp::resolver resolver;
 
             std::string host;
@@ -61,7 +83,7 @@ namespace snp
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), tcp::resolver{context}, host, service};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, tcp::resolver{context}, host, service};
         }
 
         Context& context;
@@ -69,6 +91,128 @@ namespace snp
         std::string host;
         std::string service;
     };
+
+    template <resolve_service Resolver>
+    struct async_resolve<Resolver>
+    {
+        using tcp = net::ip::tcp;
+
+        using error_code_t = boost::system::error_code;
+        using results_type = tcp::resolver::results_type;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<results_type>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_resolve(Resolver& resolver, const std::string& host, const std::string& service) : resolver(resolver), host(host), service(service)
+        {
+        }
+
+        template <typename Receiver>
+        struct operation : resolve_waiter
+        {
+            static constexpr std::string_view kind = "async_resolve";
+            static constexpr std::size_t index = metrics::sender_index(kind);
+
+            struct on_stop
+            {
+                void operator()() noexcept
+                {
+                    if (op->resolver.cancel(op->host, op->service, op))
+                        net::post(op->resolver.get_executor(), [op = op]
+                        {
+                            op->callback.reset();
+
+                            op->trace.complete();
+                            op->trace.invoke(op->receiver, kind, true);
+                            metrics::on_complete<index>(false, true);
+
+                            unifex::set_done(std::move(op->receiver));
+                        });
+                }
+
+                operation* op;
+            };
+
+            using stop_token_t = unifex::stop_token_type_t<Receiver>;
+            using callback_t = typename stop_token_t::template callback_type<on_stop>;
+
+            operation(Receiver receiver, Resolver& resolver, const std::string& host, const std::string& service) :
+            receiver(std::move(receiver)), resolver(resolver), host(host), service(service)
+            {
+            }
+
+            operation(operation&&) = delete;
+
+            constexpr decltype(auto) start() noexcept
+            {
+                auto token = unifex::get_stop_token(receiver);
+
+                if (token.stop_requested())
+                    return unifex::set_done(std::move(receiver));
+
+                error_code_t ec;
+                results_type results;
+
+                trace.submit();
+                metrics::on_start<index>();
+
+                callback.emplace(token, on_stop{this});
+
+                if (resolver.lookup(host, service, this, ec, results))
+                {
+                    callback.reset();
+
+                    return deliver(ec, results);
+                }
+
+                if (token.stop_requested())
+                    on_stop{this}();
+            }
+
+            void complete(const error_code_t& ec, const results_type& results) override
+            {
+                callback.reset();
+                deliver(ec, results);
+            }
+
+            void deliver(error_code_t ec, const results_type& results)
+            {
+                trace.complete();
+                trace.invoke(receiver, kind, ec.failed());
+                metrics::on_complete<index>(!ec, ec == net::error::operation_aborted);
+
+                if (ec)
+                    unifex::set_error(std::move(receiver), ec);
+                else
+                    unifex::set_value(std::move(receiver), results);
+            }
+
+            Receiver receiver;
+            Resolver& resolver;
+
+            std::string host;
+            std::string service;
+
+            std::optional<callback_t> callback;
+            UNIFEX_NO_UNIQUE_ADDRESS trace_point<Receiver> trace;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>(std::forward<Receiver>(receiver), resolver, host, service);
+        }
+
+        Resolver& resolver;
+
+        std::string host;
+        std::string service;
+    };
 }
 
 #endif
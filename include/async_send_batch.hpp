@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_SEND_BATCH_HPP
+#define ASYNC_SEND_BATCH_HPP
+
+#include <boost/asio.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <datagram_batch.hpp>
+#include <stop_operation.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // sends every datagram queued in the writer with sendmmsg, waiting whenever the socket buffer is full,
+    // sends the number of datagrams sent, and empties the writer once all of them are sent. on an error or a stop the writer
+    // keeps the datagrams not sent yet and writer.sent counts those that were, another async_send_batch resumes after them
+    // and counts them too, writer.clear() drops them
+    template <typename Socket>
+    struct async_send_batch
+    {
+        using error_code_t = boost::system::error_code;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<std::size_t>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_send_batch(Socket& socket, datagram_writer& writer) : socket(socket), writer(writer)
+        {
+        }
+
+        struct step
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {})
+            {
+                std::size_t n = 0;
+
+                if (!ec)
+                    n = writer.send(socket.native_handle(), ec);
+
+                if (ec == net::error::would_block)
+                {
+                    waited = true;
+
+                    return socket.async_wait(Socket::wait_write, std::move(self));
+                }
+
+                if (!waited)
+                    return net::post(socket.get_executor(), [self = std::move(self), ec, n]() mutable
+                    {
+                        self.complete(ec, n);
+                    });
+
+                self.complete(ec, n);
+            }
+
+            Socket& socket;
+            datagram_writer& writer;
+
+            bool waited = false;
+        };
+
+        template <typename Receiver>
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Socket>, std::size_t>
+        {
+            static constexpr std::string_view kind = "async_send_batch";
+
+            constexpr decltype(auto) start() noexcept
+            {
+                this->initiate(socket.get_executor(), [this](auto cb)
+                {
+                    net::async_compose<decltype(cb), void(error_code_t, std::size_t)>(step{socket, writer}, cb, socket);
+                });
+            }
+
+            void deliver(error_code_t ec, std::size_t n)
+            {
+                if (ec)
+                    return unifex::set_error(std::move(this->receiver), ec);
+
+                writer.clear();
+                unifex::set_value(std::move(this->receiver), n);
+            }
+
+            Socket& socket;
+            datagram_writer& writer;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, socket, writer};
+        }
+
+        Socket& socket;
+        datagram_writer& writer;
+    };
+}
+
+#endif
@@ -0,0 +1,73 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_SEND_TO_HPP
+#define ASYNC_SEND_TO_HPP
+
+#include <boost/asio.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // sends buffer as a single datagram to endpoint
+    template <typename Socket>
+    struct async_send_to
+    {
+        using error_code_t = boost::system::error_code;
+        using endpoint_t = typename Socket::endpoint_type;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<std::size_t>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        template <typename Buffer>
+        async_send_to(Socket& socket, Buffer&& buffer, const endpoint_t& endpoint) : socket(socket), buffer(std::forward<Buffer>(buffer)), endpoint(endpoint)
+        {
+        }
+
+        template <typename Receiver>
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Socket>, std::size_t>
+        {
+            static constexpr std::string_view kind = "async_send_to";
+
+            constexpr decltype(auto) start() noexcept
+            {
+                this->initiate(socket.get_executor(), [this](auto cb)
+                {
+                    socket.async_send_to(buffer, endpoint, cb);
+                });
+            }
+
+            Socket& socket;
+            net::const_buffer buffer;
+
+            endpoint_t endpoint;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, socket, buffer, endpoint};
+        }
+
+        Socket& socket;
+        net::const_buffer buffer;
+
+        endpoint_t endpoint;
+    };
+}
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
@@ -46,23 +47,20 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Timer>>
         {
+            static constexpr std::string_view kind = "async_wait";
+
             constexpr decltype(auto) start() noexcept
             {
                 timer.expires_from_now(dur);
 
-                timer.async_wait([receiver = std::move(receiver)](error_code_t ec) mutable
+                this->initiate(timer.get_executor(), [this](auto cb)
                 {
-                    if (!ec)
-                        unifex::set_value(std::move(receiver));
-                    else
-                        unifex::set_error(std::move(receiver), ec);
+                    timer.async_wait(cb);
                 });
             }
 
-            Receiver receiver;
-
             Timer& timer;
             duration dur;
         };
@@ -70,7 +68,7 @@ namespace snp
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), timer, dur};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, timer, dur};
         }
 
         Timer& timer;
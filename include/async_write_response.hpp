@@ -0,0 +1,78 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef ASYNC_WRITE_RESPONSE_HPP
+#define ASYNC_WRITE_RESPONSE_HPP
+
+#include <boost/asio.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <http_parser.hpp>
+#include <stop_operation.hpp>
+
+namespace snp::http
+{
+    namespace net = boost::asio;
+
+    // writes every response queued in the writer with a single write, and empties the writer once it is done
+    template <typename Stream>
+    struct async_write_response
+    {
+        using error_code_t = boost::system::error_code;
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = Variant<Tuple<std::size_t>>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = Variant<error_code_t>;
+
+        static constexpr bool sends_done = true;
+
+        async_write_response(Stream& stream, response_writer& writer) : stream(stream), writer(writer)
+        {
+        }
+
+        template <typename Receiver>
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>, std::size_t>
+        {
+            static constexpr std::string_view kind = "async_write_response";
+
+            constexpr decltype(auto) start() noexcept
+            {
+                this->initiate(stream.get_executor(), [this](auto cb)
+                {
+                    net::async_write(stream, writer.buffer(), cb);
+                });
+            }
+
+            void deliver(error_code_t ec, std::size_t n)
+            {
+                writer.clear();
+
+                if (ec)
+                    unifex::set_error(std::move(this->receiver), ec);
+                else
+                    unifex::set_value(std::move(this->receiver), n);
+            }
+
+            Stream& stream;
+            response_writer& writer;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, writer};
+        }
+
+        Stream& stream;
+        response_writer& writer;
+    };
+}
+
+#endif
@@ -12,6 +12,7 @@
 
 #include <boost/asio.hpp>
 #include <unifex/receiver_concepts.hpp>
+#include <stop_operation.hpp>
 
 namespace snp
 {
@@ -36,21 +37,18 @@ namespace snp
         }
 
         template <typename Receiver>
-        struct operation
+        struct operation : stop_operation<operation<Receiver>, Receiver, executor_of_t<Stream>, std::size_t>
         {
+            static constexpr std::string_view kind = "async_write_some";
+
             constexpr decltype(auto) start() noexcept
             {
-                stream.async_write_some(buffer, [receiver = std::move(receiver)](error_code_t ec, std::size_t bytes_transferred) mutable
+                this->initiate(stream.get_executor(), [this](auto cb)
                 {
-                    if (!ec)
-                        unifex::set_value(std::move(receiver), bytes_transferred);
-                    else
-                        unifex::set_error(std::move(receiver), ec);
+                    stream.async_write_some(buffer, cb);
                 });
             }
 
-            Receiver receiver;
-
             Stream& stream;
             net::mutable_buffer buffer;
         };
@@ -58,7 +56,7 @@ namespace snp
         template <typename Receiver>
         constexpr decltype(auto) connect(Receiver&& receiver)
         {
-            return operation<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), stream, buffer};
+            return operation<std::remove_cvref_t<Receiver>>{{std::forward<Receiver>(receiver)}, stream, buffer};
         }
 
         Stream& stream;
@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef BROADCAST_CHANNEL_HPP
+#define BROADCAST_CHANNEL_HPP
+
+#include <set>
+#include <deque>
+#include <vector>
+#include <string_view>
+#include <boost/asio/buffer.hpp>
+#include <shared_buffer.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // the pending messages of a subscriber, push returns true if no write is in progress and the caller should start one,
+    // gather moves up to max_batch pending messages into a single buffer sequence for one vectored write,
+    // and written releases them, returning true if more messages arrived meanwhile
+    class broadcast_queue
+    {
+    public:
+        explicit broadcast_queue(std::size_t max_batch = 64) : max_batch(max_batch)
+        {
+        }
+
+        bool push(shared_buffer message)
+        {
+            pending.push_back(std::move(message));
+
+            return !writing;
+        }
+
+        const std::vector<net::const_buffer>& gather()
+        {
+            writing = true;
+
+            while (!pending.empty() && inflight.size() != max_batch)
+            {
+                inflight.push_back(std::move(pending.front()));
+                pending.pop_front();
+
+                buffers.push_back(inflight.back().buffer());
+            }
+
+            return buffers;
+        }
+
+        bool written() noexcept
+        {
+            writing = false;
+
+            inflight.clear();
+            buffers.clear();
+
+            return !pending.empty();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return pending.size() + inflight.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return !size();
+        }
+
+    private:
+        std::size_t max_batch;
+        bool writing = false;
+
+        std::deque<shared_buffer> pending;
+        std::vector<shared_buffer> inflight;
+
+        std::vector<net::const_buffer> buffers;
+    };
+
+    // fans a message out to every subscriber without copying it, each subscriber receives a handle to the same buffer,
+    // a Subscriber is a pointer like type to an object with deliver(const shared_buffer&), the latest messages
+    // up to history are kept and replayed to new subscribers
+    template <typename Subscriber>
+    class broadcast_channel
+    {
+    public:
+        explicit broadcast_channel(std::size_t history = 0) : history(history)
+        {
+        }
+
+        void subscribe(const Subscriber& subscriber)
+        {
+            subscribers.insert(subscriber);
+
+            for (auto& message : recent)
+                 subscriber->deliver(message);
+        }
+
+        void unsubscribe(const Subscriber& subscriber)
+        {
+            subscribers.erase(subscriber);
+        }
+
+        void publish(const shared_buffer& message)
+        {
+            if (history)
+            {
+                if (recent.size() == history)
+                    recent.pop_front();
+
+                recent.push_back(message);
+            }
+
+            for (auto& subscriber : subscribers)
+                 subscriber->deliver(message);
+        }
+
+        void publish(std::string_view data)
+        {
+            publish(shared_buffer(data));
+        }
+
+        std::size_t size() const noexcept
+        {
+            return subscribers.size();
+        }
+
+    private:
+        std::size_t history;
+        std::deque<shared_buffer> recent;
+
+        std::set<Subscriber> subscribers;
+    };
+}
+
+#endif
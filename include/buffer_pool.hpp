@@ -0,0 +1,130 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef BUFFER_POOL_HPP
+#define BUFFER_POOL_HPP
+
+#include <memory>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <placement.hpp>
+
+namespace snp
+{
+    // keeps the released buffers of each thread for reuse, so that the readers created per connection don't hit the allocator.
+    // a thread pinned by placement::pin takes its buffers from the node_allocator of its numa node, and reuses only buffers of that node
+    struct buffer_pool
+    {
+        struct deleter
+        {
+            void operator()(char* p) const noexcept
+            {
+                if (node < 0)
+                    delete[] p;
+                else
+                    asio::node_allocator<char>(node).deallocate(p, size);
+            }
+
+            int node = -1;
+            std::size_t size = 0;
+        };
+
+        using pointer = std::unique_ptr<char[], deleter>;
+
+        static constexpr std::size_t max_cached = 64;
+
+        static auto& cache()
+        {
+            thread_local std::vector<std::pair<std::size_t, pointer>> buffers;
+
+            return buffers;
+        }
+
+        static pointer acquire(std::size_t size)
+        {
+            auto& buffers = cache();
+            auto node = asio::current_node();
+
+            for (auto it = buffers.rbegin(); it != buffers.rend(); ++it)
+            {
+                 if (it->first == size && it->second.get_deleter().node == node)
+                 {
+                     auto p = std::move(it->second);
+                     buffers.erase(std::next(it).base());
+
+                     return p;
+                 }
+            }
+
+            if (node < 0)
+                return pointer(new char[size], {node, size});
+
+            return pointer(asio::node_allocator<char>(node).allocate(size), {node, size});
+        }
+
+        static void release(pointer p, std::size_t size)
+        {
+            auto& buffers = cache();
+
+            if (p && buffers.size() < max_cached)
+                buffers.emplace_back(size, std::move(p));
+        }
+    };
+
+    struct pooled_buffer
+    {
+        explicit pooled_buffer(std::size_t size) : p(buffer_pool::acquire(size)), n(size)
+        {
+        }
+
+        pooled_buffer(pooled_buffer&& other) noexcept : p(std::move(other.p)), n(std::exchange(other.n, 0))
+        {
+        }
+
+        pooled_buffer& operator=(pooled_buffer&& other) noexcept
+        {
+            buffer_pool::release(std::move(p), n);
+
+            p = std::move(other.p);
+            n = std::exchange(other.n, 0);
+
+            return *this;
+        }
+
+        ~pooled_buffer()
+        {
+            buffer_pool::release(std::move(p), n);
+        }
+
+        // grows the buffer to size bytes, keeping the first used bytes
+        void grow(std::size_t size, std::size_t used)
+        {
+            pooled_buffer other(size);
+            std::memcpy(other.data(), data(), used);
+
+            *this = std::move(other);
+        }
+
+        char* data() const noexcept
+        {
+            return p.get();
+        }
+
+        std::size_t size() const noexcept
+        {
+            return n;
+        }
+
+        buffer_pool::pointer p;
+        std::size_t n;
+    };
+}
+
+#endif
@@ -0,0 +1,156 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef BUFFERED_STREAM_HPP
+#define BUFFERED_STREAM_HPP
+
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <string_view>
+#include <boost/asio.hpp>
+#include <buffer_pool.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // a stream with a read-ahead buffer in front of the next layer, it is an asio AsyncReadStream and AsyncWriteStream,
+    // so the senders of snp work on it unchanged, and async_read_until scans the buffered bytes in place
+    template <typename Stream>
+    struct buffered_stream
+    {
+        using error_code_t = boost::system::error_code;
+
+        using next_layer_type = std::remove_reference_t<Stream>;
+        using executor_type = typename next_layer_type::executor_type;
+
+        template <typename Arg>
+        explicit buffered_stream(Arg&& arg, std::size_t capacity = 16 * 1024) : next(std::forward<Arg>(arg)), buffer(capacity)
+        {
+        }
+
+        executor_type get_executor() noexcept
+        {
+            return next.get_executor();
+        }
+
+        next_layer_type& next_layer() noexcept
+        {
+            return next;
+        }
+
+        decltype(auto) lowest_layer() noexcept
+        {
+            if constexpr(requires { next.lowest_layer(); })
+                return next.lowest_layer();
+            else
+                return (next);
+        }
+
+        // the bytes that have been read ahead and not consumed yet
+        std::string_view buffered() const noexcept
+        {
+            return {buffer.data() + head, tail - head};
+        }
+
+        void consume(std::size_t n) noexcept
+        {
+            head += std::min(n, tail - head);
+        }
+
+        // moves the unconsumed bytes to the front, grows the buffer up to max_size if it is full,
+        // and returns the free space behind them, which is empty if the buffer can't grow any further
+        net::mutable_buffer prepare(std::size_t max_size)
+        {
+            if (head)
+            {
+                std::memmove(buffer.data(), buffer.data() + head, tail - head);
+
+                tail -= head;
+                head = 0;
+            }
+
+            if (tail == buffer.size() && buffer.size() < max_size)
+                buffer.grow(std::min(2 * buffer.size(), max_size), tail);
+
+            return net::buffer(buffer.data() + tail, buffer.size() - tail);
+        }
+
+        void commit(std::size_t n) noexcept
+        {
+            tail += n;
+        }
+
+        template <typename MutableBufferSequence, typename Token>
+        decltype(auto) async_read_some(const MutableBufferSequence& buffers, Token&& token)
+        {
+            enum { initial, copied, direct, filled };
+
+            return net::async_compose<Token, void(error_code_t, std::size_t)>([this, buffers, state = int(initial), n = std::size_t(0)]
+                   (auto& self, error_code_t ec = {}, std::size_t bytes_transferred = 0) mutable
+            {
+                switch (state)
+                {
+                    case initial:
+                        if (head != tail)
+                        {
+                            n = copy(buffers);
+                            state = copied;
+
+                            return net::post(next.get_executor(), std::move(self));
+                        }
+
+                        // a read at least as large as the buffer gains nothing from the read-ahead
+                        if (net::buffer_size(buffers) >= buffer.size())
+                        {
+                            state = direct;
+
+                            return next.async_read_some(buffers, std::move(self));
+                        }
+
+                        state = filled;
+
+                        return next.async_read_some(prepare(buffer.size()), std::move(self));
+                    case copied:
+                        return self.complete({}, n);
+                    case direct:
+                        return self.complete(ec, bytes_transferred);
+                    default:
+                        commit(bytes_transferred);
+
+                        return self.complete(ec, copy(buffers));
+                }
+            }, token, next);
+        }
+
+        template <typename ConstBufferSequence, typename Token>
+        decltype(auto) async_write_some(const ConstBufferSequence& buffers, Token&& token)
+        {
+            return next.async_write_some(buffers, std::forward<Token>(token));
+        }
+
+        template <typename MutableBufferSequence>
+        std::size_t copy(const MutableBufferSequence& buffers) noexcept
+        {
+            auto n = net::buffer_copy(buffers, net::buffer(buffer.data() + head, tail - head));
+            head += n;
+
+            return n;
+        }
+
+        Stream next;
+        pooled_buffer buffer;
+
+        std::size_t head = 0;
+        std::size_t tail = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,370 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef CHROME_TRACE_HPP
+#define CHROME_TRACE_HPP
+
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <ostream>
+#include <string_view>
+#include <unistd.h>
+#include <boost/asio.hpp>
+#include <tracer.hpp>
+
+#ifndef SNP_TRACE_BUFFER_EVENTS
+#define SNP_TRACE_BUFFER_EVENTS 65536
+#endif
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // records the operations of the senders it traces, the run intervals of the context threads, the idle and wait intervals of run_busy and the timers that fire
+    // into a ring buffer per thread while a capture is on, and writes them in the chrome trace event format, which perfetto opens too.
+    // a sender chain is traced with sender | snp::with_tracer(snp::chrome_trace::instance()), the span of an operation goes
+    // from its submit to the invocation of its receiver, on the thread that invoked it
+    class chrome_trace
+    {
+    public:
+        using error_code_t = boost::system::error_code;
+
+        static constexpr std::size_t capacity = SNP_TRACE_BUFFER_EVENTS;
+
+        static chrome_trace& instance()
+        {
+            static chrome_trace t;
+
+            return t;
+        }
+
+        // the events recorded before a capture starts are left out of it
+        void start() noexcept
+        {
+            since.store(now(), std::memory_order_relaxed);
+            on.store(true, std::memory_order_release);
+        }
+
+        void stop() noexcept
+        {
+            on.store(false, std::memory_order_release);
+        }
+
+        bool capturing() const noexcept
+        {
+            return on.load(std::memory_order_relaxed);
+        }
+
+        // the tracer interface, timers are marked when they fire as well
+        void record(const trace_event& e) noexcept
+        {
+            if (!capturing())
+                return;
+
+            push(e.failed ? failed_span : span, e.kind, ns(e.submit), ns(e.invoke), ns(e.complete));
+
+            for (std::string_view timer : {"async_wait", "async_wait_until", "schedule_after", "schedule_at"})
+            {
+                 if (e.kind == timer)
+                     push(instant, e.kind, ns(e.complete), ns(e.complete), ns(e.complete));
+            }
+        }
+
+        // a span of the calling thread, the name must outlive the capture
+        void add_span(std::string_view name, trace_clock::time_point begin, trace_clock::time_point end) noexcept
+        {
+            if (capturing())
+                push(context_span, name, ns(begin), ns(end), ns(end));
+        }
+
+        // a context thread runs from its construction to its destruction, the thread gets a buffer once it records an event
+        // or starts to run during a capture, until then it takes no lock, a thread that records nothing is left out of the captures
+        struct scoped_run
+        {
+            scoped_run()
+            {
+                auto& t = chrome_trace::instance();
+                auto& s = this_thread();
+
+                s.running = now();
+
+                if (s.b)
+                    s.b->running.store(s.running, std::memory_order_relaxed);
+                else if (t.capturing())
+                    t.local();
+            }
+
+            ~scoped_run()
+            {
+                auto& t = chrome_trace::instance();
+                auto& s = this_thread();
+
+                auto begin = std::exchange(s.running, 0);
+
+                if (s.b)
+                    s.b->running.store(0, std::memory_order_relaxed);
+
+                if (t.capturing())
+                    t.push(context_span, "run", begin, now(), 0);
+            }
+        };
+
+        void write_json(std::ostream& os)
+        {
+            std::lock_guard lock(mutex);
+
+            auto begin = since.load(std::memory_order_relaxed);
+            auto end = now();
+
+            auto pid = ::getpid();
+            bool first = true;
+
+            auto us = [&](int64_t t){ return (std::max(t, begin) - begin) / 1e3; };
+
+            auto event = [&](std::string_view name, std::string_view cat, char phase, int tid)
+            {
+                os << (std::exchange(first, false) ? "\n" : ",\n") << "{\"name\": \"" << name << "\", \"cat\": \"" << cat << "\", \"ph\": \"" << phase;
+                os << "\", \"pid\": " << pid << ", \"tid\": " << tid;
+            };
+
+            os << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [" << std::fixed << std::setprecision(3);
+
+            for (auto& b : buffers)
+            {
+                 event("thread_name", "__metadata", 'M', b->tid);
+                 os << ", \"args\": {\"name\": \"snp thread " << b->tid << "\"}}";
+
+                 auto head = b->head.load(std::memory_order_acquire);
+                 auto events = b->events.get();
+
+                 for (auto i = head > capacity ? head - capacity : 0; events && i != head; ++i)
+                 {
+                      auto& r = events[i % capacity];
+                      auto seq = r.seq.load(std::memory_order_acquire);
+
+                      if (seq != i + 1)
+                          continue;
+
+                      std::string_view name(r.name.load(std::memory_order_relaxed), r.size.load(std::memory_order_relaxed));
+
+                      auto kind = r.kind.load(std::memory_order_relaxed);
+                      auto b0 = r.begin.load(std::memory_order_relaxed);
+
+                      auto e0 = r.end.load(std::memory_order_relaxed);
+                      auto c0 = r.complete.load(std::memory_order_relaxed);
+
+                      // the record was overwritten while it was read
+                      std::atomic_thread_fence(std::memory_order_acquire);
+
+                      if (r.seq.load(std::memory_order_relaxed) != seq || e0 < begin)
+                          continue;
+
+                      if (kind == instant)
+                      {
+                          event(name, "timer", 'i', b->tid);
+                          os << ", \"s\": \"t\", \"ts\": " << us(b0) << "}";
+
+                          continue;
+                      }
+
+                      event(name, kind == context_span ? "context" : "sender", 'X', b->tid);
+                      os << ", \"ts\": " << us(b0) << ", \"dur\": " << us(e0) - us(b0);
+
+                      if (kind != context_span)
+                          os << ", \"args\": {\"in_flight_us\": " << us(c0) - us(b0) << ", \"failed\": " << (kind == failed_span ? "true" : "false") << "}";
+
+                      os << "}";
+                 }
+
+                 // the threads still running have no run span yet
+                 if (auto running = b->running.load(std::memory_order_relaxed))
+                 {
+                     event("run", "context", 'X', b->tid);
+                     os << ", \"ts\": " << us(running) << ", \"dur\": " << us(end) - us(running) << "}";
+                 }
+            }
+
+            os << "\n]}" << std::endl;
+        }
+
+        bool write_file(const std::string& path)
+        {
+            std::ofstream os(path);
+            write_json(os);
+
+            return static_cast<bool>(os);
+        }
+
+        // the first signal starts a capture, the next one stops it and writes it to path, and so on.
+        // the wait for the signal keeps the context running until cancel_signal
+        void capture_on_signal(net::io_context& ioc, int signal, std::string path)
+        {
+            std::lock_guard lock(mutex);
+
+            signals = std::make_unique<net::signal_set>(ioc, signal);
+            signal_path = std::move(path);
+
+            wait_signal();
+        }
+
+        void cancel_signal()
+        {
+            std::lock_guard lock(mutex);
+
+            if (signals)
+                signals->cancel();
+        }
+
+    private:
+        enum kind_t : uint32_t
+        {
+            span,
+            failed_span,
+            context_span,
+            instant
+        };
+
+        struct record_t
+        {
+            std::atomic<uint64_t> seq = 0;
+
+            std::atomic<const char*> name = nullptr;
+            std::atomic<std::size_t> size = 0;
+
+            std::atomic<uint32_t> kind = span;
+
+            std::atomic<int64_t> begin = 0;
+            std::atomic<int64_t> end = 0;
+            std::atomic<int64_t> complete = 0;
+        };
+
+        // only its thread writes a buffer, a record is stamped with its position once it's written,
+        // the reader drops the records whose stamp changed while they were read
+        struct buffer
+        {
+            explicit buffer(int tid) : tid(tid)
+            {
+            }
+
+            std::unique_ptr<record_t[]> events;
+            std::atomic<uint64_t> head = 0;
+
+            // when the thread started to run a context, 0 if it doesn't
+            std::atomic<int64_t> running = 0;
+
+            int tid;
+        };
+
+        static int64_t ns(trace_clock::time_point t) noexcept
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+        }
+
+        static int64_t now() noexcept
+        {
+            return ns(trace_clock::now());
+        }
+
+        struct thread_state
+        {
+            buffer* b = nullptr;
+
+            // when the thread started to run a context, kept here until it has a buffer
+            int64_t running = 0;
+        };
+
+        static thread_state& this_thread() noexcept
+        {
+            thread_local thread_state s;
+
+            return s;
+        }
+
+        // the buffers live as long as the process, a thread that exits leaves its events behind
+        buffer& local()
+        {
+            auto& s = this_thread();
+
+            if (!s.b)
+            {
+                std::lock_guard lock(mutex);
+
+                s.b = buffers.emplace_back(std::make_unique<buffer>(buffers.size() + 1)).get();
+                s.b->running.store(s.running, std::memory_order_relaxed);
+            }
+
+            return *s.b;
+        }
+
+        void push(kind_t kind, std::string_view name, int64_t begin, int64_t end, int64_t complete) noexcept
+        {
+            auto& b = local();
+
+            if (!b.events)
+            {
+                std::lock_guard lock(mutex);
+                b.events = std::make_unique<record_t[]>(capacity);
+            }
+
+            auto h = b.head.load(std::memory_order_relaxed);
+            auto& r = b.events[h % capacity];
+
+            r.seq.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+
+            r.name.store(name.data(), std::memory_order_relaxed);
+            r.size.store(name.size(), std::memory_order_relaxed);
+
+            r.kind.store(kind, std::memory_order_relaxed);
+
+            r.begin.store(begin, std::memory_order_relaxed);
+            r.end.store(end, std::memory_order_relaxed);
+            r.complete.store(complete, std::memory_order_relaxed);
+
+            r.seq.store(h + 1, std::memory_order_release);
+            b.head.store(h + 1, std::memory_order_release);
+        }
+
+        void wait_signal()
+        {
+            signals->async_wait([this](error_code_t ec, int)
+            {
+                if (ec)
+                    return;
+
+                if (capturing())
+                {
+                    stop();
+                    write_file(signal_path);
+                }
+                else
+                    start();
+
+                wait_signal();
+            });
+        }
+
+        std::atomic<bool> on = false;
+        std::atomic<int64_t> since = 0;
+
+        std::mutex mutex;
+        std::vector<std::unique_ptr<buffer>> buffers;
+
+        std::unique_ptr<net::signal_set> signals;
+        std::string signal_path;
+    };
+}
+
+#endif
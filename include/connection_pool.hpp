@@ -0,0 +1,639 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef CONNECTION_POOL_HPP
+#define CONNECTION_POOL_HPP
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <utility>
+#include <optional>
+#include <algorithm>
+#include <sys/socket.h>
+#include <boost/asio.hpp>
+#include <unifex/get_stop_token.hpp>
+#include <unifex/manual_lifetime.hpp>
+#include <unifex/sender_concepts.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <unifex/inplace_stop_token.hpp>
+#include <tracer.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    struct pool_options
+    {
+        using duration = std::chrono::steady_clock::duration;
+
+        std::size_t min_idle = 0;
+        std::size_t max_idle = 8;
+
+        duration idle_timeout = std::chrono::seconds(60);
+        std::size_t max_per_endpoint = 64;
+
+        bool probe = true;
+    };
+
+    struct pool_stats
+    {
+        uint64_t checkouts;
+
+        uint64_t hits;
+        uint64_t misses;
+
+        uint64_t waits;
+        uint64_t wait_ns;
+
+        uint64_t probe_failures;
+        uint64_t expired;
+
+        double hit_rate() const noexcept
+        {
+            return checkouts ? double(hits) / checkouts : 0;
+        }
+    };
+
+    // returns false if the peer has closed the connection or the socket is in error,
+    // it never blocks and never consumes any data
+    template <typename Stream>
+    bool alive(Stream& stream) noexcept
+    {
+        int fd;
+
+        if constexpr(requires { stream.lowest_layer().native_handle(); })
+            fd = stream.lowest_layer().native_handle();
+        else
+            fd = stream.native_handle();
+
+        char c;
+        auto n = ::recv(fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+        return n > 0 || (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+    }
+
+    template <typename Stream, typename Endpoint = net::ip::tcp::endpoint>
+    struct connection_pool
+    {
+        using clock = std::chrono::steady_clock;
+        using duration = clock::duration;
+
+        using endpoint_t = Endpoint;
+
+        struct waiter
+        {
+            // called with a connection handed over by a released lease, or without one when a slot became free
+            virtual void grant(std::optional<Stream> stream) = 0;
+
+            clock::time_point since;
+        };
+
+        struct idle_t
+        {
+            Stream stream;
+            clock::time_point since;
+        };
+
+        struct bucket
+        {
+            std::size_t busy = 0;
+            std::size_t filling = 0;
+
+            std::deque<idle_t> idle;
+            std::deque<waiter*> waiters;
+        };
+
+        struct lease
+        {
+            lease(connection_pool* pool, const endpoint_t& endpoint, Stream&& stream) : pool(pool), endpoint(endpoint), stream(std::move(stream))
+            {
+            }
+
+            lease(lease&& other) noexcept : pool(std::exchange(other.pool, nullptr)), endpoint(other.endpoint), stream(std::move(other.stream))
+            {
+            }
+
+            lease& operator=(lease&& other) noexcept
+            {
+                if (this != &other)
+                {
+                    if (pool)
+                        pool->discard(endpoint);
+
+                    pool = std::exchange(other.pool, nullptr);
+                    endpoint = other.endpoint;
+
+                    stream = std::move(other.stream);
+                }
+
+                return *this;
+            }
+
+            ~lease()
+            {
+                if (pool)
+                    pool->discard(endpoint);
+            }
+
+            Stream& operator*() noexcept
+            {
+                return *stream;
+            }
+
+            Stream* operator->() noexcept
+            {
+                return &*stream;
+            }
+
+            // returns the connection to the pool for reuse, a lease that is destroyed without release closes its connection
+            void release()
+            {
+                if (auto p = std::exchange(pool, nullptr))
+                    p->recycle(endpoint, std::move(*stream));
+            }
+
+            connection_pool* pool;
+            endpoint_t endpoint;
+
+            std::optional<Stream> stream;
+        };
+
+        enum class outcome
+        {
+            hit,
+            slot,
+            queued
+        };
+
+        connection_pool(net::io_context& ioc, pool_options options = {}) : ex(ioc.get_executor()), options(options)
+        {
+        }
+
+        // the connections to open for min_idle of them to be idle, counting those being opened, the connections being opened
+        // count against max_per_endpoint as the busy ones do
+        std::size_t deficit(const bucket& b) const noexcept
+        {
+            auto have = b.idle.size() + b.filling;
+            auto open = b.busy + b.filling;
+
+            if (have >= options.min_idle || open >= options.max_per_endpoint)
+                return 0;
+
+            return std::min(options.min_idle - have, options.max_per_endpoint - open);
+        }
+
+        // fills is set to the connections the caller has to open with fill, so that min_idle of them stay idle after this checkout,
+        // without an idle connection the checkout waits for one being opened rather than opening one more
+        outcome acquire(const endpoint_t& endpoint, waiter* w, std::optional<Stream>& stream, std::size_t& fills)
+        {
+            checkouts.fetch_add(1, std::memory_order_relaxed);
+
+            std::lock_guard lock(m);
+
+            auto& b = buckets[endpoint];
+            auto now = clock::now();
+
+            reap(b, now);
+
+            while (!b.idle.empty())
+            {
+                auto idle = std::move(b.idle.back());
+                b.idle.pop_back();
+
+                if (options.probe && !alive(idle.stream))
+                {
+                    probe_failures.fetch_add(1, std::memory_order_relaxed);
+
+                    continue;
+                }
+
+                ++b.busy;
+                stream.emplace(std::move(idle.stream));
+
+                fills = deficit(b);
+                b.filling += fills;
+
+                hits.fetch_add(1, std::memory_order_relaxed);
+
+                return outcome::hit;
+            }
+
+            fills = deficit(b);
+            b.filling += fills;
+
+            if (b.filling <= b.waiters.size() && b.busy + b.filling < options.max_per_endpoint)
+            {
+                ++b.busy;
+                misses.fetch_add(1, std::memory_order_relaxed);
+
+                return outcome::slot;
+            }
+
+            w->since = now;
+            b.waiters.push_back(w);
+
+            waits.fetch_add(1, std::memory_order_relaxed);
+
+            return outcome::queued;
+        }
+
+        bool dequeue(const endpoint_t& endpoint, waiter* w)
+        {
+            std::lock_guard lock(m);
+
+            auto& waiters = buckets[endpoint].waiters;
+            auto pos = std::find(waiters.begin(), waiters.end(), w);
+
+            if (pos == waiters.end())
+                return false;
+
+            waiters.erase(pos);
+
+            return true;
+        }
+
+        void recycle(const endpoint_t& endpoint, Stream&& stream)
+        {
+            waiter* w = nullptr;
+
+            {
+                std::lock_guard lock(m);
+
+                auto& b = buckets[endpoint];
+
+                if (b.waiters.empty())
+                {
+                    --b.busy;
+
+                    if (b.idle.size() < options.max_idle)
+                        b.idle.push_back({std::move(stream), clock::now()});
+
+                    return;
+                }
+
+                w = b.waiters.front();
+                b.waiters.pop_front();
+            }
+
+            hits.fetch_add(1, std::memory_order_relaxed);
+            grant(w, std::move(stream));
+        }
+
+        void discard(const endpoint_t& endpoint)
+        {
+            waiter* w = nullptr;
+
+            {
+                std::lock_guard lock(m);
+
+                auto& b = buckets[endpoint];
+
+                if (b.waiters.empty())
+                {
+                    --b.busy;
+
+                    return;
+                }
+
+                w = b.waiters.front();
+                b.waiters.pop_front();
+            }
+
+            misses.fetch_add(1, std::memory_order_relaxed);
+            grant(w, std::nullopt);
+        }
+
+        // a connection opened to keep min_idle of them ready, it goes to a waiter first, a waiter that no other
+        // connection being opened is left for opens its own in place of one that failed
+        void filled(const endpoint_t& endpoint, std::optional<Stream> stream)
+        {
+            waiter* w = nullptr;
+
+            {
+                std::lock_guard lock(m);
+
+                auto& b = buckets[endpoint];
+                --b.filling;
+
+                if (stream ? b.waiters.empty() : b.waiters.size() <= b.filling || b.busy + b.filling >= options.max_per_endpoint)
+                {
+                    if (stream && b.idle.size() < options.max_idle)
+                        b.idle.push_back({std::move(*stream), clock::now()});
+
+                    return;
+                }
+
+                ++b.busy;
+
+                w = b.waiters.front();
+                b.waiters.pop_front();
+            }
+
+            misses.fetch_add(1, std::memory_order_relaxed);
+            grant(w, std::move(stream));
+        }
+
+        void grant(waiter* w, std::optional<Stream> stream)
+        {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(clock::now() - w->since).count();
+            wait_ns.fetch_add(ns, std::memory_order_relaxed);
+
+            w->grant(std::move(stream));
+        }
+
+        void reap(bucket& b, clock::time_point now)
+        {
+            while (b.idle.size() > options.min_idle && b.idle.front().since + options.idle_timeout <= now)
+            {
+                b.idle.pop_front();
+                expired.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // opens a connection of its own, it returns the connection to the pool once it is established, the pool must outlive it
+        template <typename Connect>
+        struct fill_operation
+        {
+            using sender_t = std::invoke_result_t<Connect&, const endpoint_t&>;
+
+            struct receiver
+            {
+                void set_value(Stream stream) noexcept
+                {
+                    op->pool.filled(op->endpoint, std::move(stream));
+                    delete op;
+                }
+
+                template <typename Error>
+                void set_error(Error&&) noexcept
+                {
+                    set_done();
+                }
+
+                void set_done() noexcept
+                {
+                    op->pool.filled(op->endpoint, std::nullopt);
+                    delete op;
+                }
+
+                fill_operation* op;
+            };
+
+            fill_operation(connection_pool& pool, const endpoint_t& endpoint, Connect& factory) :
+            pool(pool), endpoint(endpoint), child(unifex::connect(factory(endpoint), receiver{this}))
+            {
+            }
+
+            connection_pool& pool;
+            endpoint_t endpoint;
+
+            unifex::connect_result_t<sender_t, receiver> child;
+        };
+
+        // opens the n connections acquire counted as being opened, the first checkout of an endpoint warms it up this way,
+        // factory is a copy, a connection that completes inline may complete the checkout that called fill
+        template <typename Connect>
+        void fill(const endpoint_t& endpoint, Connect factory, std::size_t n)
+        {
+            while (n--)
+                unifex::start((new fill_operation<Connect>(*this, endpoint, factory))->child);
+        }
+
+        // closes the idle connections that outlived the idle timeout, checkout does this for its own endpoint
+        void reap()
+        {
+            std::lock_guard lock(m);
+
+            for (auto& [endpoint, b] : buckets)
+                 reap(b, clock::now());
+        }
+
+        std::size_t idle(const endpoint_t& endpoint)
+        {
+            std::lock_guard lock(m);
+
+            return buckets[endpoint].idle.size();
+        }
+
+        void clear()
+        {
+            std::lock_guard lock(m);
+
+            for (auto& [endpoint, b] : buckets)
+                 b.idle.clear();
+        }
+
+        pool_stats stats() const noexcept
+        {
+            return {checkouts.load(), hits.load(), misses.load(), waits.load(), wait_ns.load(), probe_failures.load(), expired.load()};
+        }
+
+        template <typename Connect>
+        struct checkout_sender
+        {
+            using sender_t = std::invoke_result_t<Connect&, const endpoint_t&>;
+
+            template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+            using value_types = Variant<Tuple<lease>>;
+
+            template <template <typename ...> typename Variant>
+            using error_types = unifex::sender_error_types_t<sender_t, Variant>;
+
+            static constexpr bool sends_done = true;
+
+            template <typename Receiver>
+            struct operation : waiter
+            {
+                struct child_receiver
+                {
+                    void set_value(Stream stream) noexcept
+                    {
+                        op->deliver(std::move(stream));
+                    }
+
+                    template <typename Error>
+                    void set_error(Error&& error) noexcept
+                    {
+                        op->pool.discard(op->endpoint);
+                        op->callback.reset();
+
+                        unifex::set_error(std::move(op->receiver), std::forward<Error>(error));
+                    }
+
+                    void set_done() noexcept
+                    {
+                        op->pool.discard(op->endpoint);
+                        op->callback.reset();
+
+                        unifex::set_done(std::move(op->receiver));
+                    }
+
+                    friend unifex::inplace_stop_token tag_invoke(unifex::tag_t<unifex::get_stop_token>, const child_receiver& r) noexcept
+                    {
+                        return r.op->source.get_token();
+                    }
+
+                    friend tracer_of_t<Receiver> tag_invoke(unifex::tag_t<get_tracer>, const child_receiver& r) noexcept
+                    {
+                        return get_tracer(r.op->receiver);
+                    }
+
+                    operation* op;
+                };
+
+                struct on_stop
+                {
+                    // a queued operation is only dequeued, a connecting one may complete inside request_stop and must not be touched after it
+                    void operator()() noexcept
+                    {
+                        if (op->pool.dequeue(op->endpoint, op))
+                            return net::post(op->pool.ex, [op = op]
+                            {
+                                op->callback.reset();
+                                unifex::set_done(std::move(op->receiver));
+                            });
+
+                        op->source.request_stop();
+                    }
+
+                    operation* op;
+                };
+
+                using child_op_t = unifex::connect_result_t<sender_t, child_receiver>;
+
+                using stop_token_t = unifex::stop_token_type_t<Receiver>;
+                using callback_t = typename stop_token_t::template callback_type<on_stop>;
+
+                operation(Receiver receiver, connection_pool& pool, const endpoint_t& endpoint, const Connect& factory) :
+                receiver(std::move(receiver)), pool(pool), endpoint(endpoint), factory(factory)
+                {
+                }
+
+                operation(operation&&) = delete;
+
+                ~operation()
+                {
+                    if (connecting)
+                        child.destruct();
+                }
+
+                constexpr decltype(auto) start() noexcept
+                {
+                    auto token = unifex::get_stop_token(receiver);
+
+                    if (token.stop_requested())
+                        return unifex::set_done(std::move(receiver));
+
+                    std::optional<Stream> stream;
+                    callback.emplace(token, on_stop{this});
+
+                    // a queued operation may be stopped or granted a connection by the fill, and is not touched after it
+                    auto& target = pool;
+                    auto at = endpoint;
+                    auto connect = factory;
+
+                    std::size_t fills = 0;
+                    auto result = target.acquire(at, this, stream, fills);
+
+                    if (result == outcome::queued && token.stop_requested())
+                        on_stop{this}();
+
+                    target.fill(at, std::move(connect), fills);
+
+                    switch (result)
+                    {
+                        case outcome::hit:
+                            return deliver(std::move(*stream));
+                        case outcome::slot:
+                            return open();
+                        case outcome::queued:
+                            return;
+                    }
+                }
+
+                void grant(std::optional<Stream> stream) override
+                {
+                    if (stream)
+                        deliver(std::move(*stream));
+                    else
+                        open();
+                }
+
+                void open()
+                {
+                    child.construct_with([&]
+                    {
+                        return unifex::connect(factory(endpoint), child_receiver{this});
+                    });
+
+                    connecting = true;
+                    unifex::start(child.get());
+                }
+
+                void deliver(Stream&& stream)
+                {
+                    callback.reset();
+                    unifex::set_value(std::move(receiver), lease(&pool, endpoint, std::move(stream)));
+                }
+
+                Receiver receiver;
+                connection_pool& pool;
+
+                endpoint_t endpoint;
+                Connect factory;
+
+                bool connecting = false;
+                unifex::inplace_stop_source source;
+
+                unifex::manual_lifetime<child_op_t> child;
+                std::optional<callback_t> callback;
+            };
+
+            template <typename Receiver>
+            constexpr decltype(auto) connect(Receiver&& receiver)
+            {
+                return operation<std::remove_cvref_t<Receiver>>(std::forward<Receiver>(receiver), pool, endpoint, factory);
+            }
+
+            connection_pool& pool;
+            endpoint_t endpoint;
+
+            Connect factory;
+        };
+
+        // connect is called with the endpoint whenever a new connection is needed, and returns a sender of Stream
+        template <typename Connect>
+        constexpr decltype(auto) checkout(const endpoint_t& endpoint, Connect&& connect)
+        {
+            return checkout_sender<std::decay_t<Connect>>{*this, endpoint, std::forward<Connect>(connect)};
+        }
+
+        net::any_io_executor ex;
+        pool_options options;
+
+        std::mutex m;
+        std::map<endpoint_t, bucket> buckets;
+
+        std::atomic<uint64_t> checkouts = 0;
+
+        std::atomic<uint64_t> hits = 0;
+        std::atomic<uint64_t> misses = 0;
+
+        std::atomic<uint64_t> waits = 0;
+        std::atomic<uint64_t> wait_ns = 0;
+
+        std::atomic<uint64_t> probe_failures = 0;
+        std::atomic<uint64_t> expired = 0;
+    };
+}
+
+#endif
@@ -0,0 +1,345 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef DATAGRAM_BATCH_HPP
+#define DATAGRAM_BATCH_HPP
+
+#include <span>
+#include <vector>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <boost/asio.hpp>
+#include <buffer_pool.hpp>
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // the view points into the buffer of the reader, it stays valid until the next receive
+    struct datagram
+    {
+        std::string_view data;
+        net::ip::udp::endpoint endpoint;
+    };
+
+    // receives up to count datagrams with a single recvmmsg into a pooled buffer, a slot of size bytes per datagram,
+    // longer datagrams are truncated. with gro the kernel coalesces the datagrams of a flow into one message of up to 64KB,
+    // whose segments are split into datagrams again, if the kernel doesn't support it the datagrams come one by one
+    struct datagram_reader
+    {
+        using udp = net::ip::udp;
+        using error_code_t = boost::system::error_code;
+
+        static constexpr std::size_t gro_size = 65536;
+
+        explicit datagram_reader(std::size_t count = 64, std::size_t size = 2048, bool gro = false) :
+        count(count), size(gro ? gro_size : size), gro(gro), buffer(count * this->size), headers(count), iovecs(count), endpoints(count),
+        controls(gro ? count * CMSG_SPACE(sizeof(int)) : 0)
+        {
+            for (std::size_t i = 0; i != count; ++i)
+                 iovecs[i] = {buffer.data() + i * this->size, this->size};
+        }
+
+        // receives without blocking, net::error::would_block is set if nothing is queued
+        std::size_t receive(int fd, error_code_t& ec)
+        {
+            datagrams.clear();
+
+            if (gro && fd != gro_fd)
+            {
+                int on = 1;
+
+                gro = !setsockopt(fd, SOL_UDP, UDP_GRO, &on, sizeof(on));
+                gro_fd = fd;
+            }
+
+            for (std::size_t i = 0; i != count; ++i)
+            {
+                 auto& h = headers[i].msg_hdr;
+
+                 h.msg_name = endpoints[i].data();
+                 h.msg_namelen = endpoints[i].capacity();
+
+                 h.msg_iov = &iovecs[i];
+                 h.msg_iovlen = 1;
+
+                 h.msg_control = gro ? controls.data() + i * CMSG_SPACE(sizeof(int)) : nullptr;
+                 h.msg_controllen = gro ? CMSG_SPACE(sizeof(int)) : 0;
+
+                 h.msg_flags = 0;
+            }
+
+            auto n = recvmmsg(fd, headers.data(), count, MSG_DONTWAIT, nullptr);
+
+            if (n < 0)
+            {
+                ec = error_code_t(errno, boost::system::system_category());
+
+                return 0;
+            }
+
+            for (int i = 0; i != n; ++i)
+            {
+                 auto& h = headers[i];
+                 auto data = buffer.data() + i * size;
+
+                 endpoints[i].resize(h.msg_hdr.msg_namelen);
+                 std::size_t length = std::min<std::size_t>(h.msg_len, size);
+
+                 auto segment = length;
+
+                 for (auto c = CMSG_FIRSTHDR(&h.msg_hdr); c; c = CMSG_NXTHDR(&h.msg_hdr, c))
+                 {
+                      if (c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO)
+                      {
+                          int value;
+                          std::memcpy(&value, CMSG_DATA(c), sizeof(value));
+
+                          segment = value;
+                      }
+                 }
+
+                 if (!length || !segment)
+                     datagrams.push_back({std::string_view(data, length), endpoints[i]});
+                 else
+                 {
+                     for (std::size_t offset = 0; offset < length; offset += segment)
+                          datagrams.push_back({std::string_view(data + offset, std::min(segment, length - offset)), endpoints[i]});
+                 }
+            }
+
+            return datagrams.size();
+        }
+
+        std::span<const datagram> batch() const noexcept
+        {
+            return datagrams;
+        }
+
+        std::size_t count;
+        std::size_t size;
+
+        bool gro;
+        int gro_fd = -1;
+
+        pooled_buffer buffer;
+
+        std::vector<mmsghdr> headers;
+        std::vector<iovec> iovecs;
+
+        std::vector<udp::endpoint> endpoints;
+        std::vector<char> controls;
+
+        std::vector<datagram> datagrams;
+    };
+
+    // queues datagrams in a pooled buffer and sends them with as few sendmmsg calls as possible, with gso consecutive
+    // datagrams of the same size to the same endpoint are sent as one message that the kernel or the nic segments,
+    // if the route can't segment them, they're sent one by one from then on
+    struct datagram_writer
+    {
+        using udp = net::ip::udp;
+        using error_code_t = boost::system::error_code;
+
+        static constexpr std::size_t max_segments = 64;
+        static constexpr std::size_t max_gso_size = 65507;
+
+        static constexpr std::size_t max_batch = 1024;
+
+        struct message
+        {
+            udp::endpoint endpoint;
+
+            std::size_t offset;
+            std::size_t size;
+
+            std::size_t segment;
+            std::size_t count;
+        };
+
+        explicit datagram_writer(std::size_t capacity = 64 * 1024, bool gso = false) : buffer(capacity), gso(gso)
+        {
+        }
+
+        // only the last segment of a message may be shorter than the others
+        void add(const udp::endpoint& endpoint, net::const_buffer b)
+        {
+            auto n = b.size();
+
+            if (used + n > buffer.size())
+                buffer.grow(std::max(used + n, 2 * buffer.size()), used);
+
+            std::memcpy(buffer.data() + used, b.data(), n);
+
+            if (auto m = messages.empty() ? nullptr : &messages.back(); gso && m && n && m->endpoint == endpoint && n <= m->segment &&
+                m->size == m->segment * m->count && m->count < max_segments && m->size + n <= max_gso_size)
+            {
+                m->size += n;
+                ++m->count;
+            }
+            else
+                messages.push_back({endpoint, used, n, n, 1});
+
+            used += n;
+            ++queued;
+        }
+
+        // sends without blocking, net::error::would_block is set if the socket buffer is full, returns the datagrams sent so far
+        std::size_t send(int fd, error_code_t& ec)
+        {
+            constexpr auto space = CMSG_SPACE(sizeof(uint16_t));
+
+            while (next != messages.size())
+            {
+                auto batch = std::min(messages.size() - next, max_batch);
+
+                headers.resize(batch);
+                iovecs.resize(batch);
+
+                controls.resize(batch * space);
+
+                for (std::size_t i = 0; i != batch; ++i)
+                {
+                     auto& m = messages[next + i];
+                     auto& h = headers[i].msg_hdr;
+
+                     iovecs[i] = {buffer.data() + m.offset, m.size};
+
+                     h.msg_name = const_cast<sockaddr*>(m.endpoint.data());
+                     h.msg_namelen = m.endpoint.size();
+
+                     h.msg_iov = &iovecs[i];
+                     h.msg_iovlen = 1;
+
+                     h.msg_control = nullptr;
+                     h.msg_controllen = 0;
+
+                     h.msg_flags = 0;
+
+                     if (m.count > 1)
+                     {
+                         h.msg_control = controls.data() + i * space;
+                         h.msg_controllen = space;
+
+                         auto c = CMSG_FIRSTHDR(&h);
+
+                         c->cmsg_level = SOL_UDP;
+                         c->cmsg_type = UDP_SEGMENT;
+                         c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+
+                         uint16_t segment = m.segment;
+                         std::memcpy(CMSG_DATA(c), &segment, sizeof(segment));
+                     }
+                }
+
+                auto n = sendmmsg(fd, headers.data(), batch, MSG_DONTWAIT);
+
+                if (n < 0)
+                {
+                    if (gso && messages[next].count > 1 && (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT))
+                    {
+                        unsegment();
+
+                        continue;
+                    }
+
+                    ec = error_code_t(errno, boost::system::system_category());
+
+                    break;
+                }
+
+                for (int i = 0; i != n; ++i)
+                     sent += messages[next + i].count;
+
+                next += n;
+            }
+
+            return sent;
+        }
+
+        // splits the messages not sent yet into single datagrams, and stops joining them
+        void unsegment()
+        {
+            std::vector<message> single(messages.begin(), messages.begin() + next);
+
+            for (auto it = messages.begin() + next; it != messages.end(); ++it)
+            {
+                 for (std::size_t i = 0; i != it->count; ++i)
+                 {
+                      auto offset = i * it->segment;
+                      single.push_back({it->endpoint, it->offset + offset, std::min(it->segment, it->size - offset), 0, 1});
+                 }
+            }
+
+            for (auto& m : single)
+                 m.segment = m.size;
+
+            messages = std::move(single);
+            gso = false;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return queued;
+        }
+
+        bool empty() const noexcept
+        {
+            return !queued;
+        }
+
+        void clear() noexcept
+        {
+            messages.clear();
+
+            used = 0;
+            queued = 0;
+
+            next = 0;
+            sent = 0;
+        }
+
+        pooled_buffer buffer;
+        bool gso;
+
+        std::size_t used = 0;
+        std::size_t queued = 0;
+
+        std::size_t next = 0;
+        std::size_t sent = 0;
+
+        std::vector<message> messages;
+
+        std::vector<mmsghdr> headers;
+        std::vector<iovec> iovecs;
+
+        std::vector<char> controls;
+    };
+}
+
+#endif
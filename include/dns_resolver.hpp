@@ -0,0 +1,771 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef DNS_RESOLVER_HPP
+#define DNS_RESOLVER_HPP
+
+#include <map>
+#include <array>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <charconv>
+#include <algorithm>
+#include <unordered_map>
+#include <netdb.h>
+#include <boost/asio.hpp>
+#include <async_resolve.hpp>
+
+namespace snp::dns
+{
+    namespace net = boost::asio;
+
+    inline constexpr uint16_t type_a = 1;
+    inline constexpr uint16_t type_aaaa = 28;
+
+    inline constexpr int noerror = 0;
+    inline constexpr int servfail = 2;
+    inline constexpr int nxdomain = 3;
+    inline constexpr int refused = 5;
+
+    struct answer
+    {
+        uint16_t id = 0;
+        int rcode = 0;
+
+        bool truncated = false;
+        uint32_t ttl = UINT32_MAX;
+
+        std::vector<net::ip::address> addresses;
+    };
+
+    inline bool valid(const std::string& name)
+    {
+        if (name.empty() || name.size() > 253)
+            return false;
+
+        std::stringstream ss(name);
+
+        for (std::string label; std::getline(ss, label, '.');)
+             if (label.empty() || label.size() > 63)
+                 return false;
+
+        return name.back() != '.';
+    }
+
+    inline std::vector<uint8_t> encode_query(uint16_t id, const std::string& name, uint16_t type)
+    {
+        std::vector<uint8_t> packet{uint8_t(id >> 8), uint8_t(id), 0x01, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00};
+        std::stringstream ss(name);
+
+        for (std::string label; std::getline(ss, label, '.');)
+        {
+             packet.push_back(label.size());
+             packet.insert(packet.end(), label.begin(), label.end());
+        }
+
+        packet.insert(packet.end(), {0x00, uint8_t(type >> 8), uint8_t(type), 0x00, 0x01});
+
+        return packet;
+    }
+
+    inline bool parse(const uint8_t* data, std::size_t size, uint16_t type, answer& a)
+    {
+        if (size < 12)
+            return false;
+
+        auto u16 = [data](std::size_t i){ return uint16_t(data[i] << 8 | data[i + 1]); };
+        auto u32 = [&](std::size_t i){ return uint32_t(u16(i)) << 16 | u16(i + 2); };
+
+        auto skip = [&](std::size_t& pos)
+        {
+            while (pos < size)
+            {
+                auto len = data[pos];
+
+                if ((len & 0xc0) == 0xc0)
+                    return (pos += 2) <= size;
+
+                pos += len + 1;
+
+                if (!len)
+                    return true;
+            }
+
+            return false;
+        };
+
+        auto flags = u16(2);
+
+        if (!(flags & 0x8000))
+            return false;
+
+        a.id = u16(0);
+        a.rcode = flags & 0x000f;
+
+        a.truncated = flags & 0x0200;
+
+        std::size_t pos = 12;
+        std::size_t questions = u16(4);
+        std::size_t answers = u16(6);
+
+        for (; questions; --questions)
+        {
+             if (!skip(pos) || (pos += 4) > size)
+                 return false;
+        }
+
+        for (; answers; --answers)
+        {
+             if (!skip(pos) || pos + 10 > size)
+                 return false;
+
+             auto rtype = u16(pos);
+             auto rclass = u16(pos + 2);
+
+             auto ttl = u32(pos + 4);
+             std::size_t len = u16(pos + 8);
+
+             if ((pos += 10) + len > size)
+                 return false;
+
+             if (rclass == 1 && rtype == type)
+             {
+                 if (type == type_a && len == 4)
+                 {
+                     net::ip::address_v4::bytes_type bytes;
+                     std::memcpy(bytes.data(), data + pos, len);
+
+                     a.addresses.push_back(net::ip::address_v4(bytes));
+                 }
+                 else if (type == type_aaaa && len == 16)
+                 {
+                     net::ip::address_v6::bytes_type bytes;
+                     std::memcpy(bytes.data(), data + pos, len);
+
+                     a.addresses.push_back(net::ip::address_v6(bytes));
+                 }
+
+                 a.ttl = std::min(a.ttl, ttl);
+             }
+
+             pos += len;
+        }
+
+        return true;
+    }
+}
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    struct dns_config
+    {
+        static dns_config load(const std::string& path = "/etc/resolv.conf")
+        {
+            dns_config config;
+            std::ifstream file(path);
+
+            auto number = [](const std::string& option, std::size_t pos)
+            {
+                int n = 0;
+                std::from_chars(option.data() + pos, option.data() + option.size(), n);
+
+                return n;
+            };
+
+            for (std::string line; std::getline(file, line);)
+            {
+                 std::string key;
+                 std::stringstream ss(line);
+
+                 ss >> key;
+
+                 if (key == "nameserver")
+                 {
+                     std::string host;
+                     ss >> host;
+
+                     boost::system::error_code ec;
+                     auto address = net::ip::make_address(host.substr(0, host.find('%')), ec);
+
+                     if (!ec)
+                         config.nameservers.emplace_back(address, 53);
+                 }
+                 else if (key == "search" || key == "domain")
+                 {
+                     config.search.clear();
+
+                     for (std::string domain; ss >> domain;)
+                          config.search.push_back(domain);
+                 }
+                 else if (key == "options")
+                 {
+                     for (std::string option; ss >> option;)
+                     {
+                          if (option.starts_with("ndots:"))
+                              config.ndots = number(option, 6);
+                          else if (option.starts_with("timeout:"))
+                              config.timeout = std::chrono::seconds(std::max(1, number(option, 8)));
+                          else if (option.starts_with("attempts:"))
+                              config.attempts = std::max(1, number(option, 9));
+                     }
+                 }
+            }
+
+            if (config.nameservers.empty())
+                config.nameservers.emplace_back(net::ip::address_v4::loopback(), 53);
+
+            return config;
+        }
+
+        std::vector<net::ip::udp::endpoint> nameservers;
+        std::vector<std::string> search;
+
+        int ndots = 1;
+        int attempts = 2;
+
+        std::chrono::milliseconds timeout = std::chrono::seconds(5);
+    };
+
+    struct dns_hosts
+    {
+        static std::string lower(std::string name)
+        {
+            std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c){ return std::tolower(c); });
+
+            return name;
+        }
+
+        static dns_hosts load(const std::string& path = "/etc/hosts")
+        {
+            dns_hosts hosts;
+            std::ifstream file(path);
+
+            for (std::string line; std::getline(file, line);)
+            {
+                 std::string host;
+                 std::stringstream ss(line.substr(0, line.find('#')));
+
+                 ss >> host;
+
+                 boost::system::error_code ec;
+                 auto address = net::ip::make_address(host, ec);
+
+                 if (ec)
+                     continue;
+
+                 for (std::string name; ss >> name;)
+                      hosts.entries[lower(name)].push_back(address);
+            }
+
+            return hosts;
+        }
+
+        const std::vector<net::ip::address>* find(const std::string& name) const
+        {
+            auto it = entries.find(lower(name));
+
+            return it == entries.end() ? nullptr : &it->second;
+        }
+
+        std::map<std::string, std::vector<net::ip::address>> entries;
+    };
+
+    struct dns_resolver
+    {
+        using tcp = net::ip::tcp;
+        using udp = net::ip::udp;
+
+        using error_code_t = boost::system::error_code;
+        using results_type = tcp::resolver::results_type;
+
+        using strand_t = net::strand<net::io_context::executor_type>;
+
+        struct request
+        {
+            resolve_waiter* w;
+
+            std::string host;
+            std::string service;
+
+            unsigned short port;
+            std::vector<std::string> names;
+
+            std::size_t index = 0;
+            std::size_t pending = 0;
+
+            error_code_t ec;
+            std::vector<net::ip::address> addresses[2];
+        };
+
+        struct query
+        {
+            explicit query(const strand_t& strand) : timer(strand)
+            {
+            }
+
+            uint16_t id;
+            uint16_t type;
+
+            std::shared_ptr<request> owner;
+            std::vector<uint8_t> packet;
+
+            std::size_t server = 0;
+            std::size_t tries = 0;
+
+            net::steady_timer timer;
+            std::unique_ptr<tcp::socket> stream;
+
+            std::array<uint8_t, 2> length;
+            std::vector<uint8_t> reply;
+        };
+
+        struct channel
+        {
+            explicit channel(const strand_t& strand) : socket(strand)
+            {
+            }
+
+            udp::socket socket;
+            udp::endpoint sender;
+
+            std::array<uint8_t, 4096> buffer;
+
+            bool receiving = false;
+            std::size_t generation = 0;
+        };
+
+        dns_resolver(net::io_context& ioc, dns_config config = dns_config::load(), dns_hosts hosts = dns_hosts::load()) :
+        strand(ioc.get_executor()), config(std::move(config)), hosts(std::move(hosts)), channels{channel(strand), channel(strand)}
+        {
+        }
+
+        strand_t get_executor() const noexcept
+        {
+            return strand;
+        }
+
+        static bool port_of(const std::string& service, unsigned short& port)
+        {
+            auto last = service.data() + service.size();
+
+            if (auto [p, e] = std::from_chars(service.data(), last, port); e == std::errc() && p == last)
+                return true;
+
+            if (service.empty())
+            {
+                port = 0;
+
+                return true;
+            }
+
+            servent entry;
+            servent* result = nullptr;
+
+            char buffer[1024];
+
+            if (getservbyname_r(service.c_str(), "tcp", &entry, buffer, sizeof(buffer), &result) || !result)
+                return false;
+
+            port = ntohs(result->s_port);
+
+            return true;
+        }
+
+        std::vector<std::string> candidates(const std::string& host) const
+        {
+            if (host.ends_with('.'))
+                return {host.substr(0, host.size() - 1)};
+
+            std::vector<std::string> names;
+            bool absolute = std::count(host.begin(), host.end(), '.') >= config.ndots;
+
+            if (absolute)
+                names.push_back(host);
+
+            for (auto& domain : config.search)
+                 names.push_back(host + "." + domain);
+
+            if (!absolute)
+                names.push_back(host);
+
+            std::erase_if(names, [](auto& name){ return !dns::valid(name); });
+
+            return names;
+        }
+
+        static results_type make_results(const std::vector<net::ip::address>& addresses, unsigned short port, const std::string& host, const std::string& service)
+        {
+            std::vector<tcp::endpoint> endpoints;
+
+            for (auto& address : addresses)
+                 endpoints.emplace_back(address, port);
+
+            return results_type::create(endpoints.begin(), endpoints.end(), host, service);
+        }
+
+        bool lookup(const std::string& host, const std::string& service, resolve_waiter* w, error_code_t& ec, results_type& results)
+        {
+            unsigned short port;
+
+            if (!port_of(service, port))
+            {
+                ec = net::error::service_not_found;
+
+                return true;
+            }
+
+            if (auto address = net::ip::make_address(host, ec); !ec)
+            {
+                results = make_results({address}, port, host, service);
+
+                return true;
+            }
+
+            ec.clear();
+
+            if (auto addresses = hosts.find(host))
+            {
+                results = make_results(*addresses, port, host, service);
+
+                return true;
+            }
+
+            auto names = candidates(host);
+
+            if (names.empty())
+            {
+                ec = net::error::host_not_found;
+
+                return true;
+            }
+
+            auto l = std::make_shared<request>(w, host, service, port, std::move(names));
+
+            {
+                std::lock_guard lock(m);
+                waiters[w] = l.get();
+            }
+
+            net::post(strand, [this, l]
+            {
+                if (waiting(l))
+                    resolve(l);
+            });
+
+            return false;
+        }
+
+        bool cancel(const std::string&, const std::string&, resolve_waiter* w)
+        {
+            std::lock_guard lock(m);
+
+            return waiters.erase(w);
+        }
+
+        bool waiting(const std::shared_ptr<request>& l)
+        {
+            std::lock_guard lock(m);
+            auto it = waiters.find(l->w);
+
+            return it != waiters.end() && it->second == l.get();
+        }
+
+        void finish(const std::shared_ptr<request>& l, error_code_t ec, const results_type& results)
+        {
+            {
+                std::lock_guard lock(m);
+                auto it = waiters.find(l->w);
+
+                if (it == waiters.end() || it->second != l.get())
+                    return;
+
+                waiters.erase(it);
+            }
+
+            l->w->complete(ec, results);
+        }
+
+        void resolve(const std::shared_ptr<request>& l)
+        {
+            l->pending = 2;
+
+            send(l, dns::type_aaaa);
+            send(l, dns::type_a);
+        }
+
+        void send(const std::shared_ptr<request>& l, uint16_t type)
+        {
+            auto q = std::make_shared<query>(strand);
+            std::uniform_int_distribution<unsigned short> d;
+
+            do
+                q->id = d(gen);
+            while (queries.contains(q->id));
+
+            q->type = type;
+            q->owner = l;
+
+            q->packet = dns::encode_query(q->id, l->names[l->index], type);
+            queries.emplace(q->id, q);
+
+            transmit(q);
+        }
+
+        const udp::endpoint& nameserver(const std::shared_ptr<query>& q) const
+        {
+            return config.nameservers[q->server % config.nameservers.size()];
+        }
+
+        void transmit(const std::shared_ptr<query>& q)
+        {
+            auto& ns = nameserver(q);
+            auto& c = channels[ns.address().is_v6()];
+
+            if (!c.socket.is_open())
+            {
+                error_code_t ec;
+                c.socket.open(ns.protocol(), ec);
+
+                if (ec)
+                    return done(q, ec, {});
+
+                receive(c);
+            }
+
+            c.socket.async_send_to(net::buffer(q->packet), ns, [q](error_code_t, std::size_t)
+            {
+            });
+
+            arm(q);
+        }
+
+        void arm(const std::shared_ptr<query>& q)
+        {
+            q->timer.expires_after(config.timeout);
+
+            q->timer.async_wait([this, q](error_code_t ec)
+            {
+                if (!ec && active(q))
+                    retry(q, net::error::timed_out);
+            });
+        }
+
+        void retry(const std::shared_ptr<query>& q, error_code_t ec)
+        {
+            q->stream.reset();
+
+            if (++q->tries < config.attempts * config.nameservers.size() && waiting(q->owner))
+            {
+                ++q->server;
+                transmit(q);
+            }
+            else
+                done(q, ec, {});
+        }
+
+        void receive(channel& c)
+        {
+            if (c.receiving || !c.socket.is_open())
+                return;
+
+            c.receiving = true;
+
+            c.socket.async_receive_from(net::buffer(c.buffer), c.sender, [this, &c, generation = c.generation](error_code_t ec, std::size_t n)
+            {
+                if (generation != c.generation)
+                    return;
+
+                c.receiving = false;
+
+                if (ec == net::error::operation_aborted)
+                    return;
+
+                if (!ec)
+                    on_datagram(c.sender, c.buffer.data(), n);
+
+                receive(c);
+            });
+        }
+
+        bool active(const std::shared_ptr<query>& q) const
+        {
+            auto it = queries.find(q->id);
+
+            return it != queries.end() && it->second == q;
+        }
+
+        bool matches(const std::shared_ptr<query>& q, const uint8_t* data, std::size_t n) const
+        {
+            auto size = q->packet.size() - 12;
+
+            return n >= q->packet.size() && data[4] == 0 && data[5] == 1 && !std::memcmp(data + 12, q->packet.data() + 12, size);
+        }
+
+        void on_datagram(const udp::endpoint& sender, const uint8_t* data, std::size_t n)
+        {
+            if (n < 12)
+                return;
+
+            auto it = queries.find(uint16_t(data[0] << 8 | data[1]));
+
+            if (it == queries.end())
+                return;
+
+            auto q = it->second;
+            dns::answer a;
+
+            if (q->stream || sender != nameserver(q) || !matches(q, data, n) || !dns::parse(data, n, q->type, a))
+                return;
+
+            if (a.truncated)
+                via_tcp(q);
+            else
+                on_answer(q, a);
+        }
+
+        void via_tcp(const std::shared_ptr<query>& q)
+        {
+            auto& ns = nameserver(q);
+            uint16_t size = q->packet.size();
+
+            q->length = {uint8_t(size >> 8), uint8_t(size)};
+            q->stream = std::make_unique<tcp::socket>(strand);
+
+            arm(q);
+
+            q->stream->async_connect(tcp::endpoint(ns.address(), ns.port()), [this, q](error_code_t ec)
+            {
+                if (!active(q) || !q->stream)
+                    return;
+
+                if (ec)
+                    return retry(q, net::error::host_not_found_try_again);
+
+                std::array<net::const_buffer, 2> buffers{net::buffer(q->length), net::buffer(q->packet)};
+
+                net::async_write(*q->stream, buffers, [this, q](error_code_t ec, std::size_t)
+                {
+                    if (!active(q) || !q->stream)
+                        return;
+
+                    if (ec)
+                        return retry(q, net::error::host_not_found_try_again);
+
+                    net::async_read(*q->stream, net::buffer(q->length), [this, q](error_code_t ec, std::size_t)
+                    {
+                        if (!active(q) || !q->stream)
+                            return;
+
+                        if (ec)
+                            return retry(q, net::error::host_not_found_try_again);
+
+                        q->reply.resize(q->length[0] << 8 | q->length[1]);
+
+                        net::async_read(*q->stream, net::buffer(q->reply), [this, q](error_code_t ec, std::size_t n)
+                        {
+                            if (!active(q) || !q->stream)
+                                return;
+
+                            dns::answer a;
+
+                            if (ec || !matches(q, q->reply.data(), n) || !dns::parse(q->reply.data(), n, q->type, a) || a.id != q->id)
+                                return retry(q, net::error::host_not_found_try_again);
+
+                            q->stream.reset();
+                            on_answer(q, a);
+                        });
+                    });
+                });
+            });
+        }
+
+        void on_answer(const std::shared_ptr<query>& q, dns::answer& a)
+        {
+            if (a.rcode == dns::noerror)
+                done(q, {}, std::move(a.addresses));
+            else if (a.rcode == dns::nxdomain)
+                done(q, net::error::host_not_found, {});
+            else if (a.rcode == dns::servfail || a.rcode == dns::refused)
+                retry(q, net::error::host_not_found_try_again);
+            else
+                done(q, net::error::no_recovery, {});
+        }
+
+        void done(const std::shared_ptr<query>& q, error_code_t ec, std::vector<net::ip::address> addresses)
+        {
+            q->timer.cancel();
+            q->stream.reset();
+
+            queries.erase(q->id);
+
+            // nothing is left to answer, close the sockets so that an idle resolver doesn't keep the context running
+            if (queries.empty())
+                for (auto& c : channels)
+                {
+                     error_code_t ignored;
+                     c.socket.close(ignored);
+
+                     c.receiving = false;
+                     ++c.generation;
+                }
+
+            auto l = q->owner;
+            auto& all = l->addresses[q->type == dns::type_a];
+
+            all.insert(all.end(), addresses.begin(), addresses.end());
+
+            if (ec && (!l->ec || l->ec == net::error::host_not_found))
+                l->ec = ec;
+
+            if (--l->pending)
+                return;
+
+            if (!l->addresses[0].empty() || !l->addresses[1].empty())
+            {
+                auto& v6 = l->addresses[0];
+                v6.insert(v6.end(), l->addresses[1].begin(), l->addresses[1].end());
+
+                return finish(l, {}, make_results(v6, l->port, l->host, l->service));
+            }
+
+            bool missing = !l->ec || l->ec == net::error::host_not_found;
+
+            if (missing && ++l->index < l->names.size() && waiting(l))
+            {
+                l->ec.clear();
+                return resolve(l);
+            }
+
+            finish(l, missing ? net::error::host_not_found : l->ec, {});
+        }
+
+        std::mutex m;
+        strand_t strand;
+
+        dns_config config;
+        dns_hosts hosts;
+
+        channel channels[2];
+        std::mt19937 gen{std::random_device{}()};
+
+        std::unordered_map<resolve_waiter*, request*> waiters;
+        std::unordered_map<uint16_t, std::shared_ptr<query>> queries;
+    };
+}
+
+#endif
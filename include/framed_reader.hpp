@@ -0,0 +1,232 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef FRAMED_READER_HPP
+#define FRAMED_READER_HPP
+
+#include <span>
+#include <cstdio>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+#include <boost/asio.hpp>
+#include <buffer_pool.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // a codec decodes the header in front of a frame, decode returns the length of the header and stores the length
+    // of the body that follows it, it returns 0 while the header is incomplete, and malformed if it can never be decoded
+
+    inline constexpr std::size_t malformed = std::size_t(-1);
+
+    template <std::size_t N>
+    struct fixed_codec
+    {
+        static_assert(N >= 1 && N <= 8);
+
+        static constexpr std::size_t max_header_length = N;
+
+        std::size_t decode(const char* data, std::size_t size, std::size_t& length) const noexcept
+        {
+            if (size < N)
+                return 0;
+
+            length = 0;
+
+            for (std::size_t i = 0; i != N; ++i)
+                 length = length << 8 | static_cast<uint8_t>(data[i]);
+
+            return N;
+        }
+
+        static std::size_t encode(char* data, std::size_t length) noexcept
+        {
+            for (std::size_t i = N; i--; length >>= 8)
+                 data[i] = static_cast<char>(length);
+
+            return N;
+        }
+
+        std::size_t max_length = 16 << 20;
+    };
+
+    struct varint_codec
+    {
+        static constexpr std::size_t max_header_length = 10;
+
+        std::size_t decode(const char* data, std::size_t size, std::size_t& length) const noexcept
+        {
+            length = 0;
+
+            for (std::size_t i = 0; i != std::min(size, max_header_length); ++i)
+            {
+                 auto byte = static_cast<uint8_t>(data[i]);
+                 length |= static_cast<std::size_t>(byte & 0x7f) << 7 * i;
+
+                 if (!(byte & 0x80))
+                     return i + 1;
+            }
+
+            return size < max_header_length ? 0 : malformed;
+        }
+
+        static std::size_t encode(char* data, std::size_t length) noexcept
+        {
+            std::size_t n = 0;
+
+            for (; length >= 0x80; length >>= 7)
+                 data[n++] = static_cast<char>(length | 0x80);
+
+            data[n++] = static_cast<char>(length);
+
+            return n;
+        }
+
+        std::size_t max_length = 16 << 20;
+    };
+
+    // the decimal length right aligned in N characters, as written by printf("%4d") for N = 4
+    template <std::size_t N>
+    struct ascii_codec
+    {
+        static constexpr std::size_t max_header_length = N;
+
+        std::size_t decode(const char* data, std::size_t size, std::size_t& length) const noexcept
+        {
+            if (size < N)
+                return 0;
+
+            std::size_t i = 0;
+            length = 0;
+
+            while (i != N && data[i] == ' ')
+                ++i;
+
+            if (i == N)
+                return malformed;
+
+            for (; i != N; ++i)
+            {
+                 if (data[i] < '0' || data[i] > '9')
+                     return malformed;
+
+                 length = length * 10 + data[i] - '0';
+            }
+
+            return N;
+        }
+
+        static std::size_t encode(char* data, std::size_t length) noexcept
+        {
+            char header[N + 1];
+            std::snprintf(header, sizeof(header), "%*zu", static_cast<int>(N), length);
+
+            std::memcpy(data, header, N);
+
+            return N;
+        }
+
+        std::size_t max_length = 16 << 20;
+    };
+
+    template <typename Codec>
+    struct framed_reader
+    {
+        using error_code_t = boost::system::error_code;
+
+        explicit framed_reader(std::size_t capacity = 64 * 1024, Codec codec = {}) : codec(codec), buffer(capacity)
+        {
+        }
+
+        // drops the previous batch, and collects every complete frame that is buffered into the next one,
+        // an error is only reported once the frames in front of it have been delivered
+        std::size_t parse(error_code_t& ec)
+        {
+            frames.clear();
+
+            while (true)
+            {
+                std::size_t length = 0;
+                auto n = codec.decode(buffer.data() + head, tail - head, length);
+
+                if (!n)
+                    break;
+
+                if (n == malformed || length > codec.max_length)
+                {
+                    if (frames.empty())
+                        ec = n == malformed ? net::error::invalid_argument : net::error::message_size;
+
+                    break;
+                }
+
+                if (tail - head - n < length)
+                {
+                    need = n + length;
+
+                    break;
+                }
+
+                frames.emplace_back(buffer.data() + head + n, length);
+                head += n + length;
+            }
+
+            return frames.size();
+        }
+
+        // moves the partial frame to the front, and grows the buffer if the frame can't fit
+        net::mutable_buffer prepare()
+        {
+            if (head)
+            {
+                std::memmove(buffer.data(), buffer.data() + head, tail - head);
+
+                tail -= head;
+                head = 0;
+            }
+
+            if (need > buffer.size() || tail == buffer.size())
+                buffer.grow(std::max(need, 2 * buffer.size()), tail);
+
+            need = 0;
+
+            return net::buffer(buffer.data() + tail, buffer.size() - tail);
+        }
+
+        void commit(std::size_t n) noexcept
+        {
+            tail += n;
+        }
+
+        // the views point into the buffer of the reader, they stay valid until the next read
+        std::span<const std::string_view> batch() const noexcept
+        {
+            return frames;
+        }
+
+        std::size_t buffered() const noexcept
+        {
+            return tail - head;
+        }
+
+        Codec codec;
+        pooled_buffer buffer;
+
+        std::size_t head = 0;
+        std::size_t tail = 0;
+
+        std::size_t need = 0;
+        std::vector<std::string_view> frames;
+    };
+}
+
+#endif
@@ -0,0 +1,149 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef HDR_HISTOGRAM_HPP
+#define HDR_HISTOGRAM_HPP
+
+#include <bit>
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace snp
+{
+    // counts values from 0 to highest in buckets of 2^(bits - 1) linear sub buckets each, whose width doubles from one bucket to the next,
+    // so any value is reported within a relative error of 2^-(bits - 1), 3 significant digits for the default 11 bits,
+    // recording is a couple of shifts and an increment, values above highest are counted as highest
+    class hdr_histogram
+    {
+    public:
+        explicit hdr_histogram(uint64_t highest = 60'000'000'000, int bits = 11) : bits(bits), highest(highest), counts(index(highest) + 1)
+        {
+        }
+
+        void record(uint64_t value, uint64_t count = 1) noexcept
+        {
+            min_ = std::min(min_, value);
+            max_ = std::max(max_, value);
+
+            counts[index(std::min(value, highest))] += count;
+
+            total += count;
+            sum += static_cast<double>(value) * count;
+        }
+
+        // both histograms must have been created with the same highest and bits
+        void merge(const hdr_histogram& other) noexcept
+        {
+            for (std::size_t i = 0; i != counts.size(); ++i)
+                 counts[i] += other.counts[i];
+
+            min_ = std::min(min_, other.min_);
+            max_ = std::max(max_, other.max_);
+
+            total += other.total;
+            sum += other.sum;
+        }
+
+        // the highest value equivalent to the one below which p percent of the values fall, the exact maximum for 100
+        uint64_t value_at_percentile(double p) const noexcept
+        {
+            if (!total)
+                return 0;
+
+            if (p >= 100)
+                return max_;
+
+            auto rank = std::max<uint64_t>(1, std::ceil(p / 100 * total));
+            uint64_t seen = 0;
+
+            for (std::size_t i = 0; i != counts.size(); ++i)
+            {
+                 seen += counts[i];
+
+                 if (seen >= rank)
+                     return std::clamp(highest_equivalent(i), min_, max_);
+            }
+
+            return max_;
+        }
+
+        uint64_t count() const noexcept
+        {
+            return total;
+        }
+
+        uint64_t min() const noexcept
+        {
+            return total ? min_ : 0;
+        }
+
+        uint64_t max() const noexcept
+        {
+            return max_;
+        }
+
+        double mean() const noexcept
+        {
+            return total ? sum / total : 0;
+        }
+
+        void reset() noexcept
+        {
+            std::ranges::fill(counts, 0);
+
+            min_ = std::numeric_limits<uint64_t>::max();
+            max_ = 0;
+
+            total = 0;
+            sum = 0;
+        }
+
+    private:
+        // values below 2^bits have a counter each, above that the top bits of a value select its counter
+        std::size_t index(uint64_t value) const noexcept
+        {
+            if (value < (uint64_t(1) << bits))
+                return value;
+
+            auto shift = std::bit_width(value) - bits;
+            auto half = std::size_t(1) << (bits - 1);
+
+            return (std::size_t(1) << bits) + (shift - 1) * half + ((value >> shift) - half);
+        }
+
+        uint64_t highest_equivalent(std::size_t i) const noexcept
+        {
+            if (i < (std::size_t(1) << bits))
+                return i;
+
+            auto half = std::size_t(1) << (bits - 1);
+            auto shift = (i - (std::size_t(1) << bits)) / half + 1;
+
+            auto sub = (i - (std::size_t(1) << bits)) % half + half;
+
+            return ((uint64_t(sub) + 1) << shift) - 1;
+        }
+
+        int bits;
+        uint64_t highest;
+
+        std::vector<uint64_t> counts;
+
+        uint64_t min_ = std::numeric_limits<uint64_t>::max();
+        uint64_t max_ = 0;
+
+        uint64_t total = 0;
+        double sum = 0;
+    };
+}
+
+#endif
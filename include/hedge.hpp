@@ -0,0 +1,422 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef HEDGE_HPP
+#define HEDGE_HPP
+
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <variant>
+#include <optional>
+#include <algorithm>
+#include <unifex/get_stop_token.hpp>
+#include <unifex/manual_lifetime.hpp>
+#include <unifex/sender_concepts.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <unifex/scheduler_concepts.hpp>
+#include <unifex/inplace_stop_token.hpp>
+#include <tracer.hpp>
+
+namespace snp
+{
+    struct hedge_stats
+    {
+        uint64_t requests;
+        uint64_t hedged;
+
+        uint64_t primary_wins;
+        uint64_t hedge_wins;
+
+        uint64_t failures;
+    };
+
+    struct hedge_policy
+    {
+        using clock = std::chrono::steady_clock;
+        using duration = std::chrono::nanoseconds;
+
+        explicit hedge_policy(duration delay) : initial(delay)
+        {
+        }
+
+        hedge_policy(double percentile, duration initial, std::size_t window = 1024) : percentile(percentile), initial(initial), samples(window)
+        {
+        }
+
+        duration delay()
+        {
+            if (samples.empty())
+                return initial;
+
+            std::lock_guard lock(m);
+
+            if (count < samples.size() / 8)
+                return initial;
+
+            if (dirty)
+            {
+                std::size_t n = std::min(count, samples.size());
+                scratch.assign(samples.begin(), samples.begin() + n);
+
+                auto nth = scratch.begin() + static_cast<std::size_t>(percentile * (n - 1));
+                std::nth_element(scratch.begin(), nth, scratch.end());
+
+                current = *nth;
+                dirty = false;
+            }
+
+            return current;
+        }
+
+        void record(duration latency)
+        {
+            if (samples.empty())
+                return;
+
+            std::lock_guard lock(m);
+
+            samples[count++ % samples.size()] = latency;
+            dirty = true;
+        }
+
+        hedge_stats stats() const noexcept
+        {
+            return {requests.load(), hedged.load(), primary_wins.load(), hedge_wins.load(), failures.load()};
+        }
+
+        double percentile = 0;
+        duration initial;
+
+        std::mutex m;
+        std::size_t count = 0;
+
+        bool dirty = false;
+        duration current{};
+
+        std::vector<duration> samples;
+        std::vector<duration> scratch;
+
+        std::atomic<uint64_t> requests = 0;
+        std::atomic<uint64_t> hedged = 0;
+
+        std::atomic<uint64_t> primary_wins = 0;
+        std::atomic<uint64_t> hedge_wins = 0;
+
+        std::atomic<uint64_t> failures = 0;
+    };
+
+    template <typename... Ts>
+    using decayed_tuple = std::tuple<std::decay_t<Ts>...>;
+
+    template <typename Scheduler, typename Factory>
+    struct hedge
+    {
+        using clock = hedge_policy::clock;
+        using duration = hedge_policy::duration;
+
+        using sender_t = std::invoke_result_t<Factory&>;
+        using timer_t = decltype(unifex::schedule_after(std::declval<Scheduler&>(), std::declval<duration>()));
+
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = unifex::sender_value_types_t<sender_t, Variant, Tuple>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = unifex::sender_error_types_t<sender_t, Variant>;
+
+        static constexpr bool sends_done = true;
+
+        hedge(const Scheduler& sch, Factory&& factory, hedge_policy& policy) : sch(sch), factory(std::forward<Factory>(factory)), policy(policy)
+        {
+        }
+
+        template <typename Receiver>
+        struct operation
+        {
+            using value_t = value_types<std::variant, decayed_tuple>;
+            using error_t = error_types<std::variant>;
+
+            struct child_receiver
+            {
+                template <typename... Values>
+                void set_value(Values&&... values) noexcept
+                {
+                    op->on_value(index, std::forward<Values>(values)...);
+                }
+
+                template <typename Error>
+                void set_error(Error&& error) noexcept
+                {
+                    op->on_failure(index, std::forward<Error>(error));
+                }
+
+                void set_done() noexcept
+                {
+                    op->on_failure(index, std::monostate{});
+                }
+
+                friend unifex::inplace_stop_token tag_invoke(unifex::tag_t<unifex::get_stop_token>, const child_receiver& r) noexcept
+                {
+                    return r.op->sources[r.index].get_token();
+                }
+
+                friend tracer_of_t<Receiver> tag_invoke(unifex::tag_t<get_tracer>, const child_receiver& r) noexcept
+                {
+                    return get_tracer(r.op->receiver);
+                }
+
+                operation* op;
+                std::size_t index;
+            };
+
+            struct timer_receiver
+            {
+                void set_value() noexcept
+                {
+                    op->on_timer();
+                }
+
+                template <typename Error>
+                void set_error(Error&&) noexcept
+                {
+                    op->arrive();
+                }
+
+                void set_done() noexcept
+                {
+                    op->arrive();
+                }
+
+                friend unifex::inplace_stop_token tag_invoke(unifex::tag_t<unifex::get_stop_token>, const timer_receiver& r) noexcept
+                {
+                    return r.op->sources[2].get_token();
+                }
+
+                operation* op;
+            };
+
+            struct on_stop
+            {
+                void operator()() noexcept
+                {
+                    for (auto& source : op->sources)
+                         source.request_stop();
+                }
+
+                operation* op;
+            };
+
+            using child_op_t = unifex::connect_result_t<sender_t, child_receiver>;
+            using timer_op_t = unifex::connect_result_t<timer_t, timer_receiver>;
+
+            using stop_token_t = unifex::stop_token_type_t<Receiver>;
+            using callback_t = typename stop_token_t::template callback_type<on_stop>;
+
+            operation(Receiver receiver, const Scheduler& sch, const Factory& factory, hedge_policy& policy) :
+            receiver(std::move(receiver)), sch(sch), factory(factory), policy(policy)
+            {
+            }
+
+            operation(operation&&) = delete;
+
+            ~operation()
+            {
+                for (std::size_t i = 0; i != launched; ++i)
+                     children[i].destruct();
+
+                if (timed)
+                    timer.destruct();
+            }
+
+            constexpr decltype(auto) start() noexcept
+            {
+                policy.requests.fetch_add(1, std::memory_order_relaxed);
+                callback.emplace(unifex::get_stop_token(receiver), on_stop{this});
+
+                launch(0);
+
+                timer.construct_with([&]
+                {
+                    return unifex::connect(unifex::schedule_after(sch, policy.delay()), timer_receiver{this});
+                });
+
+                timed = true;
+
+                unifex::start(timer.get());
+            }
+
+            void launch(std::size_t index)
+            {
+                starts[index] = clock::now();
+
+                children[index].construct_with([&]
+                {
+                    return unifex::connect(factory(), child_receiver{this, index});
+                });
+
+                ++launched;
+
+                unifex::start(children[index].get());
+            }
+
+            bool hedge_now()
+            {
+                std::lock_guard lock(m);
+
+                if (winner >= 0 || started != 1 || sources[1].stop_requested())
+                    return false;
+
+                started = 2;
+                ++pending;
+
+                return true;
+            }
+
+            void start_hedge()
+            {
+                if (!hedge_now())
+                    return;
+
+                policy.hedged.fetch_add(1, std::memory_order_relaxed);
+                launch(1);
+            }
+
+            void on_timer()
+            {
+                start_hedge();
+                arrive();
+            }
+
+            template <typename... Values>
+            void on_value(std::size_t index, Values&&... values)
+            {
+                bool won = false;
+
+                {
+                    std::lock_guard lock(m);
+
+                    if (winner < 0)
+                    {
+                        winner = index;
+                        won = true;
+
+                        value.emplace(std::in_place_type<decayed_tuple<Values...>>, std::forward<Values>(values)...);
+                    }
+                }
+
+                if (won)
+                {
+                    policy.record(clock::now() - starts[index]);
+                    (index ? policy.hedge_wins : policy.primary_wins).fetch_add(1, std::memory_order_relaxed);
+
+                    sources[1 - index].request_stop();
+                    sources[2].request_stop();
+                }
+
+                arrive();
+            }
+
+            template <typename Error>
+            void on_failure(std::size_t index, Error&& error)
+            {
+                {
+                    std::lock_guard lock(m);
+
+                    if constexpr(!std::is_same_v<std::decay_t<Error>, std::monostate>)
+                        if (winner < 0)
+                            this->error.emplace(std::in_place_type<std::decay_t<Error>>, std::forward<Error>(error));
+                }
+
+                if (!index && !sources[0].stop_requested())
+                {
+                    sources[2].request_stop();
+                    start_hedge();
+                }
+
+                arrive();
+            }
+
+            void arrive()
+            {
+                {
+                    std::lock_guard lock(m);
+
+                    if (--pending)
+                        return;
+                }
+
+                callback.reset();
+
+                if (value)
+                    std::visit([this](auto& t)
+                    {
+                        std::apply([this](auto&... values)
+                        {
+                            unifex::set_value(std::move(receiver), std::move(values)...);
+                        }, t);
+                    }, *value);
+                else if (policy.failures.fetch_add(1, std::memory_order_relaxed); error && !stop_requested())
+                    std::visit([this](auto& e)
+                    {
+                        unifex::set_error(std::move(receiver), std::move(e));
+                    }, *error);
+                else
+                    unifex::set_done(std::move(receiver));
+            }
+
+            bool stop_requested() const noexcept
+            {
+                return unifex::get_stop_token(receiver).stop_requested();
+            }
+
+            Receiver receiver;
+            Scheduler sch;
+
+            Factory factory;
+            hedge_policy& policy;
+
+            std::mutex m;
+            int winner = -1;
+
+            bool timed = false;
+            std::size_t launched = 0;
+
+            std::size_t started = 1;
+            std::size_t pending = 2;
+
+            std::optional<value_t> value;
+            std::optional<error_t> error;
+
+            clock::time_point starts[2];
+            unifex::inplace_stop_source sources[3];
+
+            unifex::manual_lifetime<child_op_t> children[2];
+            unifex::manual_lifetime<timer_op_t> timer;
+
+            std::optional<callback_t> callback;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return operation<std::remove_cvref_t<Receiver>>(std::forward<Receiver>(receiver), sch, factory, policy);
+        }
+
+        Scheduler sch;
+        Factory factory;
+
+        hedge_policy& policy;
+    };
+
+    template <typename Scheduler, typename Factory>
+    hedge(const Scheduler& sch, Factory&& factory, hedge_policy& policy) -> hedge<Scheduler, Factory>;
+}
+
+#endif
@@ -0,0 +1,402 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef HTTP_PARSER_HPP
+#define HTTP_PARSER_HPP
+
+#include <span>
+#include <ctime>
+#include <cctype>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include <charconv>
+#include <string_view>
+#include <boost/asio.hpp>
+#include <simd.hpp>
+#include <buffer_pool.hpp>
+
+namespace snp::http
+{
+    namespace net = boost::asio;
+
+    using error_code_t = boost::system::error_code;
+
+    struct header
+    {
+        std::string_view name;
+        std::string_view value;
+    };
+
+    inline bool iequals(std::string_view a, std::string_view b) noexcept
+    {
+        return std::ranges::equal(a, b, [](char x, char y){ return std::tolower(x) == std::tolower(y); });
+    }
+
+    inline bool contains(std::string_view value, std::string_view token) noexcept
+    {
+        return !std::ranges::search(value, token, [](char x, char y){ return std::tolower(x) == std::tolower(y); }).empty();
+    }
+
+    // a field name is a token, so whitespace before the colon and the continuation lines of an obsolete line folding,
+    // which start with a space or a tab, are rejected, two parsers disagreeing on a field is what request smuggling relies on
+    inline bool is_token(std::string_view name) noexcept
+    {
+        return !name.empty() && std::ranges::all_of(name, [](unsigned char c){ return std::isalnum(c) || (c && std::strchr("!#$%&'*+-.^_`|~", c)); });
+    }
+
+    // the views point into the buffer of the reader, they stay valid until the next read
+    struct request
+    {
+        std::string_view operator[](std::string_view name) const noexcept
+        {
+            for (auto& h : headers)
+                 if (iequals(h.name, name))
+                     return h.value;
+
+            return {};
+        }
+
+        std::string_view method;
+        std::string_view target;
+
+        int version = 11;
+        bool keep_alive = true;
+
+        std::size_t content_length = 0;
+        std::span<const header> headers;
+        std::string_view body;
+    };
+
+    // parses the request at the front of data, returns its length including the body once the header block is complete,
+    // or 0 while it isn't, the body is only set if the whole request is buffered, malformed requests set ec,
+    // the end of the header block and the end of every line are found with simd::find
+    inline std::size_t parse_request(const char* data, std::size_t size, request& req, std::vector<header>& headers, error_code_t& ec)
+    {
+        auto end = simd::find(data, size, "\r\n\r\n");
+
+        if (end == simd::npos)
+            return 0;
+
+        auto block = std::string_view(data, end + 2);
+
+        auto eol = simd::find(block.data(), block.size(), "\r\n");
+        auto line = block.substr(0, eol);
+
+        auto sp1 = line.find(' ');
+        auto sp2 = line.find(' ', sp1 + 1);
+
+        if (sp1 == line.npos || sp2 == line.npos || !line.substr(sp2 + 1).starts_with("HTTP/1."))
+        {
+            ec = net::error::invalid_argument;
+
+            return 0;
+        }
+
+        req.method = line.substr(0, sp1);
+        req.target = line.substr(sp1 + 1, sp2 - sp1 - 1);
+
+        auto minor = line.substr(sp2 + 8);
+        req.version = minor == "1" ? 11 : 10;
+
+        if (minor != "1" && minor != "0")
+        {
+            ec = net::error::invalid_argument;
+
+            return 0;
+        }
+
+        std::string_view connection;
+        std::size_t& length = req.content_length;
+
+        bool has_length = false;
+
+        for (auto pos = eol + 2; pos < block.size(); )
+        {
+            auto next = pos + simd::find(block.data() + pos, block.size() - pos, "\r\n");
+            line = block.substr(pos, next - pos);
+
+            auto colon = line.find(':');
+            auto name = line.substr(0, colon);
+
+            if (colon == line.npos || !is_token(name))
+            {
+                ec = net::error::invalid_argument;
+
+                return 0;
+            }
+            auto value = line.substr(colon + 1);
+
+            while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+                value.remove_prefix(1);
+
+            while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+                value.remove_suffix(1);
+
+            if (iequals(name, "Content-Length"))
+            {
+                std::size_t n = 0;
+                auto [p, e] = std::from_chars(value.data(), value.data() + value.size(), n);
+
+                // a repeated length that differs from the first one makes the body ambiguous, which request smuggling relies on
+                if (e != std::errc() || p != value.data() + value.size() || (has_length && n != length))
+                {
+                    ec = net::error::invalid_argument;
+
+                    return 0;
+                }
+
+                length = n;
+                has_length = true;
+            }
+            else if (iequals(name, "Transfer-Encoding"))
+            {
+                ec = net::error::operation_not_supported;
+
+                return 0;
+            }
+            else if (iequals(name, "Connection"))
+                connection = value;
+
+            headers.push_back({name, value});
+            pos = next + 2;
+        }
+
+        req.keep_alive = req.version == 11 ? !contains(connection, "close") : contains(connection, "keep-alive");
+
+        auto total = end + 4 + length;
+
+        if (total <= size)
+            req.body = std::string_view(data + end + 4, length);
+
+        return total;
+    }
+
+    // reads requests into a pooled buffer, and collects every complete request into a batch, so that
+    // the pipelined requests of a client are parsed from a single read and answered with a single write
+    struct request_reader
+    {
+        explicit request_reader(std::size_t capacity = 16 * 1024, std::size_t max_header_size = 64 * 1024, std::size_t max_body_size = 1 << 20) :
+        buffer(capacity), max_header_size(max_header_size), max_body_size(max_body_size)
+        {
+        }
+
+        // drops the previous batch, an error is only reported once the requests in front of it have been delivered
+        std::size_t parse(error_code_t& ec)
+        {
+            requests.clear();
+            headers.clear();
+
+            offsets.clear();
+
+            while (head != tail)
+            {
+                request req;
+                error_code_t error;
+
+                auto first = headers.size();
+                auto n = parse_request(buffer.data() + head, tail - head, req, headers, error);
+
+                if (!error && (n ? req.content_length > max_body_size : tail - head >= max_header_size))
+                    error = net::error::message_size;
+
+                if (error || !n || n > tail - head)
+                {
+                    headers.resize(first);
+
+                    if (error && requests.empty())
+                        ec = error;
+
+                    need = n;
+
+                    break;
+                }
+
+                offsets.push_back(first);
+                requests.push_back(req);
+
+                head += n;
+            }
+
+            for (std::size_t i = 0; i != requests.size(); ++i)
+                 requests[i].headers = std::span<const header>(headers).subspan(offsets[i], (i + 1 == requests.size() ? headers.size() : offsets[i + 1]) - offsets[i]);
+
+            return requests.size();
+        }
+
+        // moves the partial request to the front, and grows the buffer if the request can't fit
+        net::mutable_buffer prepare()
+        {
+            if (head)
+            {
+                std::memmove(buffer.data(), buffer.data() + head, tail - head);
+
+                tail -= head;
+                head = 0;
+            }
+
+            if (need > buffer.size() || tail == buffer.size())
+                buffer.grow(std::max(need, 2 * buffer.size()), tail);
+
+            need = 0;
+
+            return net::buffer(buffer.data() + tail, buffer.size() - tail);
+        }
+
+        void commit(std::size_t n) noexcept
+        {
+            tail += n;
+            received += n;
+        }
+
+        std::span<const request> batch() const noexcept
+        {
+            return requests;
+        }
+
+        std::size_t buffered() const noexcept
+        {
+            return tail - head;
+        }
+
+        pooled_buffer buffer;
+
+        std::size_t max_header_size;
+        std::size_t max_body_size;
+
+        std::size_t head = 0;
+        std::size_t tail = 0;
+
+        std::size_t need = 0;
+
+        // the bytes read so far
+        uint64_t received = 0;
+
+        std::vector<request> requests;
+        std::vector<header> headers;
+
+        std::vector<std::size_t> offsets;
+    };
+
+    inline std::string_view reason(int status) noexcept
+    {
+        switch (status)
+        {
+            case 200: return "OK";
+            case 201: return "Created";
+            case 204: return "No Content";
+            case 301: return "Moved Permanently";
+            case 302: return "Found";
+            case 304: return "Not Modified";
+            case 400: return "Bad Request";
+            case 403: return "Forbidden";
+            case 404: return "Not Found";
+            case 405: return "Method Not Allowed";
+            case 413: return "Payload Too Large";
+            case 431: return "Request Header Fields Too Large";
+            case 500: return "Internal Server Error";
+            case 501: return "Not Implemented";
+            case 503: return "Service Unavailable";
+            default: return "Unknown";
+        }
+    }
+
+    // the Date header value, formatted at most once a second per thread
+    inline std::string_view date() noexcept
+    {
+        thread_local std::time_t last = 0;
+        thread_local char value[32];
+
+        if (auto now = std::time(nullptr); now != last)
+        {
+            std::tm tm;
+            gmtime_r(&now, &tm);
+
+            std::strftime(value, sizeof(value), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+            last = now;
+        }
+
+        return value;
+    }
+
+    struct response
+    {
+        void set(std::string_view name, std::string_view value)
+        {
+            fields.append(name).append(": ").append(value).append("\r\n");
+        }
+
+        void clear() noexcept
+        {
+            status = 200;
+            keep_alive = true;
+
+            content_type = "text/plain";
+
+            fields.clear();
+            body.clear();
+        }
+
+        int status = 200;
+        bool keep_alive = true;
+
+        std::string_view content_type = "text/plain";
+
+        std::string fields;
+        std::string body;
+    };
+
+    // serializes the responses of a batch back to back into one buffer, which is sent with a single write
+    struct response_writer
+    {
+        void add(const response& res, int version, bool keep_alive)
+        {
+            char length[24];
+            auto end = std::to_chars(length, length + sizeof(length), res.body.size()).ptr;
+
+            char status[4];
+            std::to_chars(status, status + 3, res.status);
+
+            out.append("HTTP/1.1 ").append(status, 3).append(" ").append(reason(res.status)).append("\r\nServer: snp\r\nDate: ").append(date());
+            out.append("\r\nContent-Type: ").append(res.content_type).append("\r\nContent-Length: ").append(length, end).append("\r\n");
+
+            if (!keep_alive)
+                out.append("Connection: close\r\n");
+            else if (version == 10)
+                out.append("Connection: keep-alive\r\n");
+
+            out.append(res.fields).append("\r\n").append(res.body);
+        }
+
+        net::const_buffer buffer() const noexcept
+        {
+            return net::buffer(out);
+        }
+
+        std::size_t size() const noexcept
+        {
+            return out.size();
+        }
+
+        bool empty() const noexcept
+        {
+            return out.empty();
+        }
+
+        void clear() noexcept
+        {
+            out.clear();
+        }
+
+        std::string out;
+    };
+}
+
+#endif
@@ -0,0 +1,238 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef HTTP_SERVER_HPP
+#define HTTP_SERVER_HPP
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <sstream>
+#include <unordered_set>
+#include <boost/asio.hpp>
+#include <unifex/then.hpp>
+#include <unifex/upon_error.hpp>
+#include <metrics.hpp>
+#include <async_accept.hpp>
+#include <http_parser.hpp>
+#include <start_detached.hpp>
+#include <async_read_request.hpp>
+#include <async_write_response.hpp>
+
+namespace snp::http
+{
+    namespace net = boost::asio;
+
+    using tcp = net::ip::tcp;
+
+    struct server_options
+    {
+        std::size_t buffer_size = 16 * 1024;
+
+        std::size_t max_header_size = 64 * 1024;
+        std::size_t max_body_size = 1 << 20;
+    };
+
+    // accepts connections and serves them with keep-alive, every read parses all the pipelined requests
+    // that arrived, calls handler(const request&, response&) for each of them in order, and sends the
+    // responses of the whole batch with a single write, before the next batch is read
+    template <typename Handler>
+    class server
+    {
+    public:
+        server(net::io_context& ioc, const tcp::endpoint& endpoint, Handler handler, server_options options = {}) :
+        acceptor(ioc, endpoint), handler(std::move(handler)), options(options)
+        {
+            do_accept();
+        }
+
+        tcp::endpoint local_endpoint() const
+        {
+            return acceptor.local_endpoint();
+        }
+
+        void close()
+        {
+            error_code_t ec;
+            acceptor.close(ec);
+        }
+
+        // the bytes every open session read and wrote so far, labeled by its remote endpoint,
+        // they are counted when SNP_ENABLE_METRICS is defined
+        std::vector<metrics::stream_snapshot> sessions() const
+        {
+            std::lock_guard lock(mutex);
+            std::vector<metrics::stream_snapshot> v;
+
+            for (auto s : live)
+            {
+                 std::ostringstream os;
+                 os << s->peer;
+
+                 v.push_back({os.str(), s->stats.read.load(std::memory_order_relaxed), s->stats.written.load(std::memory_order_relaxed)});
+            }
+
+            return v;
+        }
+
+    private:
+        class session : public std::enable_shared_from_this<session>
+        {
+        public:
+            session(tcp::socket socket, server& srv) : socket(std::move(socket)), srv(srv),
+            reader(srv.options.buffer_size, srv.options.max_header_size, srv.options.max_body_size)
+            {
+                error_code_t ec;
+
+                this->socket.set_option(tcp::no_delay(true), ec);
+                peer = this->socket.remote_endpoint(ec);
+
+                std::lock_guard lock(srv.mutex);
+                srv.live.insert(this);
+            }
+
+            ~session()
+            {
+                std::lock_guard lock(srv.mutex);
+                srv.live.erase(this);
+            }
+
+            void do_read()
+            {
+                async_read_request(socket, reader)
+                | unifex::then([this, self = this->shared_from_this()](std::span<const request> batch)
+                  {
+                      on_read(batch);
+                  })
+                | unifex::upon_error([this, self = this->shared_from_this()]<typename Error>(Error error)
+                  {
+                      if constexpr(std::is_same_v<Error, error_code_t>)
+                          on_error(error);
+                  })
+                | snp::start_detached();
+            }
+
+            void on_read(std::span<const request> batch)
+            {
+                count_read();
+                metrics::add(metrics::http_requests, batch.size());
+                bool keep_alive = true;
+
+                for (auto& req : batch)
+                {
+                     res.clear();
+                     srv.handler(req, res);
+
+                     keep_alive = req.keep_alive && res.keep_alive;
+                     writer.add(res, req.version, keep_alive);
+
+                     if (!keep_alive)
+                         break;
+                }
+
+                do_write(keep_alive);
+            }
+
+            // answers a request that can't be parsed, and closes the connection
+            void on_error(error_code_t ec)
+            {
+                count_read();
+
+                if (ec == net::error::eof || ec == net::error::operation_aborted || ec == net::error::connection_reset)
+                    return;
+
+                res.clear();
+
+                if (ec == net::error::message_size)
+                    res.status = reader.buffered() >= reader.max_header_size ? 431 : 413;
+                else
+                    res.status = ec == net::error::operation_not_supported ? 501 : 400;
+
+                writer.add(res, 11, false);
+                do_write(false);
+            }
+
+            void do_write(bool keep_alive)
+            {
+                async_write_response(socket, writer)
+                | unifex::then([this, self = this->shared_from_this(), keep_alive](std::size_t n)
+                  {
+                      stats.on_write(n);
+                      metrics::add(metrics::http_bytes_written, n);
+
+                      if (keep_alive)
+                          do_read();
+                      else
+                          shutdown();
+                  })
+                | unifex::upon_error([self = this->shared_from_this()](auto)
+                  {
+                  })
+                | snp::start_detached();
+            }
+
+            void shutdown()
+            {
+                error_code_t ec;
+                socket.shutdown(tcp::socket::shutdown_send, ec);
+            }
+
+            // the reader counts what it read, whether or not it completed a request
+            void count_read()
+            {
+                auto n = reader.received - stats.read.load(std::memory_order_relaxed);
+
+                stats.on_read(n);
+                metrics::add(metrics::http_bytes_read, n);
+            }
+
+        private:
+            friend class server;
+
+            tcp::socket socket;
+            server& srv;
+
+            tcp::endpoint peer;
+            metrics::stream_stats stats;
+
+            request_reader reader;
+            response_writer writer;
+
+            response res;
+            metrics::scoped_gauge open{metrics::http_sessions};
+        };
+
+        void do_accept()
+        {
+            snp::async_accept(acceptor)
+            | unifex::then([this](tcp::socket socket)
+              {
+                  std::make_shared<session>(std::move(socket), *this)->do_read();
+                  do_accept();
+              })
+            | unifex::upon_error([this]<typename Error>(Error error)
+              {
+                  if constexpr(std::is_same_v<Error, error_code_t>)
+                      if (error != net::error::operation_aborted && error != net::error::bad_descriptor)
+                          do_accept();
+              })
+            | snp::start_detached();
+        }
+
+        tcp::acceptor acceptor;
+
+        Handler handler;
+        server_options options;
+
+        mutable std::mutex mutex;
+        std::unordered_set<session*> live;
+    };
+}
+
+#endif
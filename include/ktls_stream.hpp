@@ -0,0 +1,680 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef KTLS_STREAM_HPP
+#define KTLS_STREAM_HPP
+
+#include <mutex>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#include <openssl/kdf.h>
+#include <openssl/ssl.h>
+#include <openssl/evp.h>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <tls_handshake.hpp>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+namespace snp::ktls
+{
+    namespace net = boost::asio;
+    namespace ssl = net::ssl;
+
+    using error_code_t = boost::system::error_code;
+
+    // what is captured of a connection during its handshake, the TLS 1.3 traffic secrets come from the keylog callback,
+    // and the session tickets a server sends after its Finished advance its write sequence
+    struct secrets
+    {
+        unsigned char client[EVP_MAX_MD_SIZE];
+        unsigned char server[EVP_MAX_MD_SIZE];
+
+        std::size_t size = 0;
+        uint64_t tickets = 0;
+    };
+
+    union crypto_info
+    {
+        tls_crypto_info info;
+
+        tls12_crypto_info_aes_gcm_128 aes_gcm_128;
+        tls12_crypto_info_aes_gcm_256 aes_gcm_256;
+
+        tls12_crypto_info_chacha20_poly1305 chacha20_poly1305;
+    };
+
+    // the parameters of both directions, ready to be passed to setsockopt(SOL_TLS)
+    struct keys
+    {
+        crypto_info tx;
+        crypto_info rx;
+
+        socklen_t size = 0;
+        bool rx_allowed = false;
+    };
+
+    enum direction : int
+    {
+        none = 0,
+        tx = 1,
+        rx = 2
+    };
+
+    inline int secrets_index()
+    {
+        static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+        {
+            delete static_cast<secrets*>(ptr);
+        });
+
+        return index;
+    }
+
+    inline int keylog_index()
+    {
+        static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+
+        return index;
+    }
+
+    // a context is shared by the connections of every thread, its keylog callback is checked and replaced under this lock
+    inline std::mutex& keylog_mutex()
+    {
+        static std::mutex m;
+
+        return m;
+    }
+
+    inline secrets* state(const SSL* ssl)
+    {
+        return static_cast<secrets*>(SSL_get_ex_data(ssl, secrets_index()));
+    }
+
+    inline std::size_t unhex(std::string_view hex, unsigned char* out, std::size_t size) noexcept
+    {
+        auto value = [](char c)
+        {
+            return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10;
+        };
+
+        std::size_t n = std::min(hex.size() / 2, size);
+
+        for (std::size_t i = 0; i != n; ++i)
+             out[i] = static_cast<unsigned char>(value(hex[2 * i]) << 4 | value(hex[2 * i + 1]));
+
+        return n;
+    }
+
+    // keeps the application traffic secrets of the connections that are prepared, and forwards every line
+    // to the keylog callback that was installed on the context before
+    inline void keylog(const SSL* ssl, const char* line)
+    {
+        auto ctx = SSL_get_SSL_CTX(ssl);
+
+        if (auto previous = reinterpret_cast<void (*)(const SSL*, const char*)>(SSL_CTX_get_ex_data(ctx, keylog_index())))
+            previous(ssl, line);
+
+        auto s = state(ssl);
+
+        if (!s)
+            return;
+
+        std::string_view text(line);
+
+        auto label = text.substr(0, text.find(' '));
+        auto secret = text.substr(text.rfind(' ') + 1);
+
+        if (label == "CLIENT_TRAFFIC_SECRET_0")
+            s->size = unhex(secret, s->client, sizeof(s->client));
+        else if (label == "SERVER_TRAFFIC_SECRET_0")
+            s->size = unhex(secret, s->server, sizeof(s->server));
+    }
+
+    inline void on_message(int write_p, int version, int content_type, const void* buf, std::size_t len, SSL* ssl, void*)
+    {
+        if (write_p && version == TLS1_3_VERSION && content_type == SSL3_RT_HANDSHAKE && len && *static_cast<const unsigned char*>(buf) == SSL3_MT_NEWSESSION_TICKET)
+            if (auto s = state(ssl))
+                ++s->tickets;
+    }
+
+    // must be called before the handshake, it hooks the keylog callback of the context and tracks the records of the connection
+    inline void prepare(SSL* ssl)
+    {
+        auto ctx = SSL_get_SSL_CTX(ssl);
+
+        {
+            std::lock_guard lock(keylog_mutex());
+
+            if (auto callback = SSL_CTX_get_keylog_callback(ctx); callback != keylog)
+            {
+                SSL_CTX_set_ex_data(ctx, keylog_index(), reinterpret_cast<void*>(callback));
+                SSL_CTX_set_keylog_callback(ctx, keylog);
+            }
+        }
+
+        if (!state(ssl))
+            SSL_set_ex_data(ssl, secrets_index(), new secrets);
+
+        SSL_set_msg_callback(ssl, on_message);
+    }
+
+    inline bool expand_label(const EVP_MD* md, const unsigned char* secret, std::size_t size, std::string_view label, unsigned char* out, std::size_t length)
+    {
+        unsigned char info[2 + 1 + 255 + 1];
+        std::size_t n = 0;
+
+        info[n++] = static_cast<unsigned char>(length >> 8);
+        info[n++] = static_cast<unsigned char>(length);
+
+        info[n++] = static_cast<unsigned char>(6 + label.size());
+
+        std::memcpy(info + n, "tls13 ", 6);
+        std::memcpy(info + n + 6, label.data(), label.size());
+
+        n += 6 + label.size();
+        info[n++] = 0;
+
+        auto ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+
+        bool ok = ctx && EVP_PKEY_derive_init(ctx) > 0 && EVP_PKEY_CTX_hkdf_mode(ctx, EVP_PKEY_HKDEF_MODE_EXPAND_ONLY) > 0 &&
+                  EVP_PKEY_CTX_set_hkdf_md(ctx, md) > 0 && EVP_PKEY_CTX_set1_hkdf_key(ctx, secret, size) > 0 &&
+                  EVP_PKEY_CTX_add1_hkdf_info(ctx, info, n) > 0 && EVP_PKEY_derive(ctx, out, &length) > 0;
+
+        EVP_PKEY_CTX_free(ctx);
+
+        return ok;
+    }
+
+    inline bool key_block(SSL* ssl, const EVP_MD* md, unsigned char* out, std::size_t length)
+    {
+        unsigned char master[SSL_MAX_MASTER_KEY_LENGTH];
+        unsigned char random[2 * SSL3_RANDOM_SIZE];
+
+        auto size = SSL_SESSION_get_master_key(SSL_get_session(ssl), master, sizeof(master));
+
+        SSL_get_server_random(ssl, random, SSL3_RANDOM_SIZE);
+        SSL_get_client_random(ssl, random + SSL3_RANDOM_SIZE, SSL3_RANDOM_SIZE);
+
+        static constexpr std::string_view label = "key expansion";
+
+        auto ctx = EVP_PKEY_CTX_new_id(EVP_PKEY_TLS1_PRF, nullptr);
+
+        bool ok = ctx && EVP_PKEY_derive_init(ctx) > 0 && EVP_PKEY_CTX_set_tls1_prf_md(ctx, md) > 0 &&
+                  EVP_PKEY_CTX_set1_tls1_prf_secret(ctx, master, size) > 0 &&
+                  EVP_PKEY_CTX_add1_tls1_prf_seed(ctx, reinterpret_cast<const unsigned char*>(label.data()), label.size()) > 0 &&
+                  EVP_PKEY_CTX_add1_tls1_prf_seed(ctx, random, sizeof(random)) > 0 && EVP_PKEY_derive(ctx, out, &length) > 0;
+
+        EVP_PKEY_CTX_free(ctx);
+        OPENSSL_cleanse(master, sizeof(master));
+
+        return ok;
+    }
+
+    inline void fill(crypto_info& info, int version, int cipher, const unsigned char* key, const unsigned char* iv, uint64_t seq) noexcept
+    {
+        unsigned char rec_seq[8];
+
+        for (int i = 8; i--; seq >>= 8)
+             rec_seq[i] = static_cast<unsigned char>(seq);
+
+        std::memset(&info, 0, sizeof(info));
+
+        info.info.version = version;
+        info.info.cipher_type = cipher;
+
+        // TLS 1.2 sends the explicit part of the nonce in every record, the kernel starts it at the sequence number like OpenSSL does
+        auto set = [&](auto& c)
+        {
+            std::memcpy(c.key, key, sizeof(c.key));
+            std::memcpy(c.rec_seq, rec_seq, sizeof(c.rec_seq));
+
+            // AES-GCM splits the iv into a 4 byte salt and an 8 byte nonce, ChaCha20-Poly1305 takes it whole
+            if constexpr(sizeof(c.iv) == 8)
+            {
+                std::memcpy(c.salt, iv, sizeof(c.salt));
+
+                if (version == TLS_1_2_VERSION)
+                    std::memcpy(c.iv, rec_seq, sizeof(c.iv));
+                else
+                    std::memcpy(c.iv, iv + sizeof(c.salt), sizeof(c.iv));
+            }
+            else
+                std::memcpy(c.iv, iv, sizeof(c.iv));
+        };
+
+        if (cipher == TLS_CIPHER_AES_GCM_128)
+            set(info.aes_gcm_128);
+        else if (cipher == TLS_CIPHER_AES_GCM_256)
+            set(info.aes_gcm_256);
+        else
+            set(info.chacha20_poly1305);
+    }
+
+    // derives the keys and record sequence numbers of both directions right after the handshake of a prepared connection,
+    // only AES-GCM and ChaCha20-Poly1305 with TLS 1.2 or 1.3 can be offloaded
+    inline bool derive(SSL* ssl, bool server, keys& k, error_code_t& ec)
+    {
+        auto cipher = SSL_get_current_cipher(ssl);
+        auto version = SSL_version(ssl);
+
+        auto s = state(ssl);
+
+        if (!cipher || !s || (version != TLS1_2_VERSION && version != TLS1_3_VERSION))
+        {
+            ec = net::error::operation_not_supported;
+
+            return false;
+        }
+
+        int type;
+
+        std::size_t key_size;
+        std::size_t iv_size;
+
+        switch (SSL_CIPHER_get_cipher_nid(cipher))
+        {
+            case NID_aes_128_gcm:
+                type = TLS_CIPHER_AES_GCM_128;
+                key_size = 16;
+                iv_size = version == TLS1_2_VERSION ? 4 : 12;
+                k.size = sizeof(tls12_crypto_info_aes_gcm_128);
+                break;
+            case NID_aes_256_gcm:
+                type = TLS_CIPHER_AES_GCM_256;
+                key_size = 32;
+                iv_size = version == TLS1_2_VERSION ? 4 : 12;
+                k.size = sizeof(tls12_crypto_info_aes_gcm_256);
+                break;
+            case NID_chacha20_poly1305:
+                type = TLS_CIPHER_CHACHA20_POLY1305;
+                key_size = 32;
+                iv_size = 12;
+                k.size = sizeof(tls12_crypto_info_chacha20_poly1305);
+                break;
+            default:
+                ec = net::error::operation_not_supported;
+
+                return false;
+        }
+
+        auto md = SSL_CIPHER_get_handshake_digest(cipher);
+
+        unsigned char client_key[32], client_iv[12];
+        unsigned char server_key[32], server_iv[12];
+
+        uint64_t client_seq;
+        uint64_t server_seq;
+
+        if (version == TLS1_2_VERSION)
+        {
+            unsigned char block[2 * (32 + 12)];
+
+            if (!key_block(ssl, md, block, 2 * (key_size + iv_size)))
+            {
+                ec = net::error::operation_not_supported;
+
+                return false;
+            }
+
+            std::memcpy(client_key, block, key_size);
+            std::memcpy(server_key, block + key_size, key_size);
+
+            std::memcpy(client_iv, block + 2 * key_size, iv_size);
+            std::memcpy(server_iv, block + 2 * key_size + iv_size, iv_size);
+
+            OPENSSL_cleanse(block, sizeof(block));
+
+            // the Finished messages were the first records under the new keys
+            client_seq = server_seq = 1;
+
+            k.rx_allowed = true;
+        }
+        else
+        {
+            if (!s->size || !expand_label(md, s->client, s->size, "key", client_key, key_size) || !expand_label(md, s->client, s->size, "iv", client_iv, iv_size) ||
+                !expand_label(md, s->server, s->size, "key", server_key, key_size) || !expand_label(md, s->server, s->size, "iv", server_iv, iv_size))
+            {
+                ec = net::error::operation_not_supported;
+
+                return false;
+            }
+
+            client_seq = 0;
+            server_seq = s->tickets;
+
+            // the session tickets a server sends later are handshake records, which the kernel can't pass to a plain read,
+            // so a client only offloads its writes
+            k.rx_allowed = server;
+        }
+
+        int v = version == TLS1_2_VERSION ? TLS_1_2_VERSION : TLS_1_3_VERSION;
+
+        if (server)
+        {
+            fill(k.tx, v, type, server_key, server_iv, server_seq);
+            fill(k.rx, v, type, client_key, client_iv, client_seq);
+        }
+        else
+        {
+            fill(k.tx, v, type, client_key, client_iv, client_seq);
+            fill(k.rx, v, type, server_key, server_iv, server_seq);
+        }
+
+        OPENSSL_cleanse(client_key, sizeof(client_key));
+        OPENSSL_cleanse(server_key, sizeof(server_key));
+
+        // records OpenSSL has already pulled from the socket would be missed by the kernel
+        if (BIO_ctrl_pending(SSL_get_rbio(ssl)) || SSL_pending(ssl))
+            k.rx_allowed = false;
+
+        return true;
+    }
+
+    // attaches the tls ulp to the socket and installs the keys, returns the directions the kernel took over,
+    // none if the tls module is unavailable, in which case the connection stays with OpenSSL untouched
+    inline int install(int fd, keys& k, error_code_t& ec)
+    {
+        if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")))
+        {
+            ec = error_code_t(errno, boost::system::system_category());
+
+            return none;
+        }
+
+        // a tls socket without keys passes the bytes through as they are, so a failure here still leaves a working connection
+        if (setsockopt(fd, SOL_TLS, TLS_TX, &k.tx, k.size))
+        {
+            ec = error_code_t(errno, boost::system::system_category());
+
+            return none;
+        }
+
+        if (!k.rx_allowed)
+            return tx;
+
+        if (setsockopt(fd, SOL_TLS, TLS_RX, &k.rx, k.size))
+        {
+            ec = error_code_t(errno, boost::system::system_category());
+
+            return tx;
+        }
+
+        return tx | rx;
+    }
+
+    // reads the non application data record the kernel stopped at, a close_notify alert ends the stream
+    inline error_code_t control_record(int fd)
+    {
+        char data[256];
+        char control[CMSG_SPACE(sizeof(unsigned char))];
+
+        iovec iov{data, sizeof(data)};
+
+        msghdr msg{};
+
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        auto n = recvmsg(fd, &msg, MSG_DONTWAIT);
+
+        if (n < 0)
+            return error_code_t(errno, boost::system::system_category());
+
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+
+        if (cmsg && cmsg->cmsg_level == SOL_TLS && cmsg->cmsg_type == TLS_GET_RECORD_TYPE)
+            if (*CMSG_DATA(cmsg) == SSL3_RT_ALERT && n == 2 && data[1] == SSL_AD_CLOSE_NOTIFY)
+                return net::error::eof;
+
+        return boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+    }
+
+    // sends a close_notify alert through the kernel
+    inline error_code_t close_notify(int fd)
+    {
+        char data[2] = { SSL3_AL_WARNING, SSL_AD_CLOSE_NOTIFY };
+        char control[CMSG_SPACE(sizeof(unsigned char))];
+
+        iovec iov{data, sizeof(data)};
+
+        msghdr msg{};
+
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+
+        auto cmsg = CMSG_FIRSTHDR(&msg);
+
+        cmsg->cmsg_level = SOL_TLS;
+        cmsg->cmsg_type = TLS_SET_RECORD_TYPE;
+
+        cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned char));
+        *CMSG_DATA(cmsg) = SSL3_RT_ALERT;
+
+        if (sendmsg(fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL) < 0)
+            return error_code_t(errno, boost::system::system_category());
+
+        return {};
+    }
+}
+
+namespace snp
+{
+    namespace net = boost::asio;
+    namespace ssl = net::ssl;
+
+    // an ssl stream that hands the record layer to the kernel once the handshake succeeded, afterwards its reads and writes go
+    // straight to the socket as if it were plain tcp, so next_layer() can be used with sendfile and splice while tx_offloaded().
+    // it falls back to OpenSSL when the tls module or the cipher isn't available, offload_error() tells why
+    template <typename NextLayer = net::ip::tcp::socket>
+    struct ktls_stream
+    {
+        using error_code_t = boost::system::error_code;
+
+        using next_layer_type = NextLayer;
+        using executor_type = typename next_layer_type::executor_type;
+
+        using lowest_layer_type = typename next_layer_type::lowest_layer_type;
+        using native_handle_type = SSL*;
+
+        template <typename Arg>
+        ktls_stream(Arg&& arg, ssl::context& ctx) : stream(std::forward<Arg>(arg), ctx)
+        {
+            ktls::prepare(stream.native_handle());
+        }
+
+        executor_type get_executor() noexcept
+        {
+            return stream.get_executor();
+        }
+
+        next_layer_type& next_layer() noexcept
+        {
+            return stream.next_layer();
+        }
+
+        lowest_layer_type& lowest_layer() noexcept
+        {
+            return stream.lowest_layer();
+        }
+
+        native_handle_type native_handle() noexcept
+        {
+            return stream.native_handle();
+        }
+
+        bool tx_offloaded() const noexcept
+        {
+            return offloaded & ktls::tx;
+        }
+
+        bool rx_offloaded() const noexcept
+        {
+            return offloaded & ktls::rx;
+        }
+
+        const error_code_t& offload_error() const noexcept
+        {
+            return error;
+        }
+
+        void offload(bool server)
+        {
+            ktls::keys k;
+
+            if (ktls::derive(stream.native_handle(), server, k, error))
+                offloaded = ktls::install(lowest_layer().native_handle(), k, error);
+
+            OPENSSL_cleanse(&k, sizeof(k));
+        }
+
+        template <typename Initiate>
+        struct handshake_op
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {})
+            {
+                if (started)
+                {
+                    if (!ec)
+                        s.offload(type == ssl::stream_base::server);
+
+                    return self.complete(ec);
+                }
+
+                started = true;
+                initiate(std::move(self));
+            }
+
+            ktls_stream& s;
+            ssl::stream_base::handshake_type type;
+
+            Initiate initiate;
+            bool started = false;
+        };
+
+        template <typename MutableBufferSequence>
+        struct read_op
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                if (started)
+                {
+                    if (ec == boost::system::errc::io_error && s.rx_offloaded())
+                        ec = ktls::control_record(s.lowest_layer().native_handle());
+
+                    return self.complete(ec, n);
+                }
+
+                started = true;
+
+                if (s.rx_offloaded())
+                    s.next_layer().async_read_some(buffers, std::move(self));
+                else
+                    s.stream.async_read_some(buffers, std::move(self));
+            }
+
+            ktls_stream& s;
+            MutableBufferSequence buffers;
+
+            bool started = false;
+        };
+
+        struct shutdown_op
+        {
+            template <typename Self>
+            void operator()(Self& self)
+            {
+                auto ec = ktls::close_notify(s.lowest_layer().native_handle());
+
+                // the SSL object didn't send the alert itself, without the flag it would drop its session as not resumable
+                if (!ec)
+                    SSL_set_shutdown(s.native_handle(), SSL_get_shutdown(s.native_handle()) | SSL_SENT_SHUTDOWN);
+
+                net::post(s.get_executor(), [self = std::move(self), ec]() mutable
+                {
+                    self.complete(ec);
+                });
+            }
+
+            ktls_stream& s;
+        };
+
+        template <typename Token>
+        decltype(auto) async_handshake(ssl::stream_base::handshake_type type, Token&& token)
+        {
+            auto initiate = [this, type](auto&& self)
+            {
+                stream.async_handshake(type, std::move(self));
+            };
+
+            return net::async_compose<Token, void(error_code_t)>(handshake_op<decltype(initiate)>{*this, type, initiate}, token, stream);
+        }
+
+        // runs the cryptography of the handshake on the executor ex, see tls::async_handshake
+        template <typename Executor, typename Token>
+        decltype(auto) async_handshake(ssl::stream_base::handshake_type type, const Executor& ex, Token&& token)
+        {
+            auto initiate = [this, type, ex](auto&& self)
+            {
+                tls::async_handshake(stream, type, ex, std::move(self));
+            };
+
+            return net::async_compose<Token, void(error_code_t)>(handshake_op<decltype(initiate)>{*this, type, initiate}, token, stream);
+        }
+
+        template <typename MutableBufferSequence, typename Token>
+        decltype(auto) async_read_some(const MutableBufferSequence& buffers, Token&& token)
+        {
+            return net::async_compose<Token, void(error_code_t, std::size_t)>(read_op<MutableBufferSequence>{*this, buffers}, token, stream);
+        }
+
+        template <typename ConstBufferSequence, typename Token>
+        decltype(auto) async_write_some(const ConstBufferSequence& buffers, Token&& token)
+        {
+            if (tx_offloaded())
+                return next_layer().async_write_some(buffers, std::forward<Token>(token));
+            else
+                return stream.async_write_some(buffers, std::forward<Token>(token));
+        }
+
+        template <typename Token>
+        decltype(auto) async_shutdown(Token&& token)
+        {
+            if (tx_offloaded())
+                return net::async_compose<Token, void(error_code_t)>(shutdown_op{*this}, token, stream);
+            else
+                return stream.async_shutdown(std::forward<Token>(token));
+        }
+
+        ssl::stream<NextLayer> stream;
+        error_code_t error;
+
+        int offloaded = ktls::none;
+    };
+}
+
+#endif
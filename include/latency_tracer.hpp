@@ -0,0 +1,176 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef LATENCY_TRACER_HPP
+#define LATENCY_TRACER_HPP
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+#include <tracer.hpp>
+#include <hdr_histogram.hpp>
+
+namespace snp
+{
+    // a tracer keeping a histogram per kind of sender of the nanoseconds from submit to complete and from complete to invoke,
+    // it belongs to one thread, the tracers of several threads are merged when they're read
+    class latency_tracer
+    {
+    public:
+        struct entry
+        {
+            std::string_view kind;
+
+            // submit to complete, the time in the kernel and in the queue of the context
+            hdr_histogram in_flight;
+
+            // complete to invoke, the time the operation took to call its receiver
+            hdr_histogram dispatch;
+
+            uint64_t failed = 0;
+        };
+
+        explicit latency_tracer(uint64_t highest = 10'000'000'000) : highest(highest)
+        {
+        }
+
+        void record(const trace_event& e)
+        {
+            auto& en = find(e.kind);
+
+            en.in_flight.record(nanoseconds(e.complete - e.submit));
+            en.dispatch.record(nanoseconds(e.invoke - e.complete));
+
+            en.failed += e.failed;
+        }
+
+        // both tracers must have been created with the same highest
+        void merge(const latency_tracer& other)
+        {
+            for (auto& o : other.entries_)
+            {
+                 auto& en = find(o.kind);
+
+                 en.in_flight.merge(o.in_flight);
+                 en.dispatch.merge(o.dispatch);
+
+                 en.failed += o.failed;
+            }
+        }
+
+        const std::vector<entry>& entries() const noexcept
+        {
+            return entries_;
+        }
+
+        void reset() noexcept
+        {
+            for (auto& en : entries_)
+            {
+                 en.in_flight.reset();
+                 en.dispatch.reset();
+
+                 en.failed = 0;
+            }
+        }
+
+        // {"senders": [{"kind": "async_read_some", "count": 1000, "failed": 0, "in_flight": {"min": ..., "p50": ...}, "dispatch": {...}}]}
+        void write_json(std::ostream& os) const
+        {
+            os << "{\"senders\": [";
+
+            for (bool first = true; auto& en : entries_)
+            {
+                 if (!en.in_flight.count())
+                     continue;
+
+                 os << (std::exchange(first, false) ? "" : ", ") << "{\"kind\": \"" << en.kind << "\", \"count\": " << en.in_flight.count() << ", \"failed\": " << en.failed;
+
+                 os << ", \"in_flight\": ";
+                 write_json(os, en.in_flight);
+
+                 os << ", \"dispatch\": ";
+                 write_json(os, en.dispatch);
+
+                 os << "}";
+            }
+
+            os << "]}" << std::endl;
+        }
+
+        // a line per kind of sender with the percentiles of both histograms in microseconds
+        void write_table(std::ostream& os) const
+        {
+            os << std::left << std::setw(24) << "sender" << std::right << std::setw(10) << "count" << std::setw(8) << "failed";
+
+            for (auto h : {"in flight", "dispatch"})
+                 os << std::setw(36) << std::string(h) + " p50/p99/p99.9/max us";
+
+            os << std::endl;
+
+            for (auto& en : entries_)
+            {
+                 if (!en.in_flight.count())
+                     continue;
+
+                 os << std::left << std::setw(24) << en.kind << std::right << std::setw(10) << en.in_flight.count() << std::setw(8) << en.failed;
+
+                 for (auto h : {&en.in_flight, &en.dispatch})
+                 {
+                      std::ostringstream s;
+                      s << std::fixed << std::setprecision(1);
+
+                      s << h->value_at_percentile(50) / 1e3 << "/" << h->value_at_percentile(99) / 1e3 << "/";
+                      s << h->value_at_percentile(99.9) / 1e3 << "/" << h->max() / 1e3;
+
+                      os << std::setw(36) << s.str();
+                 }
+
+                 os << std::endl;
+            }
+        }
+
+    private:
+        static uint64_t nanoseconds(trace_clock::duration d) noexcept
+        {
+            auto n = std::chrono::duration_cast<std::chrono::nanoseconds>(d).count();
+
+            return n > 0 ? n : 0;
+        }
+
+        static void write_json(std::ostream& os, const hdr_histogram& h)
+        {
+            os << "{\"min\": " << h.min() << ", \"mean\": " << h.mean() << ", \"p50\": " << h.value_at_percentile(50) << ", \"p90\": " << h.value_at_percentile(90);
+            os << ", \"p99\": " << h.value_at_percentile(99) << ", \"p99.9\": " << h.value_at_percentile(99.9) << ", \"max\": " << h.max() << "}";
+        }
+
+        // the kinds are the names of the senders, there are a few dozens at most
+        entry& find(std::string_view kind)
+        {
+            for (auto& en : entries_)
+            {
+                 if (en.kind.data() == kind.data() || en.kind == kind)
+                     return en;
+            }
+
+            return entries_.emplace_back(kind, hdr_histogram(highest), hdr_histogram(highest));
+        }
+
+        uint64_t highest;
+        std::vector<entry> entries_;
+    };
+}
+
+#endif
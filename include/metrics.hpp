@@ -0,0 +1,508 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef METRICS_HPP
+#define METRICS_HPP
+
+#include <array>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <span>
+#include <vector>
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <algorithm>
+#include <filesystem>
+#include <string_view>
+#include <type_traits>
+
+namespace snp::metrics
+{
+#ifdef SNP_ENABLE_METRICS
+    inline constexpr bool enabled = true;
+#else
+    inline constexpr bool enabled = false;
+#endif
+
+    struct sender_info
+    {
+        std::string_view name;
+
+        // whether the value the sender completes with is the number of bytes it transferred
+        bool bytes;
+    };
+
+    // the senders counted, labeled by their kind, a kind that isn't listed is counted as other
+    inline constexpr std::array senders =
+    {
+        sender_info{"async_accept", false},
+        sender_info{"async_close", false},
+        sender_info{"async_connect", false},
+        sender_info{"async_connect_race", false},
+        sender_info{"async_handshake", false},
+        sender_info{"async_handshake_offload", false},
+        sender_info{"async_read", true},
+        sender_info{"async_read_frames", false},
+        sender_info{"async_read_request", false},
+        sender_info{"async_read_some", true},
+        sender_info{"async_read_some_at", true},
+        sender_info{"async_read_until", false},
+        sender_info{"async_receive_batch", false},
+        sender_info{"async_receive_from", true},
+        sender_info{"async_resolve", false},
+        sender_info{"async_send_batch", false},
+        sender_info{"async_send_to", true},
+        sender_info{"async_wait", false},
+        sender_info{"async_wait_until", false},
+        sender_info{"async_write", true},
+        sender_info{"async_write_response", true},
+        sender_info{"async_write_some", true},
+        sender_info{"async_write_some_at", true},
+        sender_info{"schedule", false},
+        sender_info{"schedule_after", false},
+        sender_info{"schedule_at", false},
+        sender_info{"other", false}
+    };
+
+    constexpr std::size_t sender_index(std::string_view kind) noexcept
+    {
+        for (std::size_t i = 0; i != senders.size() - 1; ++i)
+        {
+             if (senders[i].name == kind)
+                 return i;
+        }
+
+        return senders.size() - 1;
+    }
+
+    // the counters every sender has
+    enum sender_counter : std::size_t
+    {
+        started,
+        succeeded,
+        failed,
+        cancelled,
+        bytes,
+        sender_counters
+    };
+
+    // the counters and gauges of the contexts and the sessions, the gauges are incremented and decremented on any thread
+    enum metric : std::size_t
+    {
+        context_threads,
+        context_polls,
+        context_sleeps,
+        context_spin_ns,
+        context_sleep_ns,
+        http_sessions,
+        http_requests,
+        http_bytes_read,
+        http_bytes_written,
+        metrics_count
+    };
+
+    inline constexpr std::size_t slots = metrics_count + senders.size() * sender_counters;
+
+    constexpr std::size_t slot(std::size_t sender, sender_counter c) noexcept
+    {
+        return metrics_count + sender * sender_counters + c;
+    }
+
+    // the metrics of one thread, only that thread writes them, so an update is a plain load and store without a locked instruction,
+    // the readers sum the shards of all threads, the gauges wrap around and are read as signed
+    struct shard
+    {
+        std::array<std::atomic<uint64_t>, slots> values{};
+    };
+
+    class registry
+    {
+    public:
+        static registry& instance()
+        {
+            static registry r;
+
+            return r;
+        }
+
+        void attach(shard* s)
+        {
+            std::lock_guard lock(mutex);
+            shards.push_back(s);
+        }
+
+        // the values of a thread that exits are kept
+        void detach(shard* s)
+        {
+            std::lock_guard lock(mutex);
+
+            for (std::size_t i = 0; i != slots; ++i)
+                 retired[i] += s->values[i].load(std::memory_order_relaxed);
+
+            std::erase(shards, s);
+        }
+
+        std::array<uint64_t, slots> read() const
+        {
+            std::lock_guard lock(mutex);
+            auto values = retired;
+
+            for (auto s : shards)
+            {
+                 for (std::size_t i = 0; i != slots; ++i)
+                      values[i] += s->values[i].load(std::memory_order_relaxed);
+            }
+
+            return values;
+        }
+
+    private:
+        mutable std::mutex mutex;
+
+        std::vector<shard*> shards;
+        std::array<uint64_t, slots> retired{};
+    };
+
+    struct local_shard
+    {
+        local_shard()
+        {
+            registry::instance().attach(&s);
+        }
+
+        ~local_shard()
+        {
+            registry::instance().detach(&s);
+        }
+
+        shard s;
+    };
+
+    inline shard& local()
+    {
+        thread_local local_shard l;
+
+        return l.s;
+    }
+
+    inline void add(std::size_t i, uint64_t n = 1) noexcept
+    {
+        if constexpr(enabled)
+        {
+            auto& v = local().values[i];
+            v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+    }
+
+    inline void sub(std::size_t i, uint64_t n = 1) noexcept
+    {
+        add(i, -n);
+    }
+
+    // counts a gauge up for as long as it lives
+    struct scoped_gauge
+    {
+        explicit scoped_gauge(metric m) noexcept : m(m)
+        {
+            add(m);
+        }
+
+        ~scoped_gauge()
+        {
+            sub(m);
+        }
+
+        metric m;
+    };
+
+    // the bytes one stream read and wrote, the operations of a stream are sequential so they are plain loads and stores,
+    // any thread can read them
+    struct stream_stats
+    {
+        void on_read(uint64_t n) noexcept
+        {
+            if constexpr(enabled)
+                read.store(read.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        void on_write(uint64_t n) noexcept
+        {
+            if constexpr(enabled)
+                written.store(written.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint64_t> read = 0;
+        std::atomic<uint64_t> written = 0;
+    };
+
+    template <std::size_t Sender>
+    void on_start() noexcept
+    {
+        add(slot(Sender, started));
+    }
+
+    template <std::size_t Sender, typename... Values>
+    void on_complete(bool ok, bool stopped, const Values&... values) noexcept
+    {
+        if constexpr(enabled)
+        {
+            add(slot(Sender, ok ? succeeded : stopped ? cancelled : failed));
+
+            if constexpr(senders[Sender].bytes && sizeof...(Values) == 1 && (std::is_same_v<Values, std::size_t> && ...))
+                add(slot(Sender, bytes), values...);
+        }
+    }
+
+    struct sender_snapshot
+    {
+        std::string_view sender;
+
+        uint64_t started;
+        uint64_t succeeded;
+        uint64_t failed;
+        uint64_t cancelled;
+        uint64_t bytes;
+
+        int64_t in_flight() const noexcept
+        {
+            return started - succeeded - failed - cancelled;
+        }
+    };
+
+    struct stream_snapshot
+    {
+        std::string stream;
+
+        uint64_t read;
+        uint64_t written;
+    };
+
+    // the state of an io_uring instance of the process as the kernel reports it in /proc/self/fdinfo
+    struct ring_snapshot
+    {
+        int fd;
+
+        uint64_t sq_entries;
+        uint64_t sq_pending;
+
+        uint64_t cq_entries;
+        uint64_t cq_pending;
+
+        // completions the kernel couldn't post to a full completion queue and holds back
+        uint64_t cq_overflow;
+
+        double sq_utilization() const noexcept
+        {
+            return sq_entries ? double(sq_pending) / sq_entries : 0;
+        }
+
+        double cq_utilization() const noexcept
+        {
+            return cq_entries ? double(cq_pending) / cq_entries : 0;
+        }
+    };
+
+    struct snapshot
+    {
+        std::vector<sender_snapshot> senders;
+        std::vector<ring_snapshot> rings;
+
+        int64_t context_threads;
+        uint64_t context_polls;
+        uint64_t context_sleeps;
+        uint64_t context_spin_ns;
+        uint64_t context_sleep_ns;
+
+        int64_t http_sessions;
+        uint64_t http_requests;
+        uint64_t http_bytes_read;
+        uint64_t http_bytes_written;
+    };
+
+    // the io_uring instances are found by their file descriptors, the asio backend doesn't expose its ring
+    inline std::vector<ring_snapshot> io_uring_rings()
+    {
+        namespace fs = std::filesystem;
+
+        std::vector<ring_snapshot> rings;
+        std::error_code ec;
+
+        for (auto& entry : fs::directory_iterator("/proc/self/fd", ec))
+        {
+             if (fs::read_symlink(entry.path(), ec) != "anon_inode:[io_uring]")
+                 continue;
+
+             auto fd = entry.path().filename().string();
+             std::ifstream in("/proc/self/fdinfo/" + fd);
+
+             ring_snapshot r{std::stoi(fd), 0, 0, 0, 0, 0};
+             uint64_t sq_head = 0, sq_tail = 0, cq_head = 0, cq_tail = 0;
+
+             bool overflow = false;
+
+             for (std::string line; std::getline(in, line);)
+             {
+                  auto colon = line.find(':');
+                  auto key = std::string_view(line).substr(0, colon);
+
+                  auto value = [&]{ return std::stoull(line.substr(colon + 1), nullptr, 0); };
+
+                  if (key == "SqMask")
+                      r.sq_entries = value() + 1;
+                  else if (key == "SqHead")
+                      sq_head = value();
+                  else if (key == "SqTail")
+                      sq_tail = value();
+                  else if (key == "CqMask")
+                      r.cq_entries = value() + 1;
+                  else if (key == "CqHead")
+                      cq_head = value();
+                  else if (key == "CqTail")
+                      cq_tail = value();
+                  else if (key == "CqOverflowList")
+                      overflow = true;
+                  else if (overflow && line.starts_with("  user_data"))
+                      ++r.cq_overflow;
+                  else
+                      overflow = false;
+             }
+
+             // the heads and tails are 32 bit counters that wrap around
+             r.sq_pending = uint32_t(sq_tail - sq_head);
+             r.cq_pending = uint32_t(cq_tail - cq_head);
+
+             rings.push_back(r);
+        }
+
+        return rings;
+    }
+
+    inline snapshot collect()
+    {
+        auto v = registry::instance().read();
+        snapshot s{};
+
+        for (std::size_t i = 0; i != senders.size(); ++i)
+        {
+             auto at = [&](sender_counter c){ return v[slot(i, c)]; };
+
+             if (at(started) || at(succeeded))
+                 s.senders.push_back({senders[i].name, at(started), at(succeeded), at(failed), at(cancelled), at(bytes)});
+        }
+
+        s.rings = io_uring_rings();
+
+        s.context_threads = v[context_threads];
+        s.context_polls = v[context_polls];
+        s.context_sleeps = v[context_sleeps];
+        s.context_spin_ns = v[context_spin_ns];
+        s.context_sleep_ns = v[context_sleep_ns];
+
+        s.http_sessions = v[http_sessions];
+        s.http_requests = v[http_requests];
+        s.http_bytes_read = v[http_bytes_read];
+        s.http_bytes_written = v[http_bytes_written];
+
+        return s;
+    }
+
+    // the text exposition format of prometheus
+    inline void write_prometheus(std::ostream& os, const snapshot& s)
+    {
+        auto header = [&](std::string_view name, std::string_view type, std::string_view help)
+        {
+            os << "# HELP " << name << " " << help << "\n# TYPE " << name << " " << type << "\n";
+        };
+
+        auto per_sender = [&](std::string_view name, std::string_view type, std::string_view help, auto value)
+        {
+            header(name, type, help);
+
+            for (auto& e : s.senders)
+                 os << name << "{sender=\"" << e.sender << "\"} " << value(e) << "\n";
+        };
+
+        per_sender("snp_operations_started_total", "counter", "Operations started.", [](auto& e){ return e.started; });
+        header("snp_operations_completed_total", "counter", "Operations completed, by result.");
+
+        for (auto& e : s.senders)
+        {
+             os << "snp_operations_completed_total{sender=\"" << e.sender << "\",result=\"success\"} " << e.succeeded << "\n";
+             os << "snp_operations_completed_total{sender=\"" << e.sender << "\",result=\"error\"} " << e.failed << "\n";
+             os << "snp_operations_completed_total{sender=\"" << e.sender << "\",result=\"cancelled\"} " << e.cancelled << "\n";
+        }
+
+        per_sender("snp_operations_in_flight", "gauge", "Operations started and not completed yet.", [](auto& e){ return e.in_flight(); });
+        per_sender("snp_transferred_bytes_total", "counter", "Bytes read or written.", [](auto& e){ return e.bytes; });
+
+        header("snp_context_threads", "gauge", "Threads running a context.");
+        os << "snp_context_threads " << s.context_threads << "\n";
+
+        header("snp_context_busy_polls_total", "counter", "Handlers run by busy polling.");
+        os << "snp_context_busy_polls_total " << s.context_polls << "\n";
+
+        header("snp_context_busy_sleeps_total", "counter", "Blocking waits after the spin budget ran out.");
+        os << "snp_context_busy_sleeps_total " << s.context_sleeps << "\n";
+
+        header("snp_context_busy_seconds_total", "counter", "Seconds spent busy polling and sleeping.");
+        os << "snp_context_busy_seconds_total{state=\"spin\"} " << s.context_spin_ns / 1e9 << "\n";
+        os << "snp_context_busy_seconds_total{state=\"sleep\"} " << s.context_sleep_ns / 1e9 << "\n";
+
+        header("snp_http_sessions", "gauge", "Open http server sessions.");
+        os << "snp_http_sessions " << s.http_sessions << "\n";
+
+        header("snp_http_requests_total", "counter", "Requests served by the http servers.");
+        os << "snp_http_requests_total " << s.http_requests << "\n";
+
+        header("snp_http_transferred_bytes_total", "counter", "Bytes read and written by the http server sessions.");
+        os << "snp_http_transferred_bytes_total{direction=\"read\"} " << s.http_bytes_read << "\n";
+        os << "snp_http_transferred_bytes_total{direction=\"written\"} " << s.http_bytes_written << "\n";
+
+        if (s.rings.empty())
+            return;
+
+        auto per_ring = [&](std::string_view name, std::string_view type, std::string_view help, auto value)
+        {
+            header(name, type, help);
+
+            for (auto& r : s.rings)
+                 os << name << "{fd=\"" << r.fd << "\"} " << value(r) << "\n";
+        };
+
+        per_ring("snp_io_uring_sq_entries", "gauge", "Submission queue size.", [](auto& r){ return r.sq_entries; });
+        per_ring("snp_io_uring_sq_pending", "gauge", "Submissions not consumed by the kernel yet.", [](auto& r){ return r.sq_pending; });
+        per_ring("snp_io_uring_sq_utilization", "gauge", "Fraction of the submission queue in use.", [](auto& r){ return r.sq_utilization(); });
+        per_ring("snp_io_uring_cq_entries", "gauge", "Completion queue size.", [](auto& r){ return r.cq_entries; });
+        per_ring("snp_io_uring_cq_pending", "gauge", "Completions not reaped yet.", [](auto& r){ return r.cq_pending; });
+        per_ring("snp_io_uring_cq_utilization", "gauge", "Fraction of the completion queue in use.", [](auto& r){ return r.cq_utilization(); });
+        per_ring("snp_io_uring_cq_overflow", "gauge", "Completions held back by the kernel because the completion queue was full.", [](auto& r){ return r.cq_overflow; });
+    }
+
+    inline void write_prometheus(std::ostream& os)
+    {
+        write_prometheus(os, collect());
+    }
+
+    // the bytes per stream, such as the sessions of snp::http::server::sessions(), a series per stream
+    inline void write_prometheus(std::ostream& os, std::span<const stream_snapshot> streams)
+    {
+        os << "# HELP snp_stream_transferred_bytes_total Bytes read and written by a stream.\n";
+        os << "# TYPE snp_stream_transferred_bytes_total counter\n";
+
+        for (auto& e : streams)
+        {
+             os << "snp_stream_transferred_bytes_total{stream=\"" << e.stream << "\",direction=\"read\"} " << e.read << "\n";
+             os << "snp_stream_transferred_bytes_total{stream=\"" << e.stream << "\",direction=\"written\"} " << e.written << "\n";
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,560 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef PLACEMENT_HPP
+#define PLACEMENT_HPP
+
+#include <new>
+#include <bit>
+#include <mutex>
+#include <memory>
+#include <string>
+#include <vector>
+#include <climits>
+#include <utility>
+#include <fstream>
+#include <ostream>
+#include <sstream>
+#include <algorithm>
+#include <filesystem>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <boost/system/error_code.hpp>
+#include <boost/system/system_error.hpp>
+
+namespace snp::asio
+{
+    inline constexpr int mpol_preferred = 1;
+    inline constexpr int mpol_bind = 2;
+
+    using error_code_t = boost::system::error_code;
+
+    // the nodemask of set_mempolicy and mbind with the bit of node set, it spans as many words as node needs
+    struct nodemask
+    {
+        static constexpr std::size_t bits = sizeof(unsigned long) * CHAR_BIT;
+
+        explicit nodemask(int node) : words(node / bits + 1)
+        {
+            words[node / bits] = 1ul << node % bits;
+        }
+
+        // the kernel reads one bit less than maxnode
+        unsigned long maxnode() const noexcept
+        {
+            return words.size() * bits + 1;
+        }
+
+        std::vector<unsigned long> words;
+    };
+
+    inline error_code_t last_error() noexcept
+    {
+        return error_code_t(errno, boost::system::system_category());
+    }
+
+    // the numa node the memory policy of the calling thread prefers once placement::pin set it, -1 otherwise
+    inline int& current_node() noexcept
+    {
+        thread_local int node = -1;
+
+        return node;
+    }
+
+    // maps size bytes, bound to node unless it's -1, a failed bind is thrown rather than left to the first touch
+    inline void* map_node(std::size_t size, int node)
+    {
+        auto p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+        if (p == MAP_FAILED)
+            throw std::bad_alloc();
+
+        if (node >= 0)
+        {
+            nodemask m(node);
+
+            if (syscall(SYS_mbind, p, size, mpol_bind, m.words.data(), m.maxnode(), 0))
+            {
+                auto ec = last_error();
+                munmap(p, size);
+
+                throw boost::system::system_error(ec, "mbind");
+            }
+        }
+
+        return p;
+    }
+
+    inline std::vector<int> parse_cpulist(const std::string& list)
+    {
+        std::vector<int> cpus;
+        std::stringstream ss(list);
+
+        for (std::string range; std::getline(ss, range, ',');)
+        {
+            if (range.empty() || range == "\n")
+                continue;
+
+            auto pos = range.find('-');
+            int first = std::stoi(range.substr(0, pos));
+            int last = pos == std::string::npos ? first : std::stoi(range.substr(pos + 1));
+
+            for (int cpu = first; cpu <= last; ++cpu)
+                 cpus.push_back(cpu);
+        }
+
+        return cpus;
+    }
+
+    inline std::vector<int> read_cpulist(const std::filesystem::path& path)
+    {
+        std::string list;
+        std::ifstream file(path);
+
+        std::getline(file, list);
+
+        return parse_cpulist(list);
+    }
+
+    struct topology
+    {
+        topology()
+        {
+            std::filesystem::path root = "/sys/devices/system";
+
+            for (int node = 0; std::filesystem::exists(root / "node" / ("node" + std::to_string(node))); ++node)
+                 nodes.push_back(read_cpulist(root / "node" / ("node" + std::to_string(node)) / "cpulist"));
+
+            if (nodes.empty())
+                nodes.push_back(read_cpulist(root / "cpu" / "online"));
+
+            if (nodes.front().empty())
+                for (long cpu = 0, n = sysconf(_SC_NPROCESSORS_ONLN); cpu < n; ++cpu)
+                     nodes.front().push_back(cpu);
+
+            isolated = read_cpulist(root / "cpu" / "isolated");
+        }
+
+        int node_of(int cpu) const noexcept
+        {
+            for (std::size_t node = 0; node != nodes.size(); ++node)
+                 for (auto c : nodes[node])
+                      if (c == cpu)
+                          return node;
+
+            return -1;
+        }
+
+        std::vector<int> cpus() const
+        {
+            std::vector<int> cpus;
+
+            for (auto& node : nodes)
+                 cpus.insert(cpus.end(), node.begin(), node.end());
+
+            return cpus;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const topology& t)
+        {
+            os << "topology: " << t.nodes.size() << " numa node(s)";
+
+            for (std::size_t node = 0; node != t.nodes.size(); ++node)
+            {
+                 os << "\n  node " << node << ":";
+
+                 for (auto cpu : t.nodes[node])
+                      os << " " << cpu;
+            }
+
+            os << "\n  isolated:";
+
+            if (t.isolated.empty())
+                os << " none";
+
+            for (auto cpu : t.isolated)
+                 os << " " << cpu;
+
+            return os;
+        }
+
+        std::vector<std::vector<int>> nodes;
+        std::vector<int> isolated;
+    };
+
+    struct placement
+    {
+        explicit placement(std::size_t threads = 1) : cpus(threads)
+        {
+        }
+
+        explicit placement(std::vector<std::vector<int>> cpus) : cpus(std::move(cpus))
+        {
+        }
+
+        static placement compact(const topology& t, std::size_t threads)
+        {
+            return pick(t, t.cpus(), threads);
+        }
+
+        static placement spread(const topology& t, std::size_t threads)
+        {
+            std::vector<int> cpus;
+
+            for (std::size_t i = 0, found = 1; found; ++i)
+            {
+                 found = 0;
+
+                 for (auto& node : t.nodes)
+                      if (i < node.size())
+                          cpus.push_back(node[i]), found = 1;
+            }
+
+            return pick(t, cpus, threads);
+        }
+
+        static placement node(const topology& t, int node, std::size_t threads)
+        {
+            return pick(t, t.nodes.at(node), threads);
+        }
+
+        // falls back to compact when no core is isolated, fallback tells the caller so
+        static placement isolated(const topology& t, std::size_t threads)
+        {
+            if (t.isolated.empty())
+            {
+                auto p = compact(t, threads);
+                p.fallback = true;
+
+                return p;
+            }
+
+            auto p = pick(t, t.isolated, threads);
+            p.isolate = true;
+
+            return p;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return cpus.size();
+        }
+
+        // pins the calling thread to the cpus of index and prefers the memory of their node,
+        // returns the error of the affinity or else of the memory policy, the memory policy is still set if the affinity failed
+        error_code_t pin(std::size_t index) const
+        {
+            current_node() = -1;
+
+            auto& set = cpus.at(index);
+
+            if (set.empty())
+                return {};
+
+            error_code_t ec;
+
+            auto n = *std::max_element(set.begin(), set.end()) + 1;
+            auto size = CPU_ALLOC_SIZE(n);
+
+            std::unique_ptr<cpu_set_t, void(*)(cpu_set_t*)> mask(CPU_ALLOC(n), [](cpu_set_t* p){ CPU_FREE(p); });
+            CPU_ZERO_S(size, mask.get());
+
+            for (auto cpu : set)
+                 CPU_SET_S(cpu, size, mask.get());
+
+            if (auto r = pthread_setaffinity_np(pthread_self(), size, mask.get()))
+                ec.assign(r, boost::system::system_category());
+
+            if (auto node = nodes.at(index); node >= 0)
+            {
+                nodemask m(node);
+
+                if (!syscall(SYS_set_mempolicy, mpol_preferred, m.words.data(), m.maxnode()))
+                    current_node() = node;
+                else if (!ec)
+                    ec = last_error();
+            }
+
+            return ec;
+        }
+
+        friend std::ostream& operator<<(std::ostream& os, const placement& p)
+        {
+            os << "placement: " << p.size() << " thread(s)" << (p.isolate ? " on isolated cores" : "") << (p.fallback ? ", no core is isolated" : "");
+
+            for (std::size_t i = 0; i != p.size(); ++i)
+            {
+                 os << "\n  thread " << i << ":";
+
+                 if (p.cpus[i].empty())
+                     os << " unpinned";
+
+                 for (auto cpu : p.cpus[i])
+                      os << " " << cpu;
+
+                 if (p.nodes.size() > i && p.nodes[i] >= 0)
+                     os << " (node " << p.nodes[i] << ")";
+            }
+
+            return os;
+        }
+
+        std::vector<std::vector<int>> cpus;
+        std::vector<int> nodes = std::vector<int>(cpus.size(), -1);
+
+        bool isolate = false;
+        bool fallback = false;
+
+    private:
+        static placement pick(const topology& t, const std::vector<int>& cpus, std::size_t threads)
+        {
+            placement p(threads);
+
+            for (std::size_t i = 0; i != threads && !cpus.empty(); ++i)
+            {
+                 auto cpu = cpus[i % cpus.size()];
+
+                 p.cpus[i].push_back(cpu);
+                 p.nodes[i] = t.node_of(cpu);
+            }
+
+            return p;
+        }
+    };
+
+    // the small blocks of a numa node, carved out of chunks bound to it, a block of class c has min_block << c bytes,
+    // each thread keeps the blocks it frees for reuse and gives them back to the arena when it exits, the chunks are never unmapped
+    class node_arena
+    {
+    public:
+        static constexpr std::size_t min_block = 16;
+        static constexpr std::size_t classes = 13;
+        static constexpr std::size_t max_block = min_block << (classes - 1);
+
+        static constexpr std::size_t chunk_size = 2 << 20;
+        static constexpr std::size_t max_align = 64;
+
+        explicit node_arena(int node) noexcept : node(node)
+        {
+        }
+
+        static constexpr std::size_t class_of(std::size_t size) noexcept
+        {
+            return size <= min_block ? 0 : std::bit_width(size - 1) - std::bit_width(min_block - 1);
+        }
+
+        static void* allocate(std::size_t size, int node)
+        {
+            auto c = class_of(size);
+
+            if (auto t = local(node, true); t && t->free[c])
+                return std::exchange(t->free[c], t->free[c]->next);
+
+            return of(node).take(c);
+        }
+
+        static void deallocate(void* p, std::size_t size, int node) noexcept
+        {
+            auto c = class_of(size);
+            auto b = static_cast<block*>(p);
+
+            if (auto t = local(node, false))
+                b->next = std::exchange(t->free[c], b);
+            else
+                of(node).give(c, b, b);
+        }
+
+    private:
+        struct block
+        {
+            block* next;
+        };
+
+        struct cache
+        {
+            block* free[classes] = {};
+        };
+
+        struct caches
+        {
+            ~caches()
+            {
+                exited() = true;
+
+                for (std::size_t i = 0; i != nodes.size(); ++i)
+                {
+                     for (std::size_t c = 0; c != classes; ++c)
+                     {
+                          if (auto first = nodes[i].free[c])
+                          {
+                              auto last = first;
+
+                              while (last->next)
+                                  last = last->next;
+
+                              of(static_cast<int>(i) - 1).give(c, first, last);
+                          }
+                     }
+                }
+            }
+
+            std::vector<cache> nodes;
+        };
+
+        // set once the caches of the thread are gone, the thread_locals destroyed after them free into the arenas
+        static bool& exited() noexcept
+        {
+            thread_local bool b = false;
+
+            return b;
+        }
+
+        // the blocks freed on a thread that never allocated from node go straight to the arena, so that a free doesn't allocate
+        static cache* local(int node, bool grow)
+        {
+            if (exited())
+                return nullptr;
+
+            thread_local caches t;
+            std::size_t i = node + 1;
+
+            if (i >= t.nodes.size())
+            {
+                if (!grow)
+                    return nullptr;
+
+                t.nodes.resize(i + 1);
+            }
+
+            return &t.nodes[i];
+        }
+
+        // the arenas outlive the statics whose buffers are freed into them on exit
+        static node_arena& of(int node)
+        {
+            static std::mutex m;
+            static auto& arenas = *new std::vector<std::unique_ptr<node_arena>>;
+
+            std::lock_guard lock(m);
+            std::size_t i = node + 1;
+
+            if (i >= arenas.size())
+                arenas.resize(i + 1);
+
+            if (!arenas[i])
+                arenas[i] = std::make_unique<node_arena>(node);
+
+            return *arenas[i];
+        }
+
+        void* take(std::size_t c)
+        {
+            std::lock_guard lock(m);
+
+            if (free[c])
+                return std::exchange(free[c], free[c]->next);
+
+            auto size = min_block << c;
+            auto align = std::min(size, max_align);
+
+            auto offset = (used + align - 1) / align * align;
+
+            if (!chunk || offset + size > chunk_size)
+            {
+                chunk = static_cast<char*>(map_node(chunk_size, node));
+                offset = 0;
+            }
+
+            used = offset + size;
+
+            return chunk + offset;
+        }
+
+        void give(std::size_t c, block* first, block* last) noexcept
+        {
+            std::lock_guard lock(m);
+
+            last->next = free[c];
+            free[c] = first;
+        }
+
+        int node;
+
+        std::mutex m;
+        block* free[classes] = {};
+
+        char* chunk = nullptr;
+        std::size_t used = 0;
+    };
+
+    // allocates from the node_arena of node, or maps whole pages bound to node for the allocations beyond its largest block,
+    // -1 allocates without binding. an mbind the kernel refuses throws a system_error
+    template <typename T>
+    struct node_allocator
+    {
+        using value_type = T;
+
+        static_assert(alignof(T) <= node_arena::max_align);
+
+        explicit node_allocator(int node = -1) noexcept : node(node)
+        {
+        }
+
+        template <typename U>
+        node_allocator(const node_allocator<U>& other) noexcept : node(other.node)
+        {
+        }
+
+        static std::size_t round(std::size_t n) noexcept
+        {
+            auto page = static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+
+            return (n * sizeof(T) + page - 1) / page * page;
+        }
+
+        T* allocate(std::size_t n)
+        {
+            if (n * sizeof(T) <= node_arena::max_block)
+                return static_cast<T*>(node_arena::allocate(n * sizeof(T), node));
+
+            return static_cast<T*>(map_node(round(n), node));
+        }
+
+        void deallocate(T* p, std::size_t n) noexcept
+        {
+            if (n * sizeof(T) <= node_arena::max_block)
+                node_arena::deallocate(p, n * sizeof(T), node);
+            else
+                munmap(p, round(n));
+        }
+
+        template <typename U>
+        friend bool operator==(const node_allocator& l, const node_allocator<U>& r) noexcept
+        {
+            return l.node == r.node;
+        }
+
+        int node;
+    };
+}
+
+namespace snp
+{
+    using topology = snp::asio::topology;
+    using placement = snp::asio::placement;
+
+    template <typename T>
+    using node_allocator = snp::asio::node_allocator<T>;
+
+    using snp::asio::current_node;
+}
+
+#endif
@@ -0,0 +1,279 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef RESOLVER_CACHE_HPP
+#define RESOLVER_CACHE_HPP
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <charconv>
+#include <optional>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <async_resolve.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    struct resolver_stats
+    {
+        uint64_t hits;
+        uint64_t negative_hits;
+
+        uint64_t misses;
+        uint64_t coalesced;
+
+        uint64_t numeric;
+    };
+
+    struct resolver_cache
+    {
+        using tcp = net::ip::tcp;
+
+        using clock = std::chrono::steady_clock;
+        using duration = clock::duration;
+
+        using error_code_t = boost::system::error_code;
+        using results_type = tcp::resolver::results_type;
+
+        using key_t = std::pair<std::string, std::string>;
+
+        struct entry
+        {
+            bool pending = true;
+            clock::time_point expiry;
+
+            error_code_t ec;
+            results_type results;
+
+            std::vector<resolve_waiter*> waiters;
+        };
+
+        resolver_cache(net::io_context& ioc, duration ttl = std::chrono::seconds(60), duration negative_ttl = std::chrono::seconds(5), std::size_t capacity = 1024) :
+        resolver(ioc), ttl(ttl), negative_ttl(negative_ttl), capacity(capacity)
+        {
+        }
+
+        static bool numeric(const std::string& host, const std::string& service, results_type& results)
+        {
+            error_code_t ec;
+            auto address = net::ip::make_address(host, ec);
+
+            if (ec)
+                return false;
+
+            unsigned short port = 0;
+            auto last = service.data() + service.size();
+
+            if (service.empty())
+                return false;
+
+            if (auto [p, e] = std::from_chars(service.data(), last, port); e != std::errc() || p != last)
+                return false;
+
+            results = results_type::create(tcp::endpoint(address, port), host, service);
+
+            return true;
+        }
+
+        // returns true and fills ec and results if the lookup was answered without waiting,
+        // otherwise w is completed later, unless it is cancelled first
+        bool lookup(const std::string& host, const std::string& service, resolve_waiter* w, error_code_t& ec, results_type& results)
+        {
+            if (numeric(host, service, results))
+            {
+                numerics.fetch_add(1, std::memory_order_relaxed);
+
+                return true;
+            }
+
+            std::lock_guard lock(m);
+
+            auto now = clock::now();
+            auto [it, inserted] = entries.try_emplace({host, service});
+
+            auto& e = it->second;
+
+            if (!inserted && !e.pending && e.expiry <= now)
+            {
+                e = entry{};
+                inserted = true;
+            }
+
+            if (!e.pending)
+            {
+                (e.ec ? negative_hits : hits).fetch_add(1, std::memory_order_relaxed);
+
+                ec = e.ec;
+                results = e.results;
+
+                return true;
+            }
+
+            e.waiters.push_back(w);
+
+            if (!inserted)
+            {
+                coalesced.fetch_add(1, std::memory_order_relaxed);
+
+                return false;
+            }
+
+            misses.fetch_add(1, std::memory_order_relaxed);
+
+            evict(now);
+
+            resolver.async_resolve(host, service, [this, key = it->first](error_code_t ec, results_type results)
+            {
+                on_resolve(key, ec, std::move(results));
+            });
+
+            return false;
+        }
+
+        bool cancel(const std::string& host, const std::string& service, resolve_waiter* w)
+        {
+            std::lock_guard lock(m);
+
+            auto it = entries.find({host, service});
+
+            if (it == entries.end())
+                return false;
+
+            auto& waiters = it->second.waiters;
+            auto pos = std::find(waiters.begin(), waiters.end(), w);
+
+            if (pos == waiters.end())
+                return false;
+
+            waiters.erase(pos);
+
+            return true;
+        }
+
+        void insert(const std::string& host, const std::string& service, const results_type& results, duration ttl)
+        {
+            std::vector<resolve_waiter*> waiters;
+
+            {
+                std::lock_guard lock(m);
+
+                auto& e = entries[{host, service}];
+
+                waiters.swap(e.waiters);
+                e = entry{false, clock::now() + ttl, {}, results};
+            }
+
+            for (auto w : waiters)
+                 w->complete({}, results);
+        }
+
+        void erase(const std::string& host, const std::string& service)
+        {
+            std::lock_guard lock(m);
+
+            if (auto it = entries.find({host, service}); it != entries.end() && !it->second.pending)
+                entries.erase(it);
+        }
+
+        void clear()
+        {
+            std::lock_guard lock(m);
+
+            std::erase_if(entries, [](auto& p){ return !p.second.pending; });
+        }
+
+        decltype(auto) get_executor() noexcept
+        {
+            return resolver.get_executor();
+        }
+
+        resolver_stats stats() const noexcept
+        {
+            return {hits.load(), negative_hits.load(), misses.load(), coalesced.load(), numerics.load()};
+        }
+
+        std::size_t size()
+        {
+            std::lock_guard lock(m);
+
+            return entries.size();
+        }
+
+        void on_resolve(const key_t& key, error_code_t ec, results_type results)
+        {
+            std::vector<resolve_waiter*> waiters;
+
+            {
+                std::lock_guard lock(m);
+
+                auto it = entries.find(key);
+
+                if (it == entries.end() || !it->second.pending)
+                    return;
+
+                auto& e = it->second;
+                waiters.swap(e.waiters);
+
+                if (ec == net::error::operation_aborted)
+                    entries.erase(it);
+                else
+                {
+                    e.pending = false;
+                    e.expiry = clock::now() + (ec ? negative_ttl : ttl);
+
+                    e.ec = ec;
+                    e.results = results;
+                }
+            }
+
+            for (auto w : waiters)
+                 w->complete(ec, results);
+        }
+
+        void evict(clock::time_point now)
+        {
+            if (entries.size() <= capacity)
+                return;
+
+            std::erase_if(entries, [now](auto& p){ return !p.second.pending && p.second.expiry <= now; });
+
+            for (auto it = entries.begin(); it != entries.end() && entries.size() > capacity;)
+            {
+                 if (it->second.pending)
+                     ++it;
+                 else
+                     it = entries.erase(it);
+            }
+        }
+
+        std::mutex m;
+        tcp::resolver resolver;
+
+        duration ttl;
+        duration negative_ttl;
+
+        std::size_t capacity;
+        std::map<key_t, entry> entries;
+
+        std::atomic<uint64_t> hits = 0;
+        std::atomic<uint64_t> negative_hits = 0;
+
+        std::atomic<uint64_t> misses = 0;
+        std::atomic<uint64_t> coalesced = 0;
+
+        std::atomic<uint64_t> numerics = 0;
+    };
+}
+
+#endif
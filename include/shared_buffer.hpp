@@ -0,0 +1,112 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef SHARED_BUFFER_HPP
+#define SHARED_BUFFER_HPP
+
+#include <new>
+#include <atomic>
+#include <cstring>
+#include <utility>
+#include <string_view>
+#include <boost/asio/buffer.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // an immutable byte buffer with an intrusive reference count, the count and the bytes share a single allocation,
+    // and a copy costs an increment, the bytes are filled through data() before the buffer is handed out
+    class shared_buffer
+    {
+    public:
+        shared_buffer() = default;
+
+        explicit shared_buffer(std::size_t size) : block(new (::operator new(sizeof(header) + size)) header{{1}, size})
+        {
+        }
+
+        explicit shared_buffer(std::string_view data) : shared_buffer(data.size())
+        {
+            std::memcpy(this->data(), data.data(), data.size());
+        }
+
+        shared_buffer(const shared_buffer& other) noexcept : block(other.block)
+        {
+            if (block)
+                block->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        shared_buffer(shared_buffer&& other) noexcept : block(std::exchange(other.block, nullptr))
+        {
+        }
+
+        shared_buffer& operator=(shared_buffer other) noexcept
+        {
+            std::swap(block, other.block);
+
+            return *this;
+        }
+
+        ~shared_buffer()
+        {
+            if (block && block->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            {
+                block->~header();
+                ::operator delete(block);
+            }
+        }
+
+        char* data() noexcept
+        {
+            return block ? reinterpret_cast<char*>(block + 1) : nullptr;
+        }
+
+        const char* data() const noexcept
+        {
+            return block ? reinterpret_cast<const char*>(block + 1) : nullptr;
+        }
+
+        std::size_t size() const noexcept
+        {
+            return block ? block->size : 0;
+        }
+
+        std::string_view view() const noexcept
+        {
+            return {data(), size()};
+        }
+
+        net::const_buffer buffer() const noexcept
+        {
+            return net::buffer(data(), size());
+        }
+
+        std::size_t use_count() const noexcept
+        {
+            return block ? block->refs.load(std::memory_order_relaxed) : 0;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return block;
+        }
+
+    private:
+        struct alignas(std::max_align_t) header
+        {
+            std::atomic<std::size_t> refs;
+            std::size_t size;
+        };
+
+        header* block = nullptr;
+    };
+}
+
+#endif
@@ -0,0 +1,200 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if !defined(SNP_DISABLE_SIMD) && (defined(__x86_64__) || defined(__i386__))
+#define SNP_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace snp::simd
+{
+    inline constexpr std::size_t npos = std::string_view::npos;
+
+    // compares the first and the last byte of the needle at every position of a block at once,
+    // and only verifies the bytes in between for the positions where both match
+
+    inline bool verify(const char* data, std::string_view needle) noexcept
+    {
+        return needle.size() < 3 || !std::memcmp(data + 1, needle.data() + 1, needle.size() - 2);
+    }
+
+    inline std::size_t find_scalar(const char* data, std::size_t size, std::string_view needle, std::size_t i = 0) noexcept
+    {
+        auto k = needle.size();
+
+        for (; i + k <= size; ++i)
+             if (data[i] == needle.front() && data[i + k - 1] == needle.back() && verify(data + i, needle))
+                 return i;
+
+        return npos;
+    }
+
+    // the websocket masking key as a 32 bit word, rotated so that its first byte applies at byte offset of the payload
+    inline uint32_t mask_key(const char* key, std::size_t offset) noexcept
+    {
+        char rotated[4];
+        uint32_t word;
+
+        for (std::size_t j = 0; j != 4; ++j)
+             rotated[j] = key[(offset + j) & 3];
+
+        std::memcpy(&word, rotated, 4);
+
+        return word;
+    }
+
+    // i must be a multiple of 4, so that the key stays in phase
+    inline void mask_scalar(char* dst, const char* src, std::size_t size, uint32_t key, std::size_t i = 0) noexcept
+    {
+        uint64_t wide = static_cast<uint64_t>(key) << 32 | key;
+
+        for (; i + 8 <= size; i += 8)
+        {
+             uint64_t word;
+
+             std::memcpy(&word, src + i, 8);
+             word ^= wide;
+             std::memcpy(dst + i, &word, 8);
+        }
+
+        char bytes[4];
+        std::memcpy(bytes, &key, 4);
+
+        for (; i != size; ++i)
+             dst[i] = src[i] ^ bytes[i & 3];
+    }
+
+#ifdef SNP_SIMD_X86
+    inline std::size_t find_sse2(const char* data, std::size_t size, std::string_view needle) noexcept
+    {
+        auto k = needle.size();
+        std::size_t i = 0;
+
+        auto first = _mm_set1_epi8(needle.front());
+        auto last = _mm_set1_epi8(needle.back());
+
+        for (; i + k - 1 + 16 <= size; i += 16)
+        {
+             auto f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+             auto l = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + k - 1));
+
+             auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(f, first), _mm_cmpeq_epi8(l, last))));
+
+             for (; mask; mask &= mask - 1)
+             {
+                  auto pos = i + __builtin_ctz(mask);
+
+                  if (verify(data + pos, needle))
+                      return pos;
+             }
+        }
+
+        return find_scalar(data, size, needle, i);
+    }
+
+    __attribute__((target("avx2")))
+    inline std::size_t find_avx2(const char* data, std::size_t size, std::string_view needle) noexcept
+    {
+        auto k = needle.size();
+        std::size_t i = 0;
+
+        auto first = _mm256_set1_epi8(needle.front());
+        auto last = _mm256_set1_epi8(needle.back());
+
+        for (; i + k - 1 + 32 <= size; i += 32)
+        {
+             auto f = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+             auto l = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + k - 1));
+
+             auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(f, first), _mm256_cmpeq_epi8(l, last))));
+
+             for (; mask; mask &= mask - 1)
+             {
+                  auto pos = i + __builtin_ctz(mask);
+
+                  if (verify(data + pos, needle))
+                      return pos;
+             }
+        }
+
+        return find_scalar(data, size, needle, i);
+    }
+
+    inline void mask_sse2(char* dst, const char* src, std::size_t size, uint32_t key) noexcept
+    {
+        std::size_t i = 0;
+        auto k = _mm_set1_epi32(static_cast<int>(key));
+
+        for (; i + 16 <= size; i += 16)
+             _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i)), k));
+
+        mask_scalar(dst, src, size, key, i);
+    }
+
+    __attribute__((target("avx2")))
+    inline void mask_avx2(char* dst, const char* src, std::size_t size, uint32_t key) noexcept
+    {
+        std::size_t i = 0;
+        auto k = _mm256_set1_epi32(static_cast<int>(key));
+
+        for (; i + 32 <= size; i += 32)
+             _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)), k));
+
+        mask_scalar(dst, src, size, key, i);
+    }
+
+    inline bool has_avx2() noexcept
+    {
+        static const bool avx2 = __builtin_cpu_supports("avx2");
+
+        return avx2;
+    }
+#endif
+
+    // returns the offset of the first occurrence of needle in [data, data + size), or npos
+    inline std::size_t find(const char* data, std::size_t size, std::string_view needle) noexcept
+    {
+        if (needle.empty())
+            return 0;
+
+#ifdef SNP_SIMD_X86
+        if (has_avx2())
+            return find_avx2(data, size, needle);
+
+        return find_sse2(data, size, needle);
+#else
+        return find_scalar(data, size, needle);
+#endif
+    }
+
+    // xors size bytes of src with the 4 byte websocket masking key into dst, which may be src itself,
+    // offset is the position of src in the payload, so that a payload can be masked in pieces
+    inline void mask(char* dst, const char* src, std::size_t size, const char* key, std::size_t offset = 0) noexcept
+    {
+        auto word = mask_key(key, offset);
+
+#ifdef SNP_SIMD_X86
+        if (has_avx2())
+            return mask_avx2(dst, src, size, word);
+
+        mask_sse2(dst, src, size, word);
+#else
+        mask_scalar(dst, src, size, word);
+#endif
+    }
+}
+
+#endif
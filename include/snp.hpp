@@ -14,16 +14,47 @@
 #include <async_accept.hpp>
 #include <async_close.hpp>
 #include <async_connect.hpp>
+#include <async_connect_race.hpp>
 #include <async_handshake.hpp>
 #include <async_read.hpp>
+#include <async_read_frames.hpp>
+#include <async_read_request.hpp>
 #include <async_read_some.hpp>
 #include <async_read_some_at.hpp>
+#include <async_read_until.hpp>
+#include <async_receive_batch.hpp>
+#include <async_receive_from.hpp>
 #include <async_resolve.hpp>
+#include <async_send_batch.hpp>
+#include <async_send_to.hpp>
 #include <async_wait.hpp>
 #include <async_wait_until.hpp>
 #include <async_write.hpp>
+#include <async_write_response.hpp>
 #include <async_write_some.hpp>
 #include <async_write_some_at.hpp>
+#include <broadcast_channel.hpp>
+#include <buffer_pool.hpp>
+#include <buffered_stream.hpp>
+#include <chrome_trace.hpp>
+#include <connection_pool.hpp>
+#include <datagram_batch.hpp>
+#include <dns_resolver.hpp>
+#include <framed_reader.hpp>
+#include <hdr_histogram.hpp>
+#include <hedge.hpp>
+#include <http_parser.hpp>
+#include <http_server.hpp>
+#include <latency_tracer.hpp>
+#include <metrics.hpp>
+#include <placement.hpp>
+#include <resolver_cache.hpp>
+#include <shared_buffer.hpp>
+#include <simd.hpp>
+#include <socket_option.hpp>
 #include <start_detached.hpp>
+#include <tracer.hpp>
+#include <websocket_frame.hpp>
+#include <websocket_stream.hpp>
 
 #endif
@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef SOCKET_OPTION_HPP
+#define SOCKET_OPTION_HPP
+
+#include <cstddef>
+#include <sys/socket.h>
+#include <netinet/udp.h>
+
+namespace snp
+{
+    template <int Level, int Name>
+    struct integer_option
+    {
+        explicit integer_option(int value = 0) : value_(value)
+        {
+        }
+
+        int value() const noexcept
+        {
+            return value_;
+        }
+
+        template <typename Protocol>
+        int level(const Protocol&) const noexcept
+        {
+            return Level;
+        }
+
+        template <typename Protocol>
+        int name(const Protocol&) const noexcept
+        {
+            return Name;
+        }
+
+        template <typename Protocol>
+        int* data(const Protocol&) noexcept
+        {
+            return &value_;
+        }
+
+        template <typename Protocol>
+        const int* data(const Protocol&) const noexcept
+        {
+            return &value_;
+        }
+
+        template <typename Protocol>
+        std::size_t size(const Protocol&) const noexcept
+        {
+            return sizeof(value_);
+        }
+
+        template <typename Protocol>
+        void resize(const Protocol&, std::size_t) noexcept
+        {
+        }
+
+        int value_;
+    };
+
+#ifdef SO_BUSY_POLL
+    using busy_poll = integer_option<SOL_SOCKET, SO_BUSY_POLL>;
+#endif
+
+#ifdef SO_PREFER_BUSY_POLL
+    using prefer_busy_poll = integer_option<SOL_SOCKET, SO_PREFER_BUSY_POLL>;
+#endif
+
+#ifdef SO_BUSY_POLL_BUDGET
+    using busy_poll_budget = integer_option<SOL_SOCKET, SO_BUSY_POLL_BUDGET>;
+#endif
+
+#ifdef UDP_SEGMENT
+    using udp_segment = integer_option<SOL_UDP, UDP_SEGMENT>;
+#endif
+
+#ifdef UDP_GRO
+    using udp_gro = integer_option<SOL_UDP, UDP_GRO>;
+#endif
+}
+
+#endif
@@ -0,0 +1,199 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef STOP_OPERATION_HPP
+#define STOP_OPERATION_HPP
+
+#include <atomic>
+#include <optional>
+#include <boost/asio.hpp>
+#include <unifex/get_stop_token.hpp>
+#include <unifex/receiver_concepts.hpp>
+#include <unifex/stop_token_concepts.hpp>
+#include <tracer.hpp>
+#include <metrics.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    template <typename T>
+    using executor_of_t = std::remove_cvref_t<decltype(std::declval<T&>().get_executor())>;
+
+    template <typename Derived, typename Receiver, typename Executor, typename... Values>
+    struct stop_operation
+    {
+        using error_code_t = boost::system::error_code;
+        using stop_token_t = unifex::stop_token_type_t<Receiver>;
+
+        static constexpr bool stoppable = !unifex::is_stop_never_possible_v<stop_token_t>;
+
+        struct handler
+        {
+            void operator()(error_code_t ec, Values... values)
+            {
+                op->complete(ec, std::move(values)...);
+            }
+
+            stop_operation* op;
+        };
+
+        struct on_stop
+        {
+            void operator()() noexcept
+            {
+                op->request_stop(ex);
+            }
+
+            stop_operation* op;
+            Executor ex;
+        };
+
+        struct state_t
+        {
+            using callback_t = typename stop_token_t::template callback_type<on_stop>;
+
+            std::atomic<int> pending = 1;
+            std::atomic<bool> done = false;
+
+            net::cancellation_signal signal;
+
+            std::optional<callback_t> callback;
+            std::optional<std::tuple<error_code_t, Values...>> result;
+        };
+
+        struct empty_t
+        {
+        };
+
+        template <typename Initiate>
+        void initiate(const Executor& ex, Initiate&& f) noexcept
+        {
+            if constexpr(stoppable)
+            {
+                auto token = unifex::get_stop_token(receiver);
+
+                if (token.stop_requested())
+                    return unifex::set_done(std::move(receiver));
+
+                submit();
+                state.callback.emplace(token, on_stop{this, ex});
+                f(net::bind_cancellation_slot(state.signal.slot(), handler{this}));
+            }
+            else
+            {
+                submit();
+                f(handler{this});
+            }
+        }
+
+        template <typename F>
+        void on_cancel(F&& f)
+        {
+            if constexpr(stoppable)
+                state.signal.slot().assign([f = std::forward<F>(f)](net::cancellation_type) mutable { f(); });
+        }
+
+        bool stop_requested() const noexcept
+        {
+            if constexpr(stoppable)
+                return unifex::get_stop_token(receiver).stop_requested();
+            else
+                return false;
+        }
+
+        void complete(error_code_t ec, Values... values)
+        {
+            trace.complete();
+
+            if constexpr(stoppable)
+            {
+                state.callback.reset();
+                state.result.emplace(ec, std::move(values)...);
+                state.done.store(true, std::memory_order_release);
+
+                if (state.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    finish();
+            }
+            else
+                set_result(ec, std::move(values)...);
+        }
+
+        // asio requires the emission of a cancellation signal to be serialized with the operation it cancels, which posting it to the
+        // executor of the I/O object only guarantees when a single thread runs the context or the I/O object has a strand executor.
+        // an I/O object whose senders may be stopped while several threads run its context, as asio_context::run(placement) does,
+        // has to be created with net::make_strand, the composed operations reassign the slot from whichever thread runs them
+        void request_stop(const Executor& ex) noexcept
+        {
+            state.pending.fetch_add(1, std::memory_order_relaxed);
+
+            net::post(ex, [this]
+            {
+                if (!state.done.load(std::memory_order_acquire))
+                    state.signal.emit(net::cancellation_type::all);
+
+                if (state.pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                    finish();
+            });
+        }
+
+        void finish()
+        {
+            std::apply([this](error_code_t ec, Values&... values)
+            {
+                set_result(ec, std::move(values)...);
+            }, *state.result);
+        }
+
+        // for the results a sender has at hand without initiating anything
+        void complete_inline(error_code_t ec, Values... values)
+        {
+            submit();
+            trace.complete();
+
+            set_result(ec, std::move(values)...);
+        }
+
+        // the kind of sender the events of the tracer are tagged with
+        static constexpr std::string_view trace_kind() noexcept
+        {
+            if constexpr(requires { Derived::kind; })
+                return Derived::kind;
+            else
+                return "unknown";
+        }
+
+        void submit() noexcept
+        {
+            trace.submit();
+            metrics::on_start<metrics::sender_index(trace_kind())>();
+        }
+
+        void set_result(error_code_t ec, Values... values)
+        {
+            trace.invoke(receiver, trace_kind(), ec.failed());
+            metrics::on_complete<metrics::sender_index(trace_kind())>(!ec, ec == net::error::operation_aborted, values...);
+
+            if (ec == net::error::operation_aborted && stop_requested())
+                unifex::set_done(std::move(receiver));
+            else if constexpr(requires (Derived& d) { d.deliver(ec, std::move(values)...); })
+                static_cast<Derived&>(*this).deliver(ec, std::move(values)...);
+            else if (!ec)
+                unifex::set_value(std::move(receiver), std::move(values)...);
+            else
+                unifex::set_error(std::move(receiver), ec);
+        }
+
+        Receiver receiver;
+        UNIFEX_NO_UNIQUE_ADDRESS std::conditional_t<stoppable, state_t, empty_t> state;
+        UNIFEX_NO_UNIQUE_ADDRESS trace_point<Receiver> trace;
+    };
+}
+
+#endif
@@ -0,0 +1,188 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef TLS_HANDSHAKE_HPP
+#define TLS_HANDSHAKE_HPP
+
+#include <memory>
+#include <vector>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+
+namespace snp::tls
+{
+    namespace net = boost::asio;
+    namespace ssl = net::ssl;
+
+    using error_code_t = boost::system::error_code;
+
+    // runs SSL_do_handshake of an ssl stream on the executor of a cpu pool, while the records are read and written
+    // on the executor of the stream. during the handshake the SSL object reads from and writes to memory bios of its own,
+    // which are fed exactly one record at a time, so nothing that follows the handshake is read from the socket,
+    // and the bio of the stream is put back once the handshake is done
+    template <typename Stream, typename Executor>
+    struct handshake_op
+    {
+        enum step
+        {
+            starting,
+            crypto,
+            writing,
+            reading_header,
+            reading_body
+        };
+
+        struct state
+        {
+            SSL* ssl;
+            BIO* original;
+
+            BIO* in;
+            BIO* out;
+
+            std::vector<unsigned char> buffer;
+            unsigned char header[5];
+
+            error_code_t ec;
+            bool done = false;
+        };
+
+        template <typename Self>
+        void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+        {
+            auto& s = *st;
+
+            switch (current)
+            {
+                case starting:
+                {
+                    s.ssl = stream.native_handle();
+                    s.original = SSL_get_rbio(s.ssl);
+
+                    BIO_up_ref(s.original);
+
+                    s.in = BIO_new(BIO_s_mem());
+                    s.out = BIO_new(BIO_s_mem());
+
+                    BIO_set_mem_eof_return(s.in, -1);
+                    SSL_set_bio(s.ssl, s.in, s.out);
+
+                    if (type == ssl::stream_base::client)
+                        SSL_set_connect_state(s.ssl);
+                    else
+                        SSL_set_accept_state(s.ssl);
+
+                    current = crypto;
+
+                    return net::post(ex, std::move(self));
+                }
+                case crypto:
+                {
+                    // on the pool, the error queue of OpenSSL is per thread, so the error is taken here
+                    ERR_clear_error();
+
+                    auto r = SSL_do_handshake(s.ssl);
+                    auto error = SSL_get_error(s.ssl, r);
+
+                    if (r == 1)
+                        s.done = true;
+                    else if (error != SSL_ERROR_WANT_READ)
+                    {
+                        auto e = ERR_get_error();
+
+                        s.ec = e ? error_code_t(static_cast<int>(e), net::error::get_ssl_category()) : error_code_t(net::ssl::error::stream_truncated);
+                    }
+
+                    s.buffer.resize(BIO_ctrl_pending(s.out));
+
+                    if (!s.buffer.empty())
+                        BIO_read(s.out, s.buffer.data(), s.buffer.size());
+
+                    current = writing;
+
+                    return net::post(stream.get_executor(), std::move(self));
+                }
+                case writing:
+                {
+                    if (!s.buffer.empty())
+                    {
+                        current = reading_header;
+
+                        return net::async_write(stream.next_layer(), net::buffer(s.buffer), std::move(self));
+                    }
+
+                    current = reading_header;
+                    [[fallthrough]];
+                }
+                case reading_header:
+                {
+                    s.buffer.clear();
+
+                    if (ec || s.ec || s.done)
+                        return finish(self, ec ? ec : s.ec);
+
+                    current = reading_body;
+
+                    return net::async_read(stream.next_layer(), net::buffer(s.header), std::move(self));
+                }
+                case reading_body:
+                {
+                    if (ec)
+                        return finish(self, ec);
+
+                    if (s.buffer.empty())
+                    {
+                        std::size_t length = s.header[3] << 8 | s.header[4];
+
+                        if (!length)
+                            return finish(self, ssl::error::stream_truncated);
+
+                        s.buffer.resize(length);
+
+                        return net::async_read(stream.next_layer(), net::buffer(s.buffer), std::move(self));
+                    }
+
+                    BIO_write(s.in, s.header, sizeof(s.header));
+                    BIO_write(s.in, s.buffer.data(), s.buffer.size());
+
+                    current = crypto;
+
+                    return net::post(ex, std::move(self));
+                }
+            }
+        }
+
+        template <typename Self>
+        void finish(Self& self, error_code_t ec)
+        {
+            auto& s = *st;
+
+            SSL_set_bio(s.ssl, s.original, s.original);
+            self.complete(ec);
+        }
+
+        Stream& stream;
+        Executor ex;
+
+        ssl::stream_base::handshake_type type;
+
+        std::unique_ptr<state> st = std::make_unique<state>();
+        step current = starting;
+    };
+
+    template <typename Stream, typename Executor, typename Token>
+    decltype(auto) async_handshake(Stream& stream, ssl::stream_base::handshake_type type, const Executor& ex, Token&& token)
+    {
+        return net::async_compose<Token, void(error_code_t)>(handshake_op<Stream, Executor>{stream, ex, type}, token, stream);
+    }
+}
+
+#endif
@@ -0,0 +1,395 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef TLS_SESSION_CACHE_HPP
+#define TLS_SESSION_CACHE_HPP
+
+#include <list>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <unordered_map>
+#include <openssl/ssl.h>
+#include <openssl/rand.h>
+#include <openssl/core_names.h>
+#include <boost/asio/ssl.hpp>
+
+namespace snp
+{
+    namespace net = boost::asio;
+    namespace ssl = net::ssl;
+
+    struct tls_session_stats
+    {
+        uint64_t hits;
+        uint64_t misses;
+
+        uint64_t stored;
+
+        uint64_t tickets_issued;
+        uint64_t tickets_accepted;
+
+        uint64_t offered;
+    };
+
+    // session resumption state shared by any number of ssl contexts, on the server side a session id cache and a rotating set
+    // of ticket keys, so a client resumes no matter which context or thread accepts it, and on the client side the sessions
+    // received per peer, offered again on the next connection. every callback may run on any thread
+    struct tls_session_cache
+    {
+        using clock = std::chrono::steady_clock;
+        using duration = clock::duration;
+
+        struct ticket_key
+        {
+            unsigned char name[16];
+
+            unsigned char aes[32];
+            unsigned char hmac[32];
+
+            clock::time_point created;
+        };
+
+        struct entry
+        {
+            std::vector<unsigned char> der;
+            std::list<std::string>::iterator lru;
+        };
+
+        explicit tls_session_cache(std::size_t capacity = 20480, duration ticket_lifetime = std::chrono::hours(1), std::size_t sessions_per_peer = 4) :
+        capacity(capacity), ticket_lifetime(ticket_lifetime), sessions_per_peer(sessions_per_peer)
+        {
+            rotate(clock::now());
+        }
+
+        ~tls_session_cache()
+        {
+            for (auto& [peer, sessions] : clients)
+                 for (auto s : sessions)
+                      SSL_SESSION_free(s);
+        }
+
+        static int index()
+        {
+            static int index = SSL_CTX_get_ex_new_index(0, nullptr, nullptr, nullptr, nullptr);
+
+            return index;
+        }
+
+        static int peer_index()
+        {
+            static int index = SSL_get_ex_new_index(0, nullptr, nullptr, nullptr, [](void*, void* ptr, CRYPTO_EX_DATA*, int, long, void*)
+            {
+                delete static_cast<std::string*>(ptr);
+            });
+
+            return index;
+        }
+
+        static tls_session_cache* from(const SSL* ssl)
+        {
+            return static_cast<tls_session_cache*>(SSL_CTX_get_ex_data(SSL_get_SSL_CTX(ssl), index()));
+        }
+
+        // the contexts that share the cache must share the session id context too, or they reject each other's sessions
+        void attach_server(ssl::context& context, std::string_view id_context = "snp")
+        {
+            auto ctx = context.native_handle();
+
+            SSL_CTX_set_ex_data(ctx, index(), this);
+            SSL_CTX_set_session_id_context(ctx, reinterpret_cast<const unsigned char*>(id_context.data()), std::min<std::size_t>(id_context.size(), SSL_MAX_SID_CTX_LENGTH));
+
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_SERVER | SSL_SESS_CACHE_NO_INTERNAL);
+
+            SSL_CTX_sess_set_new_cb(ctx, on_new_server);
+            SSL_CTX_sess_set_get_cb(ctx, on_get);
+            SSL_CTX_sess_set_remove_cb(ctx, on_remove);
+
+            SSL_CTX_set_tlsext_ticket_key_evp_cb(ctx, on_ticket);
+        }
+
+        void attach_client(ssl::context& context)
+        {
+            auto ctx = context.native_handle();
+
+            SSL_CTX_set_ex_data(ctx, index(), this);
+            SSL_CTX_set_session_cache_mode(ctx, SSL_SESS_CACHE_CLIENT | SSL_SESS_CACHE_NO_INTERNAL_STORE);
+
+            SSL_CTX_sess_set_new_cb(ctx, on_new_client);
+        }
+
+        // must be called before the handshake of a client connection, peer is the key the sessions are kept under, e.g. host:port,
+        // a TLS 1.3 session is offered only once, as tickets shouldn't be reused. OpenSSL drops the session of a connection that
+        // is freed without a shutdown, so connections that should be resumed end with async_shutdown.
+        // calling it again on the same connection replaces the peer
+        void resume(SSL* ssl, std::string_view peer)
+        {
+            if (auto p = static_cast<std::string*>(SSL_get_ex_data(ssl, peer_index())))
+                p->assign(peer);
+            else
+                SSL_set_ex_data(ssl, peer_index(), new std::string(peer));
+
+            SSL_SESSION* session = nullptr;
+
+            {
+                std::lock_guard lock(m);
+
+                auto it = clients.find(std::string(peer));
+
+                if (it == clients.end() || it->second.empty())
+                    return;
+
+                session = it->second.back();
+
+                if (SSL_SESSION_get_protocol_version(session) == TLS1_3_VERSION)
+                    it->second.pop_back();
+                else
+                    SSL_SESSION_up_ref(session);
+            }
+
+            SSL_set_session(ssl, session);
+            SSL_SESSION_free(session);
+
+            ++offered;
+        }
+
+        template <typename Stream>
+        void resume(Stream& stream, std::string_view peer)
+        {
+            resume(stream.native_handle(), peer);
+        }
+
+        static int on_new_server(SSL* ssl, SSL_SESSION* session)
+        {
+            auto cache = from(ssl);
+
+            // a TLS 1.3 client resumes with the ticket, the session is never looked up by its id
+            if (SSL_version(ssl) == TLS1_3_VERSION && !(SSL_get_options(ssl) & SSL_OP_NO_TICKET))
+                return 0;
+
+            unsigned int size;
+            auto id = SSL_SESSION_get_id(session, &size);
+
+            std::vector<unsigned char> der(i2d_SSL_SESSION(session, nullptr));
+            auto p = der.data();
+
+            i2d_SSL_SESSION(session, &p);
+
+            std::lock_guard lock(cache->m);
+            cache->insert(std::string(reinterpret_cast<const char*>(id), size), std::move(der));
+
+            ++cache->stored;
+
+            return 0;
+        }
+
+        static SSL_SESSION* on_get(SSL* ssl, const unsigned char* id, int size, int* copy)
+        {
+            auto cache = from(ssl);
+            *copy = 0;
+
+            std::lock_guard lock(cache->m);
+
+            auto it = cache->servers.find(std::string(reinterpret_cast<const char*>(id), size));
+
+            if (it == cache->servers.end())
+            {
+                ++cache->misses;
+
+                return nullptr;
+            }
+
+            cache->lru.splice(cache->lru.begin(), cache->lru, it->second.lru);
+            ++cache->hits;
+
+            const unsigned char* p = it->second.der.data();
+
+            return d2i_SSL_SESSION(nullptr, &p, it->second.der.size());
+        }
+
+        static void on_remove(SSL_CTX* ctx, SSL_SESSION* session)
+        {
+            auto cache = static_cast<tls_session_cache*>(SSL_CTX_get_ex_data(ctx, index()));
+
+            unsigned int size;
+            auto id = SSL_SESSION_get_id(session, &size);
+
+            std::lock_guard lock(cache->m);
+
+            if (auto it = cache->servers.find(std::string(reinterpret_cast<const char*>(id), size)); it != cache->servers.end())
+            {
+                cache->lru.erase(it->second.lru);
+                cache->servers.erase(it);
+            }
+        }
+
+        static int on_new_client(SSL* ssl, SSL_SESSION* session)
+        {
+            auto cache = from(ssl);
+            auto peer = static_cast<std::string*>(SSL_get_ex_data(ssl, peer_index()));
+
+            if (!peer || !SSL_SESSION_is_resumable(session))
+                return 0;
+
+            std::lock_guard lock(cache->m);
+            auto& sessions = cache->clients[*peer];
+
+            if (sessions.size() == cache->sessions_per_peer)
+            {
+                SSL_SESSION_free(sessions.front());
+                sessions.pop_front();
+            }
+
+            sessions.push_back(session);
+            ++cache->stored;
+
+            // the reference is kept
+            return 1;
+        }
+
+        // encrypts new tickets with the current key, and accepts the tickets of the previous keys too, which are renewed
+        static int on_ticket(SSL* ssl, unsigned char* name, unsigned char* iv, EVP_CIPHER_CTX* cipher, EVP_MAC_CTX* mac, int enc)
+        {
+            auto cache = from(ssl);
+            ticket_key key;
+
+            bool current = true;
+
+            {
+                std::lock_guard lock(cache->m);
+
+                auto now = clock::now();
+
+                if (now - cache->keys.front().created >= cache->ticket_lifetime)
+                    cache->rotate(now);
+
+                if (enc)
+                    key = cache->keys.front();
+                else
+                {
+                    auto it = std::ranges::find_if(cache->keys, [name](auto& k){ return !std::memcmp(k.name, name, sizeof(k.name)); });
+
+                    if (it == cache->keys.end())
+                        return 0;
+
+                    key = *it;
+                    current = it == cache->keys.begin();
+                }
+            }
+
+            char digest[] = "SHA256";
+
+            OSSL_PARAM params[] =
+            {
+                OSSL_PARAM_construct_octet_string(OSSL_MAC_PARAM_KEY, key.hmac, sizeof(key.hmac)),
+                OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+                OSSL_PARAM_construct_end()
+            };
+
+            if (enc)
+            {
+                if (RAND_bytes(iv, 16) <= 0)
+                    return -1;
+
+                std::memcpy(name, key.name, sizeof(key.name));
+
+                if (!EVP_EncryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv) || !EVP_MAC_CTX_set_params(mac, params))
+                    return -1;
+
+                ++cache->tickets_issued;
+
+                return 1;
+            }
+
+            if (!EVP_DecryptInit_ex(cipher, EVP_aes_256_cbc(), nullptr, key.aes, iv) || !EVP_MAC_CTX_set_params(mac, params))
+                return -1;
+
+            ++cache->tickets_accepted;
+
+            // OpenSSL only sends a TLS 1.3 client a new ticket on resumption if the ticket is renewed,
+            // and the client offers every ticket once
+            return current && SSL_version(ssl) != TLS1_3_VERSION ? 1 : 2;
+        }
+
+        void insert(std::string id, std::vector<unsigned char> der)
+        {
+            if (auto it = servers.find(id); it != servers.end())
+            {
+                lru.erase(it->second.lru);
+                servers.erase(it);
+            }
+
+            lru.push_front(id);
+            servers.emplace(std::move(id), entry{std::move(der), lru.begin()});
+
+            while (servers.size() > capacity)
+            {
+                servers.erase(lru.back());
+                lru.pop_back();
+            }
+        }
+
+        // a new key encrypts the tickets from now on, the two before it still decrypt the tickets they issued
+        void rotate(clock::time_point now)
+        {
+            ticket_key key;
+
+            RAND_bytes(key.name, sizeof(key.name));
+            RAND_bytes(key.aes, sizeof(key.aes));
+            RAND_bytes(key.hmac, sizeof(key.hmac));
+
+            key.created = now;
+            keys.push_front(key);
+
+            if (keys.size() > 3)
+                keys.pop_back();
+        }
+
+        tls_session_stats stats() const noexcept
+        {
+            return {hits.load(), misses.load(), stored.load(), tickets_issued.load(), tickets_accepted.load(), offered.load()};
+        }
+
+        std::size_t size()
+        {
+            std::lock_guard lock(m);
+
+            return servers.size();
+        }
+
+        std::mutex m;
+
+        std::size_t capacity;
+        duration ticket_lifetime;
+
+        std::size_t sessions_per_peer;
+        std::deque<ticket_key> keys;
+
+        std::list<std::string> lru;
+        std::unordered_map<std::string, entry> servers;
+
+        std::unordered_map<std::string, std::deque<SSL_SESSION*>> clients;
+
+        std::atomic<uint64_t> hits = 0;
+        std::atomic<uint64_t> misses = 0;
+
+        std::atomic<uint64_t> stored = 0;
+
+        std::atomic<uint64_t> tickets_issued = 0;
+        std::atomic<uint64_t> tickets_accepted = 0;
+
+        std::atomic<uint64_t> offered = 0;
+    };
+}
+
+#endif
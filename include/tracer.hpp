@@ -0,0 +1,190 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef TRACER_HPP
+#define TRACER_HPP
+
+#include <chrono>
+#include <utility>
+#include <functional>
+#include <string_view>
+#include <type_traits>
+#include <unifex/bind_back.hpp>
+#include <unifex/tag_invoke.hpp>
+#include <unifex/sender_concepts.hpp>
+#include <unifex/receiver_concepts.hpp>
+
+namespace snp
+{
+    using trace_clock = std::chrono::steady_clock;
+
+    // one operation of a sender: submitted when it's initiated, completed when its completion handler runs on the context,
+    // invoked right before its receiver is called. neither backend tells when the kernel finished an operation,
+    // so complete - submit is the time in the kernel plus the time the completion queued in the context
+    struct trace_event
+    {
+        std::string_view kind;
+
+        trace_clock::time_point submit;
+        trace_clock::time_point complete;
+        trace_clock::time_point invoke;
+
+        // completed with an error or done
+        bool failed;
+    };
+
+    template <typename T>
+    concept tracer = requires (T& t, const trace_event& e) { t.record(e); };
+
+    // what get_tracer answers for a receiver without a tracer, the senders compile their trace points away for it
+    struct null_tracer
+    {
+    };
+
+    struct get_tracer_fn
+    {
+        template <typename Receiver>
+        constexpr decltype(auto) operator()(const Receiver& receiver) const noexcept
+        {
+            if constexpr(unifex::is_tag_invocable_v<get_tracer_fn, const Receiver&>)
+                return unifex::tag_invoke(*this, receiver);
+            else
+                return null_tracer{};
+        }
+    };
+
+    inline constexpr get_tracer_fn get_tracer{};
+
+    template <typename Receiver>
+    using tracer_of_t = decltype(get_tracer(std::declval<const Receiver&>()));
+
+    template <typename Receiver>
+    inline constexpr bool is_traced_v = !std::is_same_v<std::remove_cvref_t<tracer_of_t<Receiver>>, null_tracer>;
+
+    // the timestamps an operation takes for the tracer of its receiver, nothing at all without one
+    template <typename Receiver>
+    struct trace_point
+    {
+        static constexpr bool enabled = is_traced_v<Receiver>;
+
+        struct times
+        {
+            trace_clock::time_point submit;
+            trace_clock::time_point complete;
+        };
+
+        struct empty_t
+        {
+        };
+
+        void submit() noexcept
+        {
+            if constexpr(enabled)
+                t.submit = trace_clock::now();
+        }
+
+        void complete() noexcept
+        {
+            if constexpr(enabled)
+                t.complete = trace_clock::now();
+        }
+
+        // called before the receiver, which may destroy the operation
+        void invoke(const Receiver& receiver, std::string_view kind, bool failed) noexcept
+        {
+            if constexpr(enabled)
+                get_tracer(receiver).record(trace_event{kind, t.submit, t.complete, trace_clock::now(), failed});
+        }
+
+        UNIFEX_NO_UNIQUE_ADDRESS std::conditional_t<enabled, times, empty_t> t;
+    };
+
+    // answers get_tracer with the tracer for every sender connected within sender, the other queries go on to the receiver
+    template <typename Sender, typename Tracer>
+    struct traced
+    {
+        template <template <typename ...> typename Variant, template <typename ...> typename Tuple>
+        using value_types = unifex::sender_value_types_t<Sender, Variant, Tuple>;
+
+        template <template <typename ...> typename Variant>
+        using error_types = unifex::sender_error_types_t<Sender, Variant>;
+
+        static constexpr bool sends_done = unifex::sender_traits<Sender>::sends_done;
+
+        template <typename Receiver>
+        struct receiver_t
+        {
+            template <typename... Values>
+            void set_value(Values&&... values)
+            {
+                unifex::set_value(std::move(receiver), std::forward<Values>(values)...);
+            }
+
+            template <typename Error>
+            void set_error(Error&& error) noexcept
+            {
+                unifex::set_error(std::move(receiver), std::forward<Error>(error));
+            }
+
+            void set_done() noexcept
+            {
+                unifex::set_done(std::move(receiver));
+            }
+
+            friend Tracer& tag_invoke(unifex::tag_t<get_tracer>, const receiver_t& r) noexcept
+            {
+                return *r.tracer;
+            }
+
+            template <typename CPO>
+            requires (unifex::is_receiver_query_cpo_v<CPO> && !std::is_same_v<CPO, get_tracer_fn> && std::is_invocable_v<CPO, const Receiver&>)
+            friend decltype(auto) tag_invoke(CPO cpo, const receiver_t& r) noexcept(std::is_nothrow_invocable_v<CPO, const Receiver&>)
+            {
+                return std::move(cpo)(r.receiver);
+            }
+
+            Receiver receiver;
+            Tracer* tracer;
+        };
+
+        template <typename Receiver>
+        constexpr decltype(auto) connect(Receiver&& receiver)
+        {
+            return unifex::connect(std::move(sender), receiver_t<std::remove_cvref_t<Receiver>>{std::forward<Receiver>(receiver), &t});
+        }
+
+        Sender sender;
+        Tracer& t;
+    };
+
+    struct with_tracer_fn
+    {
+        template <typename Sender, tracer Tracer>
+        constexpr auto operator()(Sender&& sender, Tracer& t) const
+        {
+            return traced<std::remove_cvref_t<Sender>, Tracer>{std::forward<Sender>(sender), t};
+        }
+
+        template <typename Sender, tracer Tracer>
+        constexpr auto operator()(Sender&& sender, std::reference_wrapper<Tracer> t) const
+        {
+            return traced<std::remove_cvref_t<Sender>, Tracer>{std::forward<Sender>(sender), t.get()};
+        }
+
+        template <tracer Tracer>
+        constexpr auto operator()(Tracer& t) const
+        {
+            return unifex::bind_back(*this, std::ref(t));
+        }
+    };
+
+    inline constexpr with_tracer_fn with_tracer{};
+}
+
+#endif
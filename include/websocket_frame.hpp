@@ -0,0 +1,193 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef WEBSOCKET_FRAME_HPP
+#define WEBSOCKET_FRAME_HPP
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <boost/beast/zlib/deflate_stream.hpp>
+#include <shared_buffer.hpp>
+
+namespace snp::ws
+{
+    namespace zlib = boost::beast::zlib;
+
+    enum opcode : uint8_t
+    {
+        continuation = 0x0,
+        text = 0x1,
+        binary = 0x2,
+        close = 0x8,
+        ping = 0x9,
+        pong = 0xa
+    };
+
+    inline constexpr std::size_t max_header_length = 14;
+
+    // writes the header of a frame to out and returns its length, the payload is masked with mask if it isn't null,
+    // as a client must do, a server sends its frames unmasked
+    inline std::size_t encode_header(char* out, std::size_t length, opcode op, bool fin = true, bool compressed = false, const char* mask = nullptr) noexcept
+    {
+        std::size_t n = 2;
+
+        out[0] = static_cast<char>((fin ? 0x80 : 0) | (compressed ? 0x40 : 0) | op);
+        out[1] = static_cast<char>(mask ? 0x80 : 0);
+
+        if (length < 126)
+            out[1] |= static_cast<char>(length);
+        else if (length < 65536)
+        {
+            out[1] |= 126;
+
+            for (std::size_t i = 2; i--; length >>= 8)
+                 out[n + i] = static_cast<char>(length);
+
+            n += 2;
+        }
+        else
+        {
+            out[1] |= 127;
+
+            for (std::size_t i = 8; i--; length >>= 8)
+                 out[n + i] = static_cast<char>(length);
+
+            n += 8;
+        }
+
+        if (mask)
+        {
+            std::memcpy(out + n, mask, 4);
+            n += 4;
+        }
+
+        return n;
+    }
+
+    struct frame_header
+    {
+        opcode op;
+
+        bool fin;
+        bool rsv;
+
+        bool masked;
+        char key[4];
+
+        uint64_t length;
+    };
+
+    // decodes the header of a frame in place, returns its length, or 0 while it is incomplete
+    inline std::size_t decode_header(const char* data, std::size_t size, frame_header& header) noexcept
+    {
+        if (size < 2)
+            return 0;
+
+        auto b0 = static_cast<uint8_t>(data[0]);
+        auto b1 = static_cast<uint8_t>(data[1]);
+
+        header.op = static_cast<opcode>(b0 & 0x0f);
+        header.fin = b0 & 0x80;
+
+        header.rsv = b0 & 0x70;
+        header.masked = b1 & 0x80;
+
+        std::size_t n = 2;
+        uint64_t length = b1 & 0x7f;
+
+        if (length >= 126)
+        {
+            std::size_t k = length == 126 ? 2 : 8;
+
+            if (size < n + k)
+                return 0;
+
+            length = 0;
+
+            for (std::size_t i = 0; i != k; ++i)
+                 length = length << 8 | static_cast<uint8_t>(data[n + i]);
+
+            n += k;
+        }
+
+        if (header.masked)
+        {
+            if (size < n + 4)
+                return 0;
+
+            std::memcpy(header.key, data + n, 4);
+            n += 4;
+        }
+
+        header.length = length;
+
+        return n;
+    }
+
+    // a complete server to client frame, encoded once and written as raw bytes to any number of connections
+    inline shared_buffer encode_frame(std::string_view payload, opcode op = text, bool compressed = false)
+    {
+        char header[max_header_length];
+        auto n = encode_header(header, payload.size(), op, true, compressed);
+
+        shared_buffer frame(n + payload.size());
+
+        std::memcpy(frame.data(), header, n);
+        std::memcpy(frame.data() + n, payload.data(), payload.size());
+
+        return frame;
+    }
+
+    // compresses messages for permessage-deflate, every message is compressed on its own,
+    // so the frames are only valid for connections that negotiated server_no_context_takeover
+    class deflater
+    {
+    public:
+        explicit deflater(int level = 6, int window_bits = 15, int mem_level = 8)
+        {
+            stream.reset(level, window_bits, mem_level, zlib::Strategy::normal);
+        }
+
+        std::string_view compress(std::string_view payload)
+        {
+            out.resize(stream.upper_bound(payload.size()) + 16);
+
+            zlib::z_params zs;
+
+            zs.next_in = payload.data();
+            zs.avail_in = payload.size();
+
+            zs.next_out = out.data();
+            zs.avail_out = out.size();
+
+            boost::system::error_code ec;
+
+            stream.write(zs, zlib::Flush::none, ec);
+            stream.write(zs, zlib::Flush::full, ec);
+
+            stream.reset();
+
+            // the full flush ends the output with an empty stored block, which the receiver appends itself
+            return {out.data(), zs.total_out - 4};
+        }
+
+        shared_buffer encode_frame(std::string_view payload, opcode op = text)
+        {
+            return ws::encode_frame(compress(payload), op, true);
+        }
+
+    private:
+        zlib::deflate_stream stream;
+        std::vector<char> out;
+    };
+}
+
+#endif
@@ -0,0 +1,1194 @@
+//
+// Copyright (c) 2023-present DeepGrace (complex dot invoke at gmail dot com)
+//
+// Distributed under the Boost Software License, Version 1.0.
+// (See accompanying file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Official repository: https://github.com/deepgrace/snp
+//
+
+#ifndef WEBSOCKET_STREAM_HPP
+#define WEBSOCKET_STREAM_HPP
+
+#include <array>
+#include <deque>
+#include <cctype>
+#include <span>
+#include <random>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <algorithm>
+#include <string_view>
+#include <boost/asio.hpp>
+#include <simd.hpp>
+#include <buffer_pool.hpp>
+#include <websocket_frame.hpp>
+
+namespace snp::ws
+{
+    enum close_code : uint16_t
+    {
+        normal = 1000,
+        going_away = 1001,
+        protocol_error = 1002,
+        invalid_payload = 1007,
+        too_big = 1009
+    };
+
+    inline std::array<uint8_t, 20> sha1(std::string_view data) noexcept
+    {
+        uint32_t h[5] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0 };
+
+        auto rotl = [](uint32_t x, int n)
+        {
+            return x << n | x >> (32 - n);
+        };
+
+        auto process = [&](const uint8_t* p)
+        {
+            uint32_t w[80];
+
+            for (int i = 0; i != 16; ++i)
+                 w[i] = uint32_t(p[4 * i]) << 24 | uint32_t(p[4 * i + 1]) << 16 | uint32_t(p[4 * i + 2]) << 8 | p[4 * i + 3];
+
+            for (int i = 16; i != 80; ++i)
+                 w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+            auto [a, b, c, d, e] = h;
+
+            for (int i = 0; i != 80; ++i)
+            {
+                 uint32_t f, k;
+
+                 if (i < 20)
+                 {
+                     f = (b & c) | (~b & d);
+                     k = 0x5a827999;
+                 }
+                 else if (i < 40)
+                 {
+                     f = b ^ c ^ d;
+                     k = 0x6ed9eba1;
+                 }
+                 else if (i < 60)
+                 {
+                     f = (b & c) | (b & d) | (c & d);
+                     k = 0x8f1bbcdc;
+                 }
+                 else
+                 {
+                     f = b ^ c ^ d;
+                     k = 0xca62c1d6;
+                 }
+
+                 auto t = rotl(a, 5) + f + e + k + w[i];
+
+                 e = d;
+                 d = c;
+
+                 c = rotl(b, 30);
+                 b = a;
+
+                 a = t;
+            }
+
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        };
+
+        auto p = reinterpret_cast<const uint8_t*>(data.data());
+        std::size_t n = data.size();
+
+        std::size_t i = 0;
+
+        for (; i + 64 <= n; i += 64)
+             process(p + i);
+
+        uint8_t tail[128] = {};
+        std::size_t r = n - i;
+
+        std::memcpy(tail, p + i, r);
+        tail[r] = 0x80;
+
+        std::size_t blocks = r + 9 > 64 ? 2 : 1;
+        uint64_t bits = uint64_t(n) * 8;
+
+        for (int j = 0; j != 8; ++j)
+             tail[blocks * 64 - 1 - j] = static_cast<uint8_t>(bits >> 8 * j);
+
+        for (std::size_t j = 0; j != blocks; ++j)
+             process(tail + 64 * j);
+
+        std::array<uint8_t, 20> digest;
+
+        for (int j = 0; j != 20; ++j)
+             digest[j] = static_cast<uint8_t>(h[j / 4] >> (24 - 8 * (j % 4)));
+
+        return digest;
+    }
+
+    inline std::string base64(const uint8_t* data, std::size_t size)
+    {
+        static constexpr char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+        std::string out;
+        out.reserve((size + 2) / 3 * 4);
+
+        for (std::size_t i = 0; i < size; i += 3)
+        {
+             uint32_t v = uint32_t(data[i]) << 16;
+
+             if (i + 1 < size)
+                 v |= uint32_t(data[i + 1]) << 8;
+
+             if (i + 2 < size)
+                 v |= data[i + 2];
+
+             out += alphabet[v >> 18 & 63];
+             out += alphabet[v >> 12 & 63];
+
+             out += i + 1 < size ? alphabet[v >> 6 & 63] : '=';
+             out += i + 2 < size ? alphabet[v & 63] : '=';
+        }
+
+        return out;
+    }
+
+    // the Sec-WebSocket-Accept value answering a Sec-WebSocket-Key
+    inline std::string accept_key(std::string_view key)
+    {
+        std::string s(key);
+        s += "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+        auto digest = sha1(s);
+
+        return base64(digest.data(), digest.size());
+    }
+
+    inline uint32_t random() noexcept
+    {
+        thread_local std::mt19937 rng{std::random_device{}()};
+
+        return rng();
+    }
+
+    inline bool iequals(std::string_view a, std::string_view b) noexcept
+    {
+        return std::ranges::equal(a, b, [](char x, char y){ return std::tolower(x) == std::tolower(y); });
+    }
+
+    // whether the comma separated value of a header field contains token
+    inline bool contains(std::string_view value, std::string_view token) noexcept
+    {
+        return !std::ranges::search(value, token, [](char x, char y){ return std::tolower(x) == std::tolower(y); }).empty();
+    }
+
+    // the value of the field name in an http header block, field names compare case insensitively
+    inline std::string_view field(std::string_view head, std::string_view name) noexcept
+    {
+        auto pos = head.find("\r\n");
+
+        while (pos != std::string_view::npos)
+        {
+            auto begin = pos + 2;
+            auto end = std::min(head.find("\r\n", begin), head.size());
+
+            auto line = head.substr(begin, end - begin);
+
+            if (line.size() > name.size() && line[name.size()] == ':' && iequals(line.substr(0, name.size()), name))
+            {
+                auto value = line.substr(name.size() + 1);
+
+                while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+                    value.remove_prefix(1);
+
+                while (!value.empty() && (value.back() == ' ' || value.back() == '\t'))
+                    value.remove_suffix(1);
+
+                return value;
+            }
+
+            pos = end == head.size() ? std::string_view::npos : end;
+        }
+
+        return {};
+    }
+
+    // validates the payload of a text message as it arrives, a code point may be split across the pieces it is fed in,
+    // overlong encodings, surrogates and code points above U+10FFFF are rejected
+    struct utf8_validator
+    {
+        void reset() noexcept
+        {
+            need = 0;
+            failed = false;
+        }
+
+        void feed(const char* data, std::size_t size) noexcept
+        {
+            auto p = reinterpret_cast<const uint8_t*>(data);
+            auto end = p + size;
+
+            while (p != end && !failed)
+            {
+                if (!need)
+                {
+                    // skips the ascii runs a word at a time
+                    while (end - p >= 8)
+                    {
+                        uint64_t w;
+                        std::memcpy(&w, p, 8);
+
+                        if (w & 0x8080808080808080ull)
+                            break;
+
+                        p += 8;
+                    }
+
+                    if (p == end)
+                        break;
+
+                    auto c = *p++;
+
+                    if (c < 0x80)
+                        continue;
+
+                    lo = 0x80;
+                    hi = 0xbf;
+
+                    if (c >= 0xc2 && c <= 0xdf)
+                        need = 1;
+                    else if (c >= 0xe0 && c <= 0xef)
+                    {
+                        need = 2;
+
+                        if (c == 0xe0)
+                            lo = 0xa0;
+                        else if (c == 0xed)
+                            hi = 0x9f;
+                    }
+                    else if (c >= 0xf0 && c <= 0xf4)
+                    {
+                        need = 3;
+
+                        if (c == 0xf0)
+                            lo = 0x90;
+                        else if (c == 0xf4)
+                            hi = 0x8f;
+                    }
+                    else
+                        failed = true;
+                }
+                else
+                {
+                    auto c = *p++;
+
+                    if (c < lo || c > hi)
+                        failed = true;
+
+                    lo = 0x80;
+                    hi = 0xbf;
+
+                    --need;
+                }
+            }
+        }
+
+        // whether the payload fed so far ends on a code point boundary
+        bool complete() const noexcept
+        {
+            return !failed && !need;
+        }
+
+        uint32_t need = 0;
+
+        uint8_t lo = 0x80;
+        uint8_t hi = 0xbf;
+
+        bool failed = false;
+    };
+}
+
+namespace snp
+{
+    namespace net = boost::asio;
+
+    // a websocket stream over any asio stream, frame headers are parsed in place in a pooled read buffer,
+    // payloads are unmasked with simd while they are copied out, and ping, pong and close frames are answered inline.
+    // it is used with async_accept, async_handshake, async_read, async_write and async_close of snp like a beast stream
+    template <typename NextLayer>
+    struct websocket_stream
+    {
+        using error_code_t = boost::system::error_code;
+
+        using next_layer_type = std::remove_reference_t<NextLayer>;
+        using executor_type = typename next_layer_type::executor_type;
+
+        // the tag the senders of snp recognize websocket streams by, permessage-deflate is not negotiated
+        using is_deflate_supported = std::false_type;
+
+        static constexpr std::size_t max_header_size = 16 * 1024;
+
+        template <typename Arg>
+        explicit websocket_stream(Arg&& arg, std::size_t capacity = 64 * 1024) : next(std::forward<Arg>(arg)), rd(std::max<std::size_t>(capacity, 256)), wr(0)
+        {
+        }
+
+        executor_type get_executor() noexcept
+        {
+            return next.get_executor();
+        }
+
+        next_layer_type& next_layer() noexcept
+        {
+            return next;
+        }
+
+        decltype(auto) lowest_layer() noexcept
+        {
+            if constexpr(requires { next.lowest_layer(); })
+                return next.lowest_layer();
+            else
+                return (next);
+        }
+
+        bool is_open() const noexcept
+        {
+            return open;
+        }
+
+        // the opcode of the messages written next
+        void text(bool value) noexcept
+        {
+            wr_op = value ? ws::text : ws::binary;
+        }
+
+        bool got_text() const noexcept
+        {
+            return rd_op == ws::text;
+        }
+
+        bool got_binary() const noexcept
+        {
+            return rd_op == ws::binary;
+        }
+
+        void read_message_max(std::size_t size) noexcept
+        {
+            max_message = size;
+        }
+
+        // the close code sent by the peer
+        uint16_t reason() const noexcept
+        {
+            return close_reason;
+        }
+
+        static error_code_t protocol_error() noexcept
+        {
+            return boost::system::errc::make_error_code(boost::system::errc::protocol_error);
+        }
+
+        net::mutable_buffer prepare(std::size_t max_size)
+        {
+            if (head)
+            {
+                std::memmove(rd.data(), rd.data() + head, tail - head);
+
+                tail -= head;
+                head = 0;
+            }
+
+            if (tail == rd.size() && rd.size() < max_size)
+                rd.grow(std::min(2 * rd.size(), max_size), tail);
+
+            return net::buffer(rd.data() + tail, rd.size() - tail);
+        }
+
+        // the http header block at the front of the read buffer, empty while it is incomplete
+        std::string_view header_block() noexcept
+        {
+            auto pos = simd::find(rd.data() + head, tail - head, "\r\n\r\n");
+
+            if (pos == simd::npos)
+                return {};
+
+            std::string_view block(rd.data() + head, pos + 2);
+            head += pos + 4;
+
+            return block;
+        }
+
+        void close_next() noexcept
+        {
+            error_code_t ec;
+            auto& layer = lowest_layer();
+
+            if constexpr(requires { layer.close(ec); })
+                layer.close(ec);
+            else
+                layer.close();
+
+            open = false;
+        }
+
+        // writes a single frame, a client masks the payload into the write buffer, a server writes it as it is
+        template <typename ConstBufferSequence, typename Handler>
+        void write_frame(ws::opcode op, const ConstBufferSequence& buffers, Handler&& handler)
+        {
+            auto size = net::buffer_size(buffers);
+            wr_buffers.clear();
+
+            if (server)
+            {
+                wr_buffers.push_back(net::buffer(wr_header, ws::encode_header(wr_header, size, op)));
+
+                for (auto it = net::buffer_sequence_begin(buffers); it != net::buffer_sequence_end(buffers); ++it)
+                     wr_buffers.push_back(*it);
+            }
+            else
+            {
+                char key[4];
+                uint32_t r = ws::random();
+
+                std::memcpy(key, &r, 4);
+                wr_buffers.push_back(net::buffer(wr_header, ws::encode_header(wr_header, size, op, true, false, key)));
+
+                if (wr.size() < size)
+                    wr.grow(std::max(size, 2 * wr.size()), 0);
+
+                std::size_t offset = 0;
+
+                for (auto it = net::buffer_sequence_begin(buffers); it != net::buffer_sequence_end(buffers); ++it)
+                {
+                     net::const_buffer b = *it;
+                     simd::mask(wr.data() + offset, static_cast<const char*>(b.data()), b.size(), key, offset);
+
+                     offset += b.size();
+                }
+
+                wr_buffers.push_back(net::buffer(wr.data(), size));
+            }
+
+            net::async_write(next, std::span<const net::const_buffer>(wr_buffers), std::forward<Handler>(handler));
+        }
+
+        // control frames are answered at the next write boundary, the payload is copied so that another ping can arrive meanwhile
+        template <typename Handler>
+        void write_control(Handler&& handler)
+        {
+            control_pending = false;
+            std::memcpy(wr_control, control, control_size);
+
+            write_frame(control_op, net::buffer(wr_control, control_size), std::forward<Handler>(handler));
+        }
+
+        void queue_control(ws::opcode op, const char* data, std::size_t size) noexcept
+        {
+            control_op = op;
+            control_size = size;
+
+            std::memcpy(control, data, size);
+            control_pending = true;
+        }
+
+        struct parked
+        {
+            virtual ~parked() = default;
+
+            virtual void resume() = 0;
+        };
+
+        template <typename Self>
+        struct parked_op : parked
+        {
+            parked_op(Self&& self) : self(std::move(self))
+            {
+            }
+
+            void resume() override
+            {
+                self();
+            }
+
+            Self self;
+        };
+
+        // a write or close waits here while another one is in progress, they are resumed one at a time in the order they came in
+        template <typename Self>
+        void park(Self&& self)
+        {
+            waiting.push_back(std::make_unique<parked_op<std::remove_cvref_t<Self>>>(std::move(self)));
+        }
+
+        void resume()
+        {
+            wr_busy = false;
+
+            if (waiting.empty())
+                return;
+
+            auto op = std::move(waiting.front());
+            waiting.pop_front();
+
+            op->resume();
+        }
+
+        // copies n payload bytes into the dynamic buffer, unmasking them on the way
+        template <typename DynamicBuffer>
+        void copy_payload(DynamicBuffer& buffer, const char* data, std::size_t n)
+        {
+            auto buffers = buffer.prepare(n);
+
+            for (auto it = net::buffer_sequence_begin(buffers); it != net::buffer_sequence_end(buffers); ++it)
+            {
+                 net::mutable_buffer b = *it;
+
+                 if (frame.masked)
+                     simd::mask(static_cast<char*>(b.data()), data, b.size(), frame.key, offset);
+                 else
+                     std::memcpy(b.data(), data, b.size());
+
+                 if (rd_op == ws::text)
+                     utf8.feed(static_cast<const char*>(b.data()), b.size());
+
+                 data += b.size();
+                 offset += b.size();
+            }
+
+            buffer.commit(n);
+            remaining -= n;
+        }
+
+        enum { starting, sending, reading, direct, replying, closing, failing, finished };
+
+        struct accept_op
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                switch (state)
+                {
+                    case starting:
+                        ws.server = true;
+
+                        break;
+                    case reading:
+                        if (ec)
+                            return self.complete(ec);
+
+                        ws.tail += n;
+
+                        break;
+                    case replying:
+                        ws.open = !ec;
+
+                        return self.complete(ec);
+                    default:
+                        return self.complete(ec ? ec : protocol_error());
+                }
+
+                auto block = ws.header_block();
+
+                if (block.empty())
+                {
+                    if (ws.tail - ws.head >= max_header_size)
+                        return respond(self, false);
+
+                    state = reading;
+
+                    return ws.next.async_read_some(ws.prepare(max_header_size), std::move(self));
+                }
+
+                auto key = ws::field(block, "Sec-WebSocket-Key");
+
+                if (!block.starts_with("GET ") || !ws::contains(ws::field(block, "Upgrade"), "websocket") || ws::field(block, "Sec-WebSocket-Version") != "13" || key.empty())
+                    return respond(self, false);
+
+                ws.handshake = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: ";
+                ws.handshake += ws::accept_key(key);
+                ws.handshake += "\r\n\r\n";
+
+                respond(self, true);
+            }
+
+            template <typename Self>
+            void respond(Self& self, bool upgrade)
+            {
+                if (!upgrade)
+                    ws.handshake = "HTTP/1.1 400 Bad Request\r\nConnection: close\r\nContent-Length: 0\r\n\r\n";
+
+                state = upgrade ? replying : finished;
+                net::async_write(ws.next, net::buffer(ws.handshake), std::move(self));
+            }
+
+            websocket_stream& ws;
+            int state = starting;
+        };
+
+        struct handshake_op
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                switch (state)
+                {
+                    case starting:
+                    {
+                        uint8_t nonce[16];
+
+                        for (std::size_t i = 0; i != 16; i += 4)
+                        {
+                             uint32_t r = ws::random();
+                             std::memcpy(nonce + i, &r, 4);
+                        }
+
+                        ws.server = false;
+                        key = ws::base64(nonce, 16);
+
+                        ws.handshake = "GET " + target + " HTTP/1.1\r\nHost: " + host + "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: ";
+                        ws.handshake += key;
+                        ws.handshake += "\r\nSec-WebSocket-Version: 13\r\n\r\n";
+
+                        state = sending;
+
+                        return net::async_write(ws.next, net::buffer(ws.handshake), std::move(self));
+                    }
+                    case sending:
+                    case reading:
+                        if (ec)
+                            return self.complete(ec);
+
+                        if (state == reading)
+                            ws.tail += n;
+
+                        break;
+                }
+
+                auto block = ws.header_block();
+
+                if (block.empty())
+                {
+                    if (ws.tail - ws.head >= max_header_size)
+                        return self.complete(protocol_error());
+
+                    state = reading;
+
+                    return ws.next.async_read_some(ws.prepare(max_header_size), std::move(self));
+                }
+
+                if (!block.starts_with("HTTP/1.1 101") || ws::field(block, "Sec-WebSocket-Accept") != ws::accept_key(key))
+                    return self.complete(protocol_error());
+
+                ws.open = true;
+                self.complete({});
+            }
+
+            websocket_stream& ws;
+
+            std::string host;
+            std::string target;
+
+            std::string key;
+            int state = starting;
+        };
+
+        template <typename DynamicBuffer>
+        struct read_op
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                switch (state)
+                {
+                    case starting:
+                        if (!ws.open || ws.close_received)
+                        {
+                            state = finished;
+
+                            return net::post(ws.get_executor(), std::move(self));
+                        }
+
+                        break;
+                    case reading:
+                        if (ec)
+                            return complete(self, ec);
+
+                        ws.tail += n;
+
+                        break;
+                    case direct:
+                        if (ec)
+                            return complete(self, ec);
+
+                        if (ws.frame.masked)
+                            simd::mask(payload, payload, n, ws.frame.key, ws.offset);
+
+                        if (ws.rd_op == ws::text)
+                            ws.utf8.feed(payload, n);
+
+                        buffer.commit(n);
+
+                        ws.offset += n;
+                        ws.remaining -= n;
+
+                        total += n;
+
+                        break;
+                    case replying:
+                        if (ec)
+                            return complete(self, ec);
+
+                        if (ws.control_pending)
+                            return ws.write_control(std::move(self));
+
+                        ws.resume();
+
+                        break;
+                    case closing:
+                        ws.resume();
+                        ws.close_next();
+
+                        return complete(self, ec ? ec : net::error::eof);
+                    case failing:
+                        ws.resume();
+                        ws.close_next();
+
+                        return complete(self, protocol_error());
+                    default:
+                        return complete(self, net::error::eof);
+                }
+
+                while (true)
+                {
+                    if (!ws.in_frame)
+                    {
+                        auto data = ws.rd.data() + ws.head;
+                        auto size = ws.tail - ws.head;
+
+                        auto& frame = ws.frame;
+                        auto h = ws::decode_header(data, size, frame);
+
+                        if (!h)
+                            return read_more(self);
+
+                        bool control = frame.op >= ws::close;
+                        bool continuation = frame.op == ws::continuation;
+
+                        // the header is checked as soon as it is decoded, a control frame is only waited for once its length is known to be valid
+                        if (frame.rsv || frame.masked != ws.server || (control && (!frame.fin || frame.length > 125 || frame.op > ws::pong)) ||
+                           (!control && frame.op > ws::binary) || (!control && continuation != ws.in_message) || (frame.op == ws::close && frame.length == 1))
+                            return fail(self, ws::protocol_error);
+
+                        if (control && size - h < frame.length)
+                            return read_more(self);
+
+                        ws.head += h;
+
+                        if (control)
+                        {
+                            auto payload = ws.rd.data() + ws.head;
+                            auto length = frame.length;
+
+                            if (frame.masked)
+                                simd::mask(payload, payload, length, frame.key);
+
+                            ws.head += length;
+
+                            if (frame.op == ws::ping)
+                            {
+                                ws.queue_control(ws::pong, payload, length);
+
+                                if (!ws.wr_busy)
+                                {
+                                    ws.wr_busy = true;
+                                    state = replying;
+
+                                    return ws.write_control(std::move(self));
+                                }
+                            }
+                            else if (frame.op == ws::close)
+                            {
+                                ws.close_received = true;
+
+                                if (length >= 2)
+                                    ws.close_reason = static_cast<uint16_t>(static_cast<uint8_t>(payload[0]) << 8 | static_cast<uint8_t>(payload[1]));
+
+                                if (ws.close_sent)
+                                {
+                                    ws.close_next();
+
+                                    return complete(self, net::error::eof);
+                                }
+
+                                // echoes the close frame, the server closes the connection once it is written
+                                ws.close_sent = true;
+                                ws.queue_control(ws::close, payload, std::min<std::size_t>(length, 2));
+
+                                if (ws.wr_busy)
+                                    return complete(self, net::error::eof);
+
+                                ws.wr_busy = true;
+                                state = closing;
+
+                                return ws.write_control(std::move(self));
+                            }
+
+                            continue;
+                        }
+
+                        if (!continuation)
+                        {
+                            ws.in_message = true;
+                            ws.rd_op = frame.op;
+
+                            ws.utf8.reset();
+                        }
+
+                        if (total + frame.length > ws.max_message || frame.length > buffer.max_size() - buffer.size())
+                            return complete(self, net::error::message_size);
+
+                        ws.in_frame = true;
+
+                        ws.offset = 0;
+                        ws.remaining = frame.length;
+                    }
+
+                    if (auto available = std::min<uint64_t>(ws.remaining, ws.tail - ws.head))
+                    {
+                        ws.copy_payload(buffer, ws.rd.data() + ws.head, available);
+
+                        ws.head += available;
+                        total += available;
+                    }
+
+                    if (ws.utf8.failed)
+                        return fail(self, ws::invalid_payload);
+
+                    if (!ws.remaining)
+                    {
+                        ws.in_frame = false;
+
+                        if (ws.frame.fin)
+                        {
+                            ws.in_message = false;
+
+                            if (ws.rd_op == ws::text && !ws.utf8.complete())
+                                return fail(self, ws::invalid_payload);
+
+                            return complete(self, {});
+                        }
+
+                        continue;
+                    }
+
+                    // the rest of a large payload is read straight into the dynamic buffer, skipping the read buffer
+                    if (ws.remaining >= ws.rd.size() / 2)
+                    {
+                        net::mutable_buffer b = *net::buffer_sequence_begin(buffer.prepare(std::min<uint64_t>(ws.remaining, ws.rd.size())));
+
+                        payload = static_cast<char*>(b.data());
+                        state = direct;
+
+                        return ws.next.async_read_some(b, std::move(self));
+                    }
+
+                    return read_more(self);
+                }
+            }
+
+            // fails the connection, the close frame with the code goes out first unless another write is in progress
+            template <typename Self>
+            void fail(Self& self, ws::close_code code)
+            {
+                if (ws.wr_busy || ws.close_sent)
+                {
+                    ws.close_next();
+
+                    return complete(self, protocol_error());
+                }
+
+                char reason[2] = {static_cast<char>(code >> 8), static_cast<char>(code)};
+
+                ws.wr_busy = true;
+                ws.close_sent = true;
+
+                ws.queue_control(ws::close, reason, 2);
+                state = failing;
+
+                ws.write_control(std::move(self));
+            }
+
+            // a read buffer without room left cannot hold what is still missing
+            template <typename Self>
+            void read_more(Self& self)
+            {
+                auto b = ws.prepare(ws.rd.size());
+
+                if (!b.size())
+                    return complete(self, net::error::message_size);
+
+                state = reading;
+
+                ws.next.async_read_some(b, std::move(self));
+            }
+
+            template <typename Self>
+            void complete(Self& self, error_code_t ec)
+            {
+                ws.rd_busy = false;
+
+                self.complete(ec, total);
+            }
+
+            websocket_stream& ws;
+            DynamicBuffer buffer;
+
+            int state = starting;
+            std::size_t total = 0;
+
+            char* payload = nullptr;
+        };
+
+        template <typename ConstBufferSequence>
+        struct write_op
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                switch (state)
+                {
+                    case starting:
+                        if (ws.wr_busy)
+                            return ws.park(std::move(self));
+
+                        // the next parked write or close finds the stream closed as well
+                        if (!ws.open || ws.close_sent)
+                        {
+                            state = finished;
+                            ws.resume();
+
+                            return net::post(ws.get_executor(), std::move(self));
+                        }
+
+                        ws.wr_busy = true;
+                        state = sending;
+
+                        if (encoded)
+                            return net::async_write(ws.next, buffers, std::move(self));
+
+                        return ws.write_frame(ws.wr_op, buffers, std::move(self));
+                    case sending:
+                    case replying:
+                        if (!ec && ws.control_pending)
+                        {
+                            state = replying;
+
+                            return ws.write_control(std::move(self));
+                        }
+
+                        ws.resume();
+
+                        return self.complete(ec, ec ? 0 : net::buffer_size(buffers));
+                    default:
+                        return self.complete(net::error::not_connected, 0);
+                }
+            }
+
+            websocket_stream& ws;
+            ConstBufferSequence buffers;
+
+            bool encoded = false;
+            int state = starting;
+        };
+
+        struct close_op
+        {
+            template <typename Self>
+            void operator()(Self& self, error_code_t ec = {}, std::size_t n = 0)
+            {
+                switch (state)
+                {
+                    case starting:
+                        if (ws.wr_busy)
+                            return ws.park(std::move(self));
+
+                        if (!ws.open || ws.close_sent)
+                        {
+                            state = finished;
+                            ws.resume();
+
+                            return net::post(ws.get_executor(), std::move(self));
+                        }
+
+                        ws.wr_busy = true;
+                        ws.close_sent = true;
+
+                        ws.queue_control(ws::close, reason, 2);
+                        state = closing;
+
+                        return ws.write_control(std::move(self));
+                    case closing:
+                        ws.resume();
+
+                        if (ec)
+                            return self.complete(ec);
+
+                        if (ws.close_received)
+                        {
+                            ws.close_next();
+
+                            return self.complete({});
+                        }
+
+                        // a pending read receives the close frame of the peer, otherwise the frames before it are drained here
+                        if (ws.rd_busy)
+                            return self.complete({});
+
+                        state = reading;
+
+                        return drain(self);
+                    case reading:
+                        if (!ec)
+                            return drain(self);
+
+                        return self.complete(ec == net::error::eof ? error_code_t() : ec);
+                    default:
+                        return self.complete({});
+                }
+            }
+
+            template <typename Self>
+            void drain(Self& self)
+            {
+                ws.drained.clear();
+                ws.async_read(net::dynamic_buffer(ws.drained), std::move(self));
+            }
+
+            websocket_stream& ws;
+            char reason[2];
+
+            int state = starting;
+        };
+
+        template <typename Token>
+        decltype(auto) async_accept(Token&& token)
+        {
+            return net::async_compose<Token, void(error_code_t)>(accept_op{*this}, token, next);
+        }
+
+        template <typename Token>
+        decltype(auto) async_handshake(std::string_view host, std::string_view target, Token&& token)
+        {
+            return net::async_compose<Token, void(error_code_t)>(handshake_op{*this, std::string(host), std::string(target)}, token, next);
+        }
+
+        template <typename DynamicBuffer, typename Token>
+        decltype(auto) async_read(DynamicBuffer&& buffer, Token&& token)
+        {
+            rd_busy = true;
+
+            return net::async_compose<Token, void(error_code_t, std::size_t)>(read_op<DynamicBuffer>{*this, std::forward<DynamicBuffer>(buffer)}, token, next);
+        }
+
+        template <typename ConstBufferSequence, typename Token>
+        decltype(auto) async_write(const ConstBufferSequence& buffers, Token&& token)
+        {
+            return net::async_compose<Token, void(error_code_t, std::size_t)>(write_op<ConstBufferSequence>{*this, buffers}, token, next);
+        }
+
+        // writes the frames a server encoded beforehand with ws::encode_frame as they are, they are serialized with the other writes
+        // and the control frames the stream answers, several frames may go out in a single write
+        template <typename ConstBufferSequence, typename Token>
+        decltype(auto) async_write_frames(const ConstBufferSequence& buffers, Token&& token)
+        {
+            return net::async_compose<Token, void(error_code_t, std::size_t)>(write_op<ConstBufferSequence>{*this, buffers, true}, token, next);
+        }
+
+        // the stream to write pre-encoded frames to with snp::async_write
+        struct frame_writer
+        {
+            using executor_type = websocket_stream::executor_type;
+            using is_deflate_supported = std::false_type;
+
+            executor_type get_executor() noexcept
+            {
+                return ws.get_executor();
+            }
+
+            template <typename ConstBufferSequence, typename Token>
+            decltype(auto) async_write(const ConstBufferSequence& buffers, Token&& token)
+            {
+                return ws.async_write_frames(buffers, std::forward<Token>(token));
+            }
+
+            websocket_stream& ws;
+        };
+
+        template <typename Code, typename Token>
+        decltype(auto) async_close(Code code, Token&& token)
+        {
+            auto value = static_cast<uint16_t>(code);
+
+            return net::async_compose<Token, void(error_code_t)>(close_op{*this, {static_cast<char>(value >> 8), static_cast<char>(value)}}, token, next);
+        }
+
+        NextLayer next;
+
+        pooled_buffer rd;
+        pooled_buffer wr;
+
+        ws::utf8_validator utf8;
+
+        std::size_t head = 0;
+        std::size_t tail = 0;
+
+        ws::frame_header frame{};
+
+        uint64_t remaining = 0;
+        std::size_t offset = 0;
+
+        std::size_t max_message = 16 << 20;
+        std::string handshake;
+
+        std::string drained;
+        std::vector<net::const_buffer> wr_buffers;
+
+        char wr_header[ws::max_header_length];
+        char wr_control[125];
+
+        char control[125];
+        std::size_t control_size = 0;
+
+        std::deque<std::unique_ptr<parked>> waiting;
+
+        ws::opcode rd_op = ws::text;
+        ws::opcode wr_op = ws::text;
+
+        ws::opcode control_op = ws::pong;
+        uint16_t close_reason = 0;
+
+        bool server = true;
+        bool open = false;
+
+        bool in_frame = false;
+        bool in_message = false;
+
+        bool rd_busy = false;
+        bool wr_busy = false;
+
+        bool control_pending = false;
+
+        bool close_sent = false;
+        bool close_received = false;
+    };
+}
+
+#endif